@@ -0,0 +1,20 @@
+######################################################################
+# Microbenchmark for the /proc parsers, not part of the application build:
+#   qmake benchmark.pro && make && ./proc_parsers_benchmark
+######################################################################
+
+TEMPLATE = app
+TARGET = proc_parsers_benchmark
+INCLUDEPATH += $$PWD/../src/
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+QT = core
+
+QMAKE_CXXFLAGS += -O2
+
+# Input
+HEADERS += ../src/proc_parsers.h \
+		   ../src/process_sampler.h
+SOURCES += proc_parsers_benchmark.cpp \
+		   ../src/proc_parsers.cpp
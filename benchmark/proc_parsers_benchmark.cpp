@@ -0,0 +1,240 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measure the /proc parsers in src/proc_parsers.cpp against the implementations they replaced,
+ * over every process currently running. Prints nanoseconds per process for each pair.
+ *
+ * Usage: proc_parsers_benchmark [rounds]
+ */
+
+#include "proc_parsers.h"
+#include <QString>
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace Legacy {
+    bool getProcPidIO(int pid, ProcPidIO &io ) {
+        std::stringstream ss;
+        ss << "/proc/" << pid << "/io";
+        std::ifstream ifs( ss.str().c_str() );
+        if ( ifs.good() ) {
+            while ( ifs.good() && !ifs.eof() ) {
+                std::string s;
+                getline( ifs, s );
+                unsigned long t;
+                if ( sscanf( s.c_str(), "rchar: %lu", &t ) == 1 ) io.rchar = t;
+                else if ( sscanf( s.c_str(), "wchar: %lu", &t ) == 1 ) io.wchar = t;
+                else if ( sscanf( s.c_str(), "syscr: %lu", &t ) == 1 ) io.syscr = t;
+                else if ( sscanf( s.c_str(), "syscw: %lu", &t ) == 1 ) io.syscw = t;
+                else if ( sscanf( s.c_str(), "read_bytes: %lu", &t ) == 1 ) io.read_bytes = t;
+                else if ( sscanf( s.c_str(), "write_bytes: %lu", &t ) == 1 ) io.write_bytes = t;
+                else if ( sscanf( s.c_str(), "cancelled_write_bytes: %lu", &t ) == 1 ) io.cancelled_write_bytes = t;
+            }
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    QString getProcessCmdline(pid_t pid)
+    {
+        std::string temp;
+        try {
+            std::fstream fs;
+            fs.open("/proc/"+std::to_string((long)pid)+"/cmdline", std::fstream::in);
+            std::getline(fs,temp);
+            fs.close();
+        } catch(std::ifstream::failure e) {
+            return "FAILED TO READ PROC";
+        }
+
+        // change \0 to ' '
+        std::replace(temp.begin(),temp.end(),'\0',' ');
+
+        if (temp.size()<1) {
+            return "";
+        }
+        return QString::fromStdString(temp);
+    }
+
+    bool parseStat(const char *buffer, ProcessSample &sample)
+    {
+        const char *nameStart = strchr(buffer, '(');
+        const char *nameEnd = strrchr(buffer, ')');
+        if (nameStart == NULL || nameEnd == NULL || nameEnd < nameStart || nameEnd[1] == '\0') {
+            return false;
+        }
+
+        size_t nameLength = std::min(static_cast<size_t>(nameEnd - nameStart - 1), sizeof(sample.cmd) - 1);
+        memcpy(sample.cmd, nameStart + 1, nameLength);
+        sample.cmd[nameLength] = '\0';
+
+        const char *c = nameEnd + 2;
+        sample.state = *c;
+        c++;
+
+        char *end;
+        for (int field = 4; field <= 22; field++) {
+            unsigned long long value = strtoull(c, &end, 10);
+            if (end == c) {
+                return false;
+            }
+            c = end;
+
+            switch (field) {
+            case 4:
+                sample.ppid = static_cast<pid_t>(value);
+                break;
+            case 14:
+                sample.utime = value;
+                break;
+            case 15:
+                sample.stime = value;
+                break;
+            case 22:
+                sample.start_time = value;
+                break;
+            }
+        }
+
+        return true;
+    }
+}
+
+static std::vector<pid_t> listPids()
+{
+    std::vector<pid_t> pids;
+
+    DIR *dir = opendir("/proc");
+    if (dir == NULL) {
+        return pids;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int pid = atoi(entry->d_name);
+        if (pid > 0) {
+            pids.push_back(pid);
+        }
+    }
+    closedir(dir);
+
+    return pids;
+}
+
+template <typename Function>
+static double measure(const std::vector<pid_t> &pids, int rounds, Function function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (pid_t pid : pids) {
+            function(pid);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (static_cast<double>(rounds) * pids.size());
+}
+
+static void report(const char *name, double legacy, double current)
+{
+    printf("%-8s %10.0f ns/process %10.0f ns/process %6.1fx\n", name, legacy, current, legacy / current);
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 20;
+    std::vector<pid_t> pids = listPids();
+    if (rounds <= 0 || pids.empty()) {
+        return 1;
+    }
+
+    // Keep results alive so the compiler can't drop the work.
+    volatile unsigned long sink = 0;
+
+    printf("%zu processes, %d rounds\n", pids.size(), rounds);
+    printf("%-8s %21s %21s\n", "parser", "legacy", "current");
+
+    double legacy = measure(pids, rounds, [&](pid_t pid) {
+            ProcPidIO io = ProcPidIO();
+            Legacy::getProcPidIO(pid, io);
+            sink += io.rchar;
+        });
+    double current = measure(pids, rounds, [&](pid_t pid) {
+            ProcPidIO io = ProcPidIO();
+            ProcParsers::readIO(pid, io);
+            sink += io.rchar;
+        });
+    report("io", legacy, current);
+
+    legacy = measure(pids, rounds, [&](pid_t pid) {
+            sink += Legacy::getProcessCmdline(pid).size();
+        });
+    current = measure(pids, rounds, [&](pid_t pid) {
+            char buffer[4096];
+            ssize_t length = ProcParsers::readCmdline(pid, buffer, sizeof(buffer));
+            sink += length > 0 ? QString::fromUtf8(buffer, length).size() : 0;
+        });
+    report("cmdline", legacy, current);
+
+    // Stat is read once up front, only parsing is compared since both read the file the same way.
+    std::vector<std::string> stats;
+    for (pid_t pid : pids) {
+        char path[32];
+        char buffer[1024];
+
+        snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+        if (ProcParsers::readFileAt(AT_FDCWD, path, buffer, sizeof(buffer)) > 0) {
+            stats.push_back(buffer);
+        }
+    }
+
+    if (stats.empty()) {
+        return 1;
+    }
+
+    legacy = measure(pids, rounds, [&](pid_t pid) {
+            ProcessSample sample;
+            Legacy::parseStat(stats[pid % stats.size()].c_str(), sample);
+            sink += sample.utime;
+        });
+    current = measure(pids, rounds, [&](pid_t pid) {
+            ProcessSample sample;
+            ProcParsers::parseStat(stats[pid % stats.size()].c_str(), sample);
+            sink += sample.utime;
+        });
+    report("stat", legacy, current);
+
+    return 0;
+}
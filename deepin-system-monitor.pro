@@ -17,16 +17,28 @@ RESOURCES = deepin-system-monitor.qrc
 
 # Input
 HEADERS += src/utils.h \
+		   src/cgroup_sampler.h \
+		   src/cpu_accounting.h \
            src/toolbar.h \
 		   src/cpu_monitor.h \
+		   src/memory_detail_sampler.h \
 		   src/memory_monitor.h \
 		   src/network_monitor.h \
 		   src/network_traffic_filter.h \
 		   src/status_monitor.h \
+		   src/status_sampler.h \
+		   src/status_snapshot.h \
            src/process_manager.h \
            src/list_item.h \
            src/list_view.h \
            src/process_item.h \
+           src/thread_item.h \
+           src/service_item.h \
+           src/signal_dispatcher.h \
+           src/snapshot_player.h \
+           src/snapshot_recording.h \
+           src/snapshot_ring.h \
+           src/snapshot_source.h \
            src/process_view.h \
 		   src/hashqstring.h \
            src/find_window_title.h \
@@ -35,21 +47,44 @@ HEADERS += src/utils.h \
 		   src/interactive_kill.h \
 		   src/start_tooltip.h \
 		   src/process_tree.h \
+		   src/process_grouper.h \
+		   src/process_sampler.h \
+		   src/thread_sampler.h \
+		   src/proc_connector.h \
+		   src/taskstats_client.h \
+		   src/refresh_scheduler.h \
+		   src/sampling_governor.h \
+		   src/proc_parsers.h \
+		   src/desktop_entry_index.h \
+		   src/desktop_entry_cache.h \
+		   src/pid_state_table.h \
+		   src/pipeline_profiler.h \
 		   src/process_switch_tab.h \
 		   src/attributes_dialog.h \
 		   src/main_window.h
 SOURCES += src/main.cpp \
 		   src/utils.cpp \
+		   src/cgroup_sampler.cpp \
+		   src/cpu_accounting.cpp \
 		   src/toolbar.cpp \
 		   src/cpu_monitor.cpp \
+		   src/memory_detail_sampler.cpp \
 		   src/memory_monitor.cpp \
 		   src/network_monitor.cpp \
 		   src/network_traffic_filter.cpp \
 		   src/status_monitor.cpp \
+		   src/status_sampler.cpp \
            src/process_manager.cpp \
            src/list_item.cpp \
            src/list_view.cpp \
            src/process_item.cpp \
+           src/thread_item.cpp \
+           src/service_item.cpp \
+           src/signal_dispatcher.cpp \
+           src/snapshot_player.cpp \
+           src/snapshot_recording.cpp \
+           src/snapshot_ring.cpp \
+           src/snapshot_source.cpp \
            src/process_view.cpp \
 		   src/find_window_title.cpp \
 		   src/window_manager.cpp \
@@ -57,6 +92,18 @@ SOURCES += src/main.cpp \
 		   src/interactive_kill.cpp \
 		   src/start_tooltip.cpp \
 		   src/process_tree.cpp \
+		   src/process_grouper.cpp \
+		   src/process_sampler.cpp \
+		   src/thread_sampler.cpp \
+		   src/proc_connector.cpp \
+		   src/taskstats_client.cpp \
+		   src/refresh_scheduler.cpp \
+		   src/sampling_governor.cpp \
+		   src/proc_parsers.cpp \
+		   src/desktop_entry_index.cpp \
+		   src/desktop_entry_cache.cpp \
+		   src/pid_state_table.cpp \
+		   src/pipeline_profiler.cpp \
 		   src/process_switch_tab.cpp \
 		   src/attributes_dialog.cpp \
 		   src/main_window.cpp
@@ -72,3 +119,4 @@ QMAKE_CXXFLAGS += -g
 LIBS += -L$$PWD/nethogs/src -lnethogs -lpcap
 LIBS += -L"libprocps" -lprocps
 LIBS += -lX11 -lXext -lXtst
+LIBS += -lrt
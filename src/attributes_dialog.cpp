@@ -23,8 +23,6 @@
 
 #include "attributes_dialog.h"
 #include <QPainter>
-#include <proc/sysinfo.h>
-#include <proc/readproc.h>
 #include <QDebug>
 #include "utils.h"
 
@@ -83,32 +81,17 @@ AttributesDialog::AttributesDialog(QWidget *parent, int pid) : DAbstractDialog(p
     layout->addLayout(cmdlineLayout);
     layout->addSpacing(20);
     
-    // Read the list of open processes information.
-    PROCTAB* proc = openproc(PROC_FILLMEM | PROC_FILLSTAT | PROC_FILLSTATUS | PROC_FILLUSR | PROC_FILLCOM);
-    static proc_t proc_info;
-    memset(&proc_info, 0, sizeof(proc_t));
+    // Read process information.
+    ProcessSample sample;
+    if (ProcessSampler::readProcess(pid, sample)) {
+        QString name = getProcessName(&sample);
+        std::string desktopFile = getDesktopFileFromName(name);
+        QString cmdline = Utils::getProcessCmdline(pid);
+        QPixmap icon = getProcessIconFromName(name, desktopFile, nullptr, 96);
 
-    std::map<int, proc_t> processes;
-    while (readproc(proc, &proc_info) != NULL) {
-        processes[proc_info.tid]=proc_info;
-    }
-    closeproc(proc);
-
-    for(auto &i:processes) {
-        int processId = (&i.second)->tid;
-        
-        if (pid == processId) {
-            QString name = getProcessName(&i.second);
-            std::string desktopFile = getDesktopFileFromName(name);
-            QString cmdline = Utils::getProcessCmdline(processId);
-            QPixmap icon = getProcessIconFromName(name, desktopFile, nullptr, 96);
-            
-            iconLabel->setPixmap(icon);
-            nameLabel->setText(name);
-            cmdlineLabel->setText(cmdline);
-            
-            break;
-        }
+        iconLabel->setPixmap(icon);
+        nameLabel->setText(name);
+        cmdlineLabel->setText(cmdline);
     }
 }
 
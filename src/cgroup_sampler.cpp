@@ -0,0 +1,330 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cgroup_sampler.h"
+#include "proc_parsers.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace ProcParsers;
+
+// Find the value of "key value" lines, as in cpu.stat.
+static bool findValue(const char *buffer, const char *key, unsigned long long &value)
+{
+    size_t length = strlen(key);
+    for (const char *line = buffer; line != nullptr && *line != '\0'; line = strchr(line, '\n')) {
+        if (*line == '\n') {
+            line++;
+        }
+        if (strncmp(line, key, length) == 0 && line[length] == ' ') {
+            value = strtoull(line + length + 1, nullptr, 10);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Sum "rbytes=" and "wbytes=" of every device line of io.stat.
+static void sumIOStat(const char *buffer, unsigned long long &readBytes, unsigned long long &writeBytes)
+{
+    readBytes = 0;
+    writeBytes = 0;
+
+    const char *field = buffer;
+    while ((field = strchr(field, '=')) != nullptr) {
+        if (field - buffer >= 6 && strncmp(field - 6, "rbytes", 6) == 0) {
+            readBytes += strtoull(field + 1, nullptr, 10);
+        } else if (field - buffer >= 6 && strncmp(field - 6, "wbytes", 6) == 0) {
+            writeBytes += strtoull(field + 1, nullptr, 10);
+        }
+        field++;
+    }
+}
+
+// Cut a cgroup path right after its innermost service or scope, so sub-cgroups a service makes for itself count with it.
+static std::string unitPath(const std::string &path)
+{
+    size_t unitEnd = std::string::npos;
+    size_t begin = 0;
+    while (begin < path.size()) {
+        size_t end = path.find('/', begin + 1);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+
+        std::string component = path.substr(begin + 1, end - begin - 1);
+        size_t dot = component.rfind('.');
+        if (dot != std::string::npos && (component.compare(dot, std::string::npos, ".service") == 0 ||
+                                         component.compare(dot, std::string::npos, ".scope") == 0)) {
+            unitEnd = end;
+        }
+        begin = end;
+    }
+
+    return unitEnd == std::string::npos ? path : path.substr(0, unitEnd);
+}
+
+CgroupSampler::CgroupSampler()
+{
+    rootFd = -1;
+    generation = 0;
+    lastGroupId = 0;
+
+    // cgroup2 is at /sys/fs/cgroup on unified systems and at /sys/fs/cgroup/unified on hybrid ones.
+    FILE *mountInfo = fopen("/proc/self/mountinfo", "re");
+    if (mountInfo != nullptr) {
+        char line[1024];
+        while (rootFd < 0 && fgets(line, sizeof(line), mountInfo) != nullptr) {
+            char mountPoint[512];
+            if (strstr(line, " - cgroup2 ") != nullptr && sscanf(line, "%*s %*s %*s %*s %511s", mountPoint) == 1) {
+                rootFd = open(mountPoint, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            }
+        }
+        fclose(mountInfo);
+    }
+}
+
+CgroupSampler::~CgroupSampler()
+{
+    for (auto &state : states) {
+        closeGroup(state.second);
+    }
+
+    if (rootFd >= 0) {
+        close(rootFd);
+    }
+}
+
+bool CgroupSampler::isUnified() const
+{
+    return rootFd >= 0;
+}
+
+void CgroupSampler::beginTick()
+{
+    generation++;
+}
+
+unsigned int CgroupSampler::add(pid_t pid, unsigned int &groupId, double cpuPercent, long memory)
+{
+    auto state = states.find(groupId);
+    if (state == states.end()) {
+        groupId = 0;
+
+        std::string path;
+        if (!readCgroupPath(pid, path)) {
+            return 0;
+        }
+
+        auto id = groupIds.find(path);
+        if (id != groupIds.end()) {
+            state = states.find(id->second);
+        } else {
+            GroupState newState;
+            newState.group.id = ++lastGroupId;
+            newState.group.path = path;
+            newState.group.name = path == "/" ? "-.slice" : path.substr(path.rfind('/') + 1);
+            newState.generation = 0;
+            newState.opened = false;
+            newState.cpuFd = -1;
+            newState.memoryFd = -1;
+            newState.ioFd = -1;
+            newState.hasCounters = false;
+            newState.usage = 0;
+            newState.readBytes = 0;
+            newState.writeBytes = 0;
+            newState.sampleTime = 0;
+
+            groupIds.insert(std::make_pair(path, newState.group.id));
+            state = states.insert(std::make_pair(newState.group.id, newState)).first;
+        }
+    }
+
+    GroupState &groupState = state->second;
+    if (groupState.generation != generation) {
+        groupState.generation = generation;
+        groupState.group.processNumber = 0;
+        groupState.memberCpu = 0;
+        groupState.memberMemory = 0;
+    }
+    groupState.group.processNumber++;
+    groupState.memberCpu += cpuPercent;
+    groupState.memberMemory += memory;
+
+    groupId = groupState.group.id;
+    return groupId;
+}
+
+void CgroupSampler::sample(long long now, std::vector<const Group*> &groups)
+{
+    groups.clear();
+
+    for (auto state = states.begin(); state != states.end();) {
+        if (state->second.generation != generation) {
+            closeGroup(state->second);
+            groupIds.erase(state->second.group.path);
+            state = states.erase(state);
+            continue;
+        }
+
+        readGroup(state->second, now);
+        groups.push_back(&state->second.group);
+        ++state;
+    }
+}
+
+void CgroupSampler::closeGroup(GroupState &state)
+{
+    if (state.cpuFd >= 0) {
+        close(state.cpuFd);
+    }
+    if (state.memoryFd >= 0) {
+        close(state.memoryFd);
+    }
+    if (state.ioFd >= 0) {
+        close(state.ioFd);
+    }
+
+    state.cpuFd = -1;
+    state.memoryFd = -1;
+    state.ioFd = -1;
+    state.opened = false;
+    state.hasCounters = false;
+}
+
+void CgroupSampler::openGroup(GroupState &state)
+{
+    state.opened = true;
+
+    // Totals of the root cgroup are the whole machine, not what runs directly in it.
+    if (rootFd < 0 || state.group.path == "/") {
+        return;
+    }
+
+    int dirFd = openat(rootFd, state.group.path.c_str() + 1, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return;
+    }
+
+    // memory.current and io.stat only exist where the controller is enabled.
+    state.cpuFd = openat(dirFd, "cpu.stat", O_RDONLY | O_CLOEXEC);
+    state.memoryFd = openat(dirFd, "memory.current", O_RDONLY | O_CLOEXEC);
+    state.ioFd = openat(dirFd, "io.stat", O_RDONLY | O_CLOEXEC);
+
+    close(dirFd);
+}
+
+bool CgroupSampler::readCgroupPath(pid_t pid, std::string &path) const
+{
+    char filePath[32];
+    snprintf(filePath, sizeof(filePath), "/proc/%d/cgroup", pid);
+
+    char buffer[4096];
+    if (readFileAt(AT_FDCWD, filePath, buffer, sizeof(buffer)) <= 0) {
+        return false;
+    }
+
+    // "0::/path" is the unified hierarchy, without it systemd's own legacy hierarchy has the same layout.
+    const char *unified = nullptr;
+    const char *systemd = nullptr;
+    for (const char *line = buffer; *line != '\0';) {
+        if (strncmp(line, "0::", 3) == 0) {
+            unified = line + 3;
+        } else {
+            const char *name = strstr(line, ":name=systemd:");
+            const char *end = strchr(line, '\n');
+            if (name != nullptr && (end == nullptr || name < end)) {
+                systemd = name + strlen(":name=systemd:");
+            }
+        }
+
+        line = strchr(line, '\n');
+        if (line == nullptr) {
+            break;
+        }
+        line++;
+    }
+
+    const char *begin = unified != nullptr ? unified : systemd;
+    if (begin == nullptr || *begin != '/') {
+        return false;
+    }
+
+    path = unitPath(std::string(begin, strcspn(begin, "\n")));
+    return true;
+}
+
+void CgroupSampler::readGroup(GroupState &state, long long now)
+{
+    // Whatever the cgroup doesn't tell is summed over the processes of this tick.
+    Group &group = state.group;
+    group.cpuPercent = state.memberCpu;
+    group.memory = state.memberMemory;
+    group.readKbs = 0;
+    group.writeKbs = 0;
+
+    if (!state.opened) {
+        openGroup(state);
+    }
+
+    char buffer[4096];
+    unsigned long long usage = 0;
+    unsigned long long readBytes = 0;
+    unsigned long long writeBytes = 0;
+
+    // A unit that was stopped and started again between two ticks has a new cgroup, open it again next time.
+    if (state.cpuFd >= 0 && (preadFile(state.cpuFd, buffer, sizeof(buffer)) < 0 || !findValue(buffer, "usage_usec", usage))) {
+        closeGroup(state);
+        return;
+    }
+
+    if (state.memoryFd >= 0 && preadFile(state.memoryFd, buffer, sizeof(buffer)) > 0) {
+        group.memory = strtol(buffer, nullptr, 10);
+    }
+
+    if (state.ioFd >= 0 && preadFile(state.ioFd, buffer, sizeof(buffer)) > 0) {
+        sumIOStat(buffer, readBytes, writeBytes);
+    }
+
+    // Counters only give rates from the second read on, until then processes are the best guess for cpu.
+    if (state.hasCounters && now > state.sampleTime) {
+        double seconds = (now - state.sampleTime) / 1000.0;
+        if (state.cpuFd >= 0 && usage >= state.usage) {
+            group.cpuPercent = (usage - state.usage) / (seconds * 10000.0);
+        }
+        if (state.ioFd >= 0 && readBytes >= state.readBytes && writeBytes >= state.writeBytes) {
+            group.readKbs = (readBytes - state.readBytes) / seconds;
+            group.writeKbs = (writeBytes - state.writeBytes) / seconds;
+        }
+    }
+
+    state.usage = usage;
+    state.readBytes = readBytes;
+    state.writeBytes = writeBytes;
+    state.sampleTime = now;
+    state.hasCounters = true;
+}
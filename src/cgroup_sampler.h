@@ -0,0 +1,118 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CGROUPSAMPLER_H
+#define CGROUPSAMPLER_H
+
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * CgroupSampler groups processes by the systemd unit (service or scope) their cgroup belongs to,
+ * and reads the totals of each unit straight from its cgroup v2 files: cpu.stat, memory.current
+ * and io.stat. Those count every process that ran in the unit, short-lived ones included, and cost
+ * a few pread() calls per unit instead of a sum over all of its processes.
+ *
+ * The cgroup of a process is only read once, callers keep the returned group id for as long as
+ * the process lives. Units without a readable cgroup v2 directory (the root cgroup, or machines
+ * with only the legacy hierarchy) fall back to summing what was passed in for their processes.
+ */
+class CgroupSampler final
+{
+public:
+    struct Group
+    {
+        unsigned int id;
+        std::string path;               // cgroup path cut after the unit, "/" for the root cgroup
+        std::string name;               // unit name, last component of path
+        int processNumber;
+        double cpuPercent;              // share of one cpu used since the previous sample
+        long memory;                    // bytes
+        float readKbs;                  // bytes per second, like DiskStatus
+        float writeKbs;
+    };
+
+    CgroupSampler();
+    ~CgroupSampler();
+
+    /*
+     * Whether a cgroup v2 hierarchy is mounted, without one all totals are sums over processes.
+     */
+    bool isUnified() const;
+
+    /*
+     * Start a new tick, groups that get no process until the next sample() are forgotten.
+     */
+    void beginTick();
+
+    /*
+     * Count a process in its group.
+     *
+     * @groupId group the process was put in before, 0 (or a group that is gone) reads its cgroup again
+     * @cpuPercent share of one cpu used by the process, only used if the group has no cpu.stat
+     * @memory bytes used by the process, only used if the group has no memory.current
+     * @return id of the group, also stored in groupId, 0 if the cgroup can't be read
+     */
+    unsigned int add(pid_t pid, unsigned int &groupId, double cpuPercent, long memory);
+
+    /*
+     * Read the totals of every group that got a process in this tick.
+     *
+     * @now sampler clock in milliseconds
+     * @groups filled with those groups, valid until the next sample()
+     */
+    void sample(long long now, std::vector<const Group*> &groups);
+
+private:
+    struct GroupState
+    {
+        Group group;
+        unsigned int generation;
+        bool opened;                    // descriptors were opened, files that don't exist stay at -1
+        int cpuFd;
+        int memoryFd;
+        int ioFd;
+        double memberCpu;               // sums over the processes of this tick
+        long memberMemory;
+        bool hasCounters;               // counters below were read at least once
+        unsigned long long usage;       // cpu.stat usage_usec
+        unsigned long long readBytes;   // io.stat rbytes summed over devices
+        unsigned long long writeBytes;
+        long long sampleTime;
+    };
+
+    void closeGroup(GroupState &state);
+    void openGroup(GroupState &state);
+    bool readCgroupPath(pid_t pid, std::string &path) const;
+    void readGroup(GroupState &state, long long now);
+
+    std::unordered_map<unsigned int, GroupState> states;
+    std::unordered_map<std::string, unsigned int> groupIds;
+    int rootFd;
+    unsigned int generation;
+    unsigned int lastGroupId;
+};
+
+#endif
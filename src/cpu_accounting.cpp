@@ -0,0 +1,161 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cpu_accounting.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+unsigned long long CpuTimes::busy() const
+{
+    return user + nice + system + irq + softirq + steal;
+}
+
+unsigned long long CpuTimes::total() const
+{
+    return busy() + idle + iowait;
+}
+
+CpuAccounting::CpuAccounting()
+{
+    memset(&current, 0, sizeof(CpuTimes));
+    memset(&delta, 0, sizeof(CpuTimes));
+
+    // The cpu lines come first, the rest of /proc/stat (intr, softirq, ...) can be cut off.
+    buffer.resize(64 * 1024);
+    cpus = 1;
+    statFd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+}
+
+CpuAccounting::~CpuAccounting()
+{
+    if (statFd >= 0) {
+        close(statFd);
+    }
+}
+
+bool CpuAccounting::sample()
+{
+    if (statFd < 0) {
+        return false;
+    }
+
+    ssize_t length = pread(statFd, buffer.data(), buffer.size() - 1, 0);
+    if (length <= 0) {
+        return false;
+    }
+    buffer[length] = '\0';
+
+    CpuTimes previous = current;
+    if (!parse(buffer.data())) {
+        return false;
+    }
+
+    // First sample has no previous one, leave the delta empty.
+    if (previous.total() == 0) {
+        return true;
+    }
+
+    delta.user = current.user - previous.user;
+    delta.nice = current.nice - previous.nice;
+    delta.system = current.system - previous.system;
+    delta.idle = current.idle - previous.idle;
+    delta.iowait = current.iowait - previous.iowait;
+    delta.irq = current.irq - previous.irq;
+    delta.softirq = current.softirq - previous.softirq;
+    delta.steal = current.steal - previous.steal;
+
+    // iowait of an idle cpu may go backwards, see proc(5).
+    if (current.iowait < previous.iowait) {
+        delta.iowait = 0;
+    }
+
+    return true;
+}
+
+double CpuAccounting::processPercent(unsigned long long processTicks) const
+{
+    unsigned long long totalTicks = delta.total();
+    if (totalTicks == 0) {
+        return 0;
+    }
+
+    return processTicks * 100.0 * cpus / totalTicks;
+}
+
+double CpuAccounting::busyPercent() const
+{
+    unsigned long long totalTicks = delta.total();
+    if (totalTicks == 0) {
+        return 0;
+    }
+
+    return delta.busy() * 100.0 / totalTicks;
+}
+
+const CpuTimes& CpuAccounting::currentTimes() const
+{
+    return current;
+}
+
+const CpuTimes& CpuAccounting::deltaTimes() const
+{
+    return delta;
+}
+
+int CpuAccounting::cpuNumber() const
+{
+    return cpus;
+}
+
+bool CpuAccounting::parse(const char *text)
+{
+    if (strncmp(text, "cpu ", 4) != 0) {
+        return false;
+    }
+
+    unsigned long long *fields[] = {
+        &current.user, &current.nice, &current.system, &current.idle,
+        &current.iowait, &current.irq, &current.softirq, &current.steal
+    };
+
+    // Older kernels have fewer columns, missing ones stay zero.
+    const char *c = text + 4;
+    char *end;
+    for (unsigned long long *field : fields) {
+        *field = strtoull(c, &end, 10);
+        c = end;
+    }
+
+    // Count the per-cpu lines, they follow the aggregate one.
+    int number = 0;
+    for (const char *line = strchr(text, '\n'); line != NULL && strncmp(line + 1, "cpu", 3) == 0; line = strchr(line + 1, '\n')) {
+        number++;
+    }
+    if (number > 0) {
+        cpus = number;
+    }
+
+    return true;
+}
@@ -0,0 +1,91 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CPUACCOUNTING_H
+#define CPUACCOUNTING_H
+
+#include <vector>
+
+/**
+ * Aggregate cpu time of all online cpus from the first line of /proc/stat, in clock ticks.
+ * guest and guest_nice are left out since they are already included in user and nice.
+ */
+struct CpuTimes
+{
+    unsigned long long user;
+    unsigned long long nice;
+    unsigned long long system;
+    unsigned long long idle;
+    unsigned long long iowait;
+    unsigned long long irq;
+    unsigned long long softirq;
+    unsigned long long steal;
+
+    unsigned long long busy() const;
+    unsigned long long total() const;
+};
+
+/**
+ * CpuAccounting reads /proc/stat once per sample and measures every process of that sample
+ * against the same denominator, so the process shares of one tick add up consistently.
+ */
+class CpuAccounting final
+{
+public:
+    CpuAccounting();
+    ~CpuAccounting();
+
+    /*
+     * Read /proc/stat and compute the delta against the previous sample.
+     *
+     * @return false if /proc/stat can't be read, previous values are kept in that case
+     */
+    bool sample();
+
+    /*
+     * Cpu usage of a process, in percent of one cpu (so up to 100 * cpuNumber()).
+     *
+     * @processTicks utime + stime the process used between the previous and current sample
+     */
+    double processPercent(unsigned long long processTicks) const;
+
+    /*
+     * Busy share of the whole machine between the previous and current sample, from 0 to 100.
+     */
+    double busyPercent() const;
+
+    const CpuTimes& currentTimes() const;
+    const CpuTimes& deltaTimes() const;
+    int cpuNumber() const;
+
+private:
+    bool parse(const char *buffer);
+
+    CpuTimes current;
+    CpuTimes delta;
+    std::vector<char> buffer;
+    int cpus;
+    int statFd;
+};
+
+#endif
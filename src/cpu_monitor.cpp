@@ -91,8 +91,13 @@ void CpuMonitor::updateStatus(double cpuPercent)
     cpuPath = SmoothCurveGenerator::generateSmoothCurve(points);
 
     if (cpuPercents->last() != cpuPercents->at(cpuPercents->size() - 2)) {
-        animationIndex = 0;
-        timer->start(30);
+        // Jump to the new curve while hidden, animating it would only wake the timer for nothing.
+        if (updatesEnabled()) {
+            animationIndex = 0;
+            timer->start(30);
+        } else {
+            animationIndex = animationFrames;
+        }
     }
 }
 
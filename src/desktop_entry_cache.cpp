@@ -0,0 +1,124 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "desktop_entry_cache.h"
+#include "desktop_entry_index.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QTextStream>
+
+DesktopEntryCache* DesktopEntryCache::instance()
+{
+    static DesktopEntryCache cache;
+
+    return &cache;
+}
+
+DesktopEntryCache::DesktopEntryCache()
+{
+    // Build locale keys once, such as zh_CN, with zh as fallback like the desktop entry spec says.
+    localeName = QLocale::system().name();
+    languageName = localeName.section('_', 0, 0);
+}
+
+DesktopEntry DesktopEntryCache::get(const std::string &desktopFile)
+{
+    QMutexLocker locker(&mutex);
+
+    QString path = QString::fromStdString(desktopFile);
+    unsigned int indexGeneration = DesktopEntryIndex::instance()->generation();
+
+    auto cached = entries.find(path);
+    if (cached != entries.end()) {
+        if (cached->indexGeneration == indexGeneration) {
+            return cached->entry;
+        }
+
+        // Something changed under the application directories, re-parse only if this file did.
+        cached->indexGeneration = indexGeneration;
+        qint64 modifiedTime = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+        if (modifiedTime == cached->modifiedTime) {
+            return cached->entry;
+        }
+    }
+
+    CachedEntry entry;
+    entry.modifiedTime = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    entry.indexGeneration = indexGeneration;
+    parse(path, entry.entry);
+    entries.insert(path, entry);
+
+    return entry.entry;
+}
+
+bool DesktopEntryCache::parse(const QString &path, DesktopEntry &entry)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QString localeNameFlag = QString("Name[%1]=").arg(localeName);
+    QString languageNameFlag = QString("Name[%1]=").arg(languageName);
+    QString localeGenericNameFlag = QString("GenericName[%1]=").arg(localeName);
+    QString languageGenericNameFlag = QString("GenericName[%1]=").arg(languageName);
+
+    QString name, localeNameValue, languageNameValue;
+    QString genericName, localeGenericNameValue, languageGenericNameValue;
+
+    // Only keys of the main [Desktop Entry] group, actions have their own Name= lines.
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    bool inMainGroup = false;
+    while (!stream.atEnd()) {
+        QString line = stream.readLine();
+
+        if (line.startsWith("[")) {
+            inMainGroup = (line == "[Desktop Entry]");
+        } else if (!inMainGroup) {
+            continue;
+        } else if (line.startsWith(localeNameFlag)) {
+            localeNameValue = line.mid(localeNameFlag.size());
+        } else if (line.startsWith(languageNameFlag)) {
+            languageNameValue = line.mid(languageNameFlag.size());
+        } else if (line.startsWith("Name=")) {
+            name = line.mid(5);
+        } else if (line.startsWith(localeGenericNameFlag)) {
+            localeGenericNameValue = line.mid(localeGenericNameFlag.size());
+        } else if (line.startsWith(languageGenericNameFlag)) {
+            languageGenericNameValue = line.mid(languageGenericNameFlag.size());
+        } else if (line.startsWith("GenericName=")) {
+            genericName = line.mid(12);
+        } else if (line.startsWith("Icon=")) {
+            entry.icon = line.mid(5).trimmed();
+        } else if (line.startsWith("Exec=")) {
+            entry.exec = line.mid(5).trimmed();
+        }
+    }
+
+    entry.name = !localeNameValue.isEmpty() ? localeNameValue : (!languageNameValue.isEmpty() ? languageNameValue : name);
+    entry.genericName = !localeGenericNameValue.isEmpty() ? localeGenericNameValue : (!languageGenericNameValue.isEmpty() ? languageGenericNameValue : genericName);
+
+    return true;
+}
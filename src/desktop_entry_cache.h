@@ -0,0 +1,82 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESKTOPENTRYCACHE_H
+#define DESKTOPENTRYCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <string>
+
+/**
+ * The keys of a desktop file's [Desktop Entry] group that the monitor displays.
+ * name and genericName are already localized to the system locale when a translation exists.
+ */
+struct DesktopEntry
+{
+    QString name;
+    QString genericName;
+    QString icon;
+    QString exec;
+};
+
+/**
+ * Cache of parsed desktop files, so display names and icons are a hash lookup instead of
+ * re-reading the file for every process on every refresh.
+ *
+ * Entries are re-validated against the file mtime only after DesktopEntryIndex saw a change
+ * under the application directories, in steady state a lookup does no IO at all.
+ */
+class DesktopEntryCache final
+{
+public:
+    static DesktopEntryCache* instance();
+
+    /*
+     * Get the parsed entry of a desktop file, parsing it on first use.
+     *
+     * @desktopFile path of the desktop file
+     * @return the entry, with empty fields if the file can't be read
+     */
+    DesktopEntry get(const std::string &desktopFile);
+
+private:
+    DesktopEntryCache();
+
+    struct CachedEntry
+    {
+        DesktopEntry entry;
+        qint64 modifiedTime;
+        unsigned int indexGeneration;
+    };
+
+    bool parse(const QString &path, DesktopEntry &entry);
+
+    QHash<QString, CachedEntry> entries;
+    QMutex mutex;
+    QString localeName;
+    QString languageName;
+};
+
+#endif
@@ -0,0 +1,265 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "desktop_entry_index.h"
+#include "utils.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <algorithm>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// Launchers, shells and interpreters that show up first in Exec= lines but are not the application itself.
+// Every process they run would be taken for the first application naming them.
+static const QStringList EXEC_WRAPPERS = {
+    "env", "sh", "bash", "dash", "zsh", "sudo", "pkexec", "flatpak",
+    "python", "perl", "ruby", "lua", "php", "java", "node", "nodejs", "electron", "mono", "wine", "gjs"
+};
+
+/*
+ * Whether an executable name is a wrapper, versioned ones (python3.11, wine64, electron12) included.
+ */
+static bool isExecWrapper(const QString &execName)
+{
+    int end = execName.size();
+    while (end > 0 && (execName.at(end - 1).isDigit() || execName.at(end - 1) == '.')) {
+        end--;
+    }
+
+    return EXEC_WRAPPERS.contains(execName.left(end));
+}
+
+static QString reversed(const QString &string)
+{
+    QString result;
+    result.reserve(string.size());
+    for (int i = string.size() - 1; i >= 0; i--) {
+        result.append(string.at(i));
+    }
+
+    return result;
+}
+
+DesktopEntryIndex* DesktopEntryIndex::instance()
+{
+    static DesktopEntryIndex index;
+
+    return &index;
+}
+
+DesktopEntryIndex::DesktopEntryIndex()
+{
+    directories = QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation);
+    if (!directories.contains("/usr/share/applications")) {
+        directories.append("/usr/share/applications");
+    }
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    build();
+}
+
+DesktopEntryIndex::~DesktopEntryIndex()
+{
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+    }
+}
+
+std::string DesktopEntryIndex::find(QString procName)
+{
+    QMutexLocker locker(&mutex);
+
+    QString name = procName.toLower();
+    auto cached = lookupCache.constFind(name);
+    if (cached != lookupCache.constEnd()) {
+        return cached.value();
+    }
+
+    std::string desktopFile = lookup(name);
+    lookupCache.insert(name, desktopFile);
+
+    return desktopFile;
+}
+
+void DesktopEntryIndex::refresh()
+{
+    if (inotifyFd < 0) {
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+
+    bool changed = false;
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    while (read(inotifyFd, buffer, sizeof(buffer)) > 0) {
+        changed = true;
+    }
+
+    if (changed) {
+        build();
+    }
+}
+
+unsigned int DesktopEntryIndex::generation() const
+{
+    return buildGeneration.load();
+}
+
+std::string DesktopEntryIndex::lookup(const QString &name)
+{
+    if (name.isEmpty() || GUI_BLACKLIST.contains(name)) {
+        return std::string();
+    }
+
+    QString fileName = name + ".desktop";
+
+    auto exact = fileNames.constFind(fileName);
+    if (exact != fileNames.constEnd()) {
+        return exact.value().toStdString();
+    }
+
+    auto exec = execNames.constFind(name);
+    if (exec != execNames.constEnd()) {
+        return exec.value().toStdString();
+    }
+
+    auto wmClass = wmClasses.constFind(name);
+    if (wmClass != wmClasses.constEnd()) {
+        return wmClass.value().toStdString();
+    }
+
+    // File names ending with name.desktop (such as org.gnome.Nautilus.desktop) share the prefix
+    // of their reversed key, so they sit in one contiguous range of the sorted index.
+    QString prefix = reversed(fileName);
+    auto begin = std::lower_bound(reversedFileNames.constBegin(), reversedFileNames.constEnd(), prefix,
+                                  [](const Entry &entry, const QString &key) { return entry.key < key; });
+    const Entry *match = nullptr;
+    for (auto i = begin; i != reversedFileNames.constEnd() && i->key.startsWith(prefix); ++i) {
+        if (match == nullptr || i->key.size() < match->key.size()) {
+            match = i;
+        }
+    }
+
+    if (match != nullptr) {
+        return match->path.toStdString();
+    }
+
+    return std::string();
+}
+
+void DesktopEntryIndex::addWatch(const QString &path)
+{
+    if (inotifyFd >= 0) {
+        inotify_add_watch(inotifyFd, path.toLocal8Bit().constData(),
+                          IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF);
+    }
+}
+
+void DesktopEntryIndex::build()
+{
+    execNames.clear();
+    fileNames.clear();
+    wmClasses.clear();
+    lookupCache.clear();
+    reversedFileNames.clear();
+
+    // Directories listed first take precedence, like XDG_DATA_DIRS.
+    for (const QString &directory : directories) {
+        if (!QFileInfo(directory).isDir()) {
+            continue;
+        }
+
+        // inotify_add_watch returns the existing watch for a known path, so re-adding after a rebuild is harmless.
+        addWatch(directory);
+
+        QDirIterator dir(directory, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (dir.hasNext()) {
+            dir.next();
+
+            QFileInfo info = dir.fileInfo();
+            if (info.isDir()) {
+                addWatch(info.filePath());
+            } else if (info.suffix() == "desktop") {
+                indexFile(info.filePath(), info.fileName().toLower());
+            }
+        }
+    }
+
+    std::sort(reversedFileNames.begin(), reversedFileNames.end(), [](const Entry &entry1, const Entry &entry2) {
+            return entry1.key < entry2.key;
+        });
+
+    buildGeneration.ref();
+}
+
+void DesktopEntryIndex::indexFile(const QString &path, const QString &fileName)
+{
+    if (fileNames.contains(fileName)) {
+        return;
+    }
+
+    fileNames.insert(fileName, path);
+    reversedFileNames.append({reversed(fileName), path});
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    // Only keys of the main [Desktop Entry] group, actions have Exec= lines too.
+    QTextStream stream(&file);
+    bool inMainGroup = false;
+    while (!stream.atEnd()) {
+        QString line = stream.readLine();
+
+        if (line.startsWith("[")) {
+            inMainGroup = (line == "[Desktop Entry]");
+        } else if (!inMainGroup) {
+            continue;
+        } else if (line.startsWith("Exec=")) {
+            for (QString arg : line.mid(5).split(' ', QString::SkipEmptyParts)) {
+                arg.remove('"');
+
+                QString execName = QFileInfo(arg).fileName().toLower();
+                if (arg.startsWith('-') || arg.contains('=') || isExecWrapper(execName)) {
+                    continue;
+                }
+
+                if (!execNames.contains(execName)) {
+                    execNames.insert(execName, path);
+                }
+                break;
+            }
+        } else if (line.startsWith("StartupWMClass=")) {
+            QString wmClass = line.mid(15).trimmed().toLower();
+            if (!wmClass.isEmpty() && !wmClasses.contains(wmClass)) {
+                wmClasses.insert(wmClass, path);
+            }
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DESKTOPENTRYINDEX_H
+#define DESKTOPENTRYINDEX_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <string>
+
+/**
+ * In-memory index of the .desktop files under the XDG application directories.
+ *
+ * The index is built once and maps file names, executable names (from Exec=) and StartupWMClass
+ * to desktop files. Directories are watched with inotify, refresh() rebuilds the index when
+ * anything under them changed, so lookups never touch the filesystem.
+ */
+class DesktopEntryIndex final
+{
+public:
+    static DesktopEntryIndex* instance();
+
+    /*
+     * Find the desktop file of a process.
+     * Match order is: file name is exactly procName.desktop, executable name, StartupWMClass,
+     * then file name ends with procName.desktop (shortest file name wins).
+     *
+     * @procName process name, compared case insensitively
+     * @return path of the desktop file, empty if nothing matches
+     */
+    std::string find(QString procName);
+
+    /*
+     * Drain pending inotify events and rebuild the index if any desktop file changed.
+     * Call it once per refresh cycle, it costs a single non-blocking read when nothing changed.
+     */
+    void refresh();
+
+    /*
+     * Number of times the index has been built, changes whenever desktop files changed on disk.
+     */
+    unsigned int generation() const;
+
+private:
+    DesktopEntryIndex();
+    ~DesktopEntryIndex();
+
+    struct Entry
+    {
+        QString key;
+        QString path;
+    };
+
+    std::string lookup(const QString &procName);
+    void addWatch(const QString &path);
+    void build();
+    void indexFile(const QString &path, const QString &fileName);
+
+    QHash<QString, QString> execNames;
+    QHash<QString, QString> fileNames;
+    QHash<QString, QString> wmClasses;
+    QAtomicInt buildGeneration;
+    QHash<QString, std::string> lookupCache;
+    QMutex mutex;
+    QStringList directories;
+    QVector<Entry> reversedFileNames;
+    int inotifyFd;
+};
+
+#endif
@@ -25,5 +25,42 @@
 
 ListItem::ListItem()
 {
-    
+    parentItem = NULL;
+    collapsed = false;
+    childItems = false;
+}
+
+void ListItem::setParentItem(ListItem *item)
+{
+    parentItem = item;
+}
+
+ListItem* ListItem::getParentItem() const
+{
+    return parentItem;
+}
+
+void ListItem::setCollapsed(bool collapsed)
+{
+    this->collapsed = collapsed;
+}
+
+bool ListItem::isCollapsed() const
+{
+    return collapsed;
+}
+
+void ListItem::setHasChildren(bool hasChildren)
+{
+    childItems = hasChildren;
+}
+
+bool ListItem::hasChildren() const
+{
+    return childItems;
+}
+
+QRect ListItem::getExpanderRect(QRect) const
+{
+    return QRect();
 }
@@ -34,15 +34,6 @@ class ListItem : public QObject
 public:
     ListItem();
     
-    /*
-     * The interface function that used to compare the two ListItem
-     * The ListView requires this interface to keep the selected items unchanged when refreshed
-     * 
-     * @item any subclass of ListItem, you can use static_cast in implementation to access any attribute to compare two items
-     * @return return true if two items have same attribute, the compare method implement by subclass of ListItem
-     */
-    virtual bool sameAs(ListItem *item)=0;
-    
     /* 
      * The interface function that used to draw background of ListItem.
      * Such as background and selected effect.
@@ -64,6 +55,41 @@ public:
      * @isSelect current item is selected, you can draw selected effect under content when isSelect is true
      */
     virtual void drawForeground(QRect rect, QPainter *painter, int column, int index, bool isSelect)=0;
+    
+    /*
+     * Set the item this one is shown under.
+     * Children are kept right below their parent whatever the sort order, and are only shown when their parent is.
+     * 
+     * @item the parent item, NULL for a top level item
+     */
+    void setParentItem(ListItem *item);
+    ListItem* getParentItem() const;
+    
+    /*
+     * Collapse or expand the children of the item.
+     * A collapsed item hides everything below it, it's up to the item to show what it stands for then.
+     */
+    void setCollapsed(bool collapsed);
+    bool isCollapsed() const;
+    
+    /*
+     * Whether any child is listed under the item, kept up to date by ListView.
+     */
+    void setHasChildren(bool hasChildren);
+    bool hasChildren() const;
+    
+    /*
+     * Area of the expander drawn by the item, clicking it collapses or expands the children.
+     * 
+     * @rect first column of the row, as passed to drawForeground
+     * @return empty rect if the item draws no expander, which is the default
+     */
+    virtual QRect getExpanderRect(QRect rect) const;
+    
+private:
+    ListItem *parentItem;
+    bool collapsed;
+    bool childItems;
 };
 
 #endif
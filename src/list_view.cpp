@@ -27,9 +27,12 @@
 #include <QStyleFactory>
 #include <QDebug>
 #include <QEvent>
+#include <QHash>
 #include <QWheelEvent>
 #include <QtMath>
 #include <QMenu>
+#include <QSet>
+#include <algorithm>
 
 using namespace Utils;
 
@@ -100,6 +103,7 @@ void ListView::setColumnTitles(QList<QString> titles, int height)
 {
     columnTitles = titles;
     titleHeight = height;
+    clipPathSize = QSize();
 }
 
 void ListView::setColumnHideFlags(QList<bool> toggleHideFlags)
@@ -143,6 +147,7 @@ void ListView::setSearchAlgorithm(SearchAlgorithm algorithm)
 void ListView::setClipRadius(int radius)
 {
     clipRadius = radius;
+    clipPathSize = QSize();
 }
 
 
@@ -150,13 +155,9 @@ void ListView::addItems(QList<ListItem*> items)
 {
     // Add item to list.
     listItems->append(items);
-    QList<ListItem*> searchItems = getSearchItems(items);
-    renderItems->append(searchItems);
 
     // If user has click title to sort, sort items after add items to list.
-    if (defaultSortingColumn != -1) {
-        sortItemsByColumn(defaultSortingColumn, defaultSortingOrder);
-    }
+    updateRenderItems();
 }
 
 void ListView::clearItems()
@@ -172,6 +173,9 @@ void ListView::addSelections(QList<ListItem*> items, bool recordLastSelection)
 {
     // Add item to selection list.
     selectionItems->append(items);
+    for (ListItem *item : items) {
+        selectionSet.insert(item);
+    }
 
     // Record last selection item to make selected operation continuously.
     if (recordLastSelection && selectionItems->count() > 0) {
@@ -183,74 +187,59 @@ void ListView::clearSelections(bool clearLastSelection)
 {
     // Clear selection list.
     selectionItems->clear();
+    selectionSet.clear();
 
     if (clearLastSelection) {
         lastSelectItem = NULL;
     }
 }
 
-void ListView::refreshItems(QList<ListItem*> items)
+void ListView::updateItems(QList<ListItem*> newItems, QList<ListItem*> removedItems)
 {
-    // Init.
-    QList<ListItem*> *newSelectionItems = new QList<ListItem*>();
-    ListItem *newLastSelectionItem = NULL;
-
-    // Save selection items and last selection item.
-    for (ListItem *item:items) {
-        for (ListItem *selectionItem:*selectionItems) {
-            if (item->sameAs(selectionItem)) {
-                newSelectionItems->append(item);
-                break;
-            }
-        }
-    }
-    if (lastSelectItem != NULL) {
-        for (ListItem *item:items) {
-            if (item->sameAs(lastSelectItem)) {
-                newLastSelectionItem = item;
-                break;
-            }
+    // Drop removed items from every list before delete them.
+    if (!removedItems.isEmpty()) {
+        QSet<ListItem*> removedSet = removedItems.toSet();
+        auto isRemoved = [&](ListItem *item) {
+            return removedSet.contains(item);
+        };
+
+        listItems->erase(std::remove_if(listItems->begin(), listItems->end(), isRemoved), listItems->end());
+        renderItems->erase(std::remove_if(renderItems->begin(), renderItems->end(), isRemoved), renderItems->end());
+        selectionItems->erase(std::remove_if(selectionItems->begin(), selectionItems->end(), isRemoved), selectionItems->end());
+        for (ListItem *item : removedItems) {
+            selectionSet.remove(item);
         }
-    }
 
-    // Update items.
-    clearItems();
-    listItems->append(items);
-    QList<ListItem*> searchItems = getSearchItems(items);
-    renderItems->append(searchItems);
+        if (lastSelectItem != NULL && removedSet.contains(lastSelectItem)) {
+            lastSelectItem = NULL;
+        }
 
-    // Sort once if default sort column hasn't init.
-    if (defaultSortingColumn != -1) {
-        sortItemsByColumn(defaultSortingColumn, defaultSortingOrder);
+        qDeleteAll(removedItems);
     }
 
-    // Restore selection items and last selection item.
-    clearSelections();
-    addSelections(*newSelectionItems, false);
-    lastSelectItem = newLastSelectionItem;
+    // Add new items.
+    listItems->append(newItems);
+
+    // Values have changed, filter and sort again. Items changed in place may not match search content any more,
+    // and children hidden under a collapsed item have to come back once it's gone.
+    updateRenderItems();
 
     // Keep scroll position.
     renderOffset = adjustRenderOffset(renderOffset);
 
     // Render.
+    updateVisibleItems();
     repaint();
 }
 
 void ListView::search(QString content)
 {
-    if (content == "" && searchContent != content) {
-        searchContent = content;
+    searchContent = content;
 
-        renderItems->clear();
-        renderItems->append(*listItems);
-    } else {
-        searchContent = content;
-
-        QList<ListItem*> searchItems = getSearchItems(*listItems);
-        renderItems->clear();
-        renderItems->append(searchItems);
-    }
+    // Filter and put child items back under their parent.
+    updateRenderItems();
 
+    updateVisibleItems();
     repaint();
 }
 
@@ -267,6 +256,7 @@ void ListView::selectAllItems()
     renderOffset = getTopRenderOffset();
 
     // Repaint.
+    updateVisibleItems();
     repaint();
 }
 
@@ -286,6 +276,7 @@ void ListView::selectFirstItem()
     renderOffset = getTopRenderOffset();
 
     // Repaint.
+    updateVisibleItems();
     repaint();
 }
 
@@ -305,6 +296,7 @@ void ListView::selectLastItem()
     renderOffset = getBottomRenderOffset();
 
     // Repaint.
+    updateVisibleItems();
     repaint();
 }
 
@@ -344,6 +336,7 @@ void ListView::shiftSelectToEnd()
         renderOffset = getBottomRenderOffset();
 
         // Repaint.
+        updateVisibleItems();
         repaint();
     }
 }
@@ -364,6 +357,7 @@ void ListView::shiftSelectToHome()
         renderOffset = getTopRenderOffset();
 
         // Repaint.
+        updateVisibleItems();
         repaint();
     }
 }
@@ -392,6 +386,7 @@ void ListView::ctrlScrollPageUp()
 {
     renderOffset = adjustRenderOffset(renderOffset - getScrollAreaHeight());
 
+    updateVisibleItems();
     repaint();
 }
 
@@ -399,6 +394,7 @@ void ListView::ctrlScrollPageDown()
 {
     renderOffset = adjustRenderOffset(renderOffset + getScrollAreaHeight());
 
+    updateVisibleItems();
     repaint();
 }
 
@@ -406,6 +402,7 @@ void ListView::ctrlScrollToHome()
 {
     renderOffset = getTopRenderOffset();
 
+    updateVisibleItems();
     repaint();
 }
 
@@ -413,6 +410,7 @@ void ListView::ctrlScrollToEnd()
 {
     renderOffset = getBottomRenderOffset();
 
+    updateVisibleItems();
     repaint();
 }
 
@@ -427,6 +425,7 @@ void ListView::scrollAnimation()
     if (scrollAnimationTicker <= scrollAnimationFrames) {
         renderOffset = adjustRenderOffset(scrollStartY + easeInOut(scrollAnimationTicker / (scrollAnimationFrames * 1.0)) * scrollDistance);
 
+        updateVisibleItems();
         repaint();
 
         scrollAnimationTicker++;
@@ -479,6 +478,10 @@ void ListView::keyPressEvent(QKeyEvent *keyEvent)
         } else {
             selectNextItem();
         }
+    } else if (keyEvent->key() == Qt::Key_Left) {
+        setItemsCollapsed(*selectionItems, true);
+    } else if (keyEvent->key() == Qt::Key_Right) {
+        setItemsCollapsed(*selectionItems, false);
     } else if (keyEvent->key() == Qt::Key_PageUp) {
         if (keyEvent->modifiers() == Qt::ControlModifier) {
             ctrlScrollPageUp();
@@ -513,6 +516,7 @@ void ListView::mouseMoveEvent(QMouseEvent *mouseEvent)
         int barHeight = getScrollbarHeight();
         renderOffset = adjustRenderOffset((mouseEvent->y() - barHeight / 2 - titleHeight) / (getScrollAreaHeight() * 1.0) * getItemsTotalHeight());
 
+        updateVisibleItems();
         repaint();
     }
     // Otherwise update scrollbar status with mouse position.
@@ -558,8 +562,9 @@ void ListView::mousePressEvent(QMouseEvent *mouseEvent)
                             defaultSortingColumn = columnCounter;
                             defaultSortingOrder = (*sortingOrderes)[columnCounter];
 
-                            sortItemsByColumn(columnCounter, (*sortingOrderes)[columnCounter]);
+                            updateRenderItems();
 
+                            updateVisibleItems();
                             repaint();
                             break;
                         }
@@ -611,6 +616,7 @@ void ListView::mousePressEvent(QMouseEvent *mouseEvent)
         // Scroll if click out of scrollbar area.
         else {
             renderOffset = adjustRenderOffset((mouseEvent->y() - barHeight / 2 - titleHeight) / (getScrollAreaHeight() * 1.0) * getItemsTotalHeight());
+            updateVisibleItems();
             repaint();
         }
     }
@@ -619,13 +625,28 @@ void ListView::mousePressEvent(QMouseEvent *mouseEvent)
         int pressItemIndex = (renderOffset + mouseEvent->y() - titleHeight) / rowHeight;
 
         if (mouseEvent->button() == Qt::LeftButton) {
+            // Clicking the expander of an item only collapses or expands it, selection is left alone.
+            if (pressItemIndex < renderItems->count() && mouseEvent->modifiers() == Qt::NoModifier) {
+                ListItem *item = (*renderItems)[pressItemIndex];
+                QRect columnRect(0, titleHeight + pressItemIndex * rowHeight - renderOffset, getRenderWidths().value(0), rowHeight);
+
+                if (item->hasChildren() && item->getExpanderRect(columnRect).contains(mouseEvent->pos())) {
+                    QList<ListItem*> items;
+                    items << item;
+                    setItemsCollapsed(items, !item->isCollapsed());
+
+                    return;
+                }
+            }
+
             if (pressItemIndex < renderItems->count()) {
                 // Scattered selection of items when press ctrl modifier.
                 if (mouseEvent->modifiers() == Qt::ControlModifier) {
                     ListItem *item = (*renderItems)[pressItemIndex];
 
-                    if (selectionItems->contains(item)) {
+                    if (selectionSet.contains(item)) {
                         selectionItems->removeOne(item);
+                        selectionSet.remove(item);
                     } else {
                         QList<ListItem*> items = QList<ListItem*>();
                         items << item;
@@ -649,6 +670,7 @@ void ListView::mousePressEvent(QMouseEvent *mouseEvent)
                     addSelections(items);
                 }
 
+                updateVisibleItems();
                 repaint();
             }
         } else if (mouseEvent->button() == Qt::RightButton) {
@@ -670,6 +692,7 @@ void ListView::mousePressEvent(QMouseEvent *mouseEvent)
                 items << (*renderItems)[pressItemIndex];
                 addSelections(items);
 
+                updateVisibleItems();
                 repaint();
             }
 
@@ -728,9 +751,18 @@ void ListView::paintEvent(QPaintEvent *)
     painter.setRenderHint(QPainter::Antialiasing, true);
     painter.setOpacity(0.05);
 
-    int penWidth = 1;
-    QPainterPath clipPath;
-    clipPath.addRoundedRect(QRect(rect().x() + penWidth, rect().y() + penWidth, rect().width() - penWidth * 2, rect().height() - penWidth * 2), clipRadius, clipRadius);
+    // Clip paths only change with the size of the view, every row shares the one of the scroll area.
+    if (clipPathSize != size()) {
+        int penWidth = 1;
+        clipPath = QPainterPath();
+        clipPath.addRoundedRect(QRect(rect().x() + penWidth, rect().y() + penWidth, rect().width() - penWidth * 2, rect().height() - penWidth * 2), clipRadius, clipRadius);
+
+        QPainterPath scrollAreaPath;
+        scrollAreaPath.addRect(QRectF(rect().x(), rect().y() + titleHeight, rect().width(), getScrollAreaHeight()));
+        scrollAreaClipPath = clipPath.intersected(scrollAreaPath);
+
+        clipPathSize = size();
+    }
     painter.setClipPath(clipPath);
 
     // Draw title.
@@ -740,7 +772,6 @@ void ListView::paintEvent(QPaintEvent *)
     painter.fillPath(titlePath, QColor("#ffffff"));
 
     int renderY = 0;
-    int renderHeight = 0;
     if (titleHeight > 0) {
         int columnCounter = 0;
         int columnRenderX = 0;
@@ -775,7 +806,6 @@ void ListView::paintEvent(QPaintEvent *)
         }
 
         renderY += titleHeight;
-        renderHeight += titleHeight;
     }
 
     // Draw background.
@@ -785,41 +815,34 @@ void ListView::paintEvent(QPaintEvent *)
     painter.fillPath(backgroundPath, QColor("#ffffff"));
 
     // Draw context.
-    QPainterPath scrollAreaPath;
-    scrollAreaPath.addRect(QRectF(rect().x(), rect().y() + titleHeight, rect().width(), getScrollAreaHeight()));
+    // Only rows in the viewport are visited, starting right at the first one, so painting costs
+    // the same whatever the number of items. Rows draw inside their own rect, one clip does for all.
+    painter.setClipPath(scrollAreaClipPath);
+
+    int firstRow = std::max(0, renderOffset / rowHeight);
+    for (int rowCounter = firstRow; rowCounter < renderItems->count(); rowCounter++) {
+        int rowY = renderY + rowCounter * rowHeight - renderOffset;
+        if (rowY >= rect().height()) {
+            break;
+        }
 
-    int rowCounter = 0;
-    for (ListItem *item:*renderItems) {
-        if (rowCounter > ((renderOffset - rowHeight) / rowHeight)) {
-            // Clip item rect.
-            QPainterPath itemPath;
-            itemPath.addRect(QRect(0, renderY + rowCounter * rowHeight - renderOffset, rect().width(), rowHeight));
-            painter.setClipPath((clipPath.intersected(scrollAreaPath)).intersected(itemPath));
-
-            // Draw item backround.
-            bool isSelect = selectionItems->contains(item);
-            item->drawBackground(QRect(0, renderY + rowCounter * rowHeight - renderOffset, rect().width(), rowHeight), &painter, rowCounter, isSelect);
-
-            // Draw item foreground.
-            int columnCounter = 0;
-            int columnRenderX = 0;
-            for (int renderWidth:renderWidths) {
-                if (renderWidth > 0) {
-                    item->drawForeground(QRect(columnRenderX, renderY + rowCounter * rowHeight - renderOffset, renderWidth, rowHeight), &painter, columnCounter, rowCounter, isSelect);
-
-                    columnRenderX += renderWidth;
-                }
-                columnCounter++;
-            }
+        ListItem *item = (*renderItems)[rowCounter];
 
-            renderHeight += rowHeight;
+        // Draw item backround.
+        bool isSelect = selectionSet.contains(item);
+        item->drawBackground(QRect(0, rowY, rect().width(), rowHeight), &painter, rowCounter, isSelect);
 
-            if (renderHeight > rect().height()) {
-                break;
+        // Draw item foreground.
+        int columnCounter = 0;
+        int columnRenderX = 0;
+        for (int renderWidth:renderWidths) {
+            if (renderWidth > 0) {
+                item->drawForeground(QRect(columnRenderX, rowY, renderWidth, rowHeight), &painter, columnCounter, rowCounter, isSelect);
+
+                columnRenderX += renderWidth;
             }
+            columnCounter++;
         }
-
-        rowCounter++;
     }
 
     // Keep clip area.
@@ -843,6 +866,22 @@ void ListView::paintEvent(QPaintEvent *)
     }
 }
 
+void ListView::resizeEvent(QResizeEvent *event)
+{
+    // More or fewer rows fit in the viewport.
+    updateVisibleItems();
+
+    QWidget::resizeEvent(event);
+}
+
+void ListView::showEvent(QShowEvent *event)
+{
+    // Changes while hidden weren't told, catch up now.
+    updateVisibleItems();
+
+    QWidget::showEvent(event);
+}
+
 void ListView::paintScrollbar(QPainter *painter)
 {
     if (getItemsTotalHeight() > getScrollAreaHeight()) {
@@ -917,6 +956,7 @@ void ListView::selectNextItemWithOffset(int scrollOffset)
                 renderOffset = itemOffset;
             }
 
+            updateVisibleItems();
             repaint();
         }
     }
@@ -954,6 +994,7 @@ void ListView::selectPrevItemWithOffset(int scrollOffset)
                 renderOffset = itemOffset;
             }
 
+            updateVisibleItems();
             repaint();
         }
     }
@@ -1017,6 +1058,7 @@ void ListView::shiftSelectPrevItemWithOffset(int scrollOffset)
 
             renderOffset = adjustRenderOffset((selectionStartIndex - 1) * rowHeight + titleHeight);
 
+            updateVisibleItems();
             repaint();
         }
     }
@@ -1060,6 +1102,7 @@ void ListView::shiftSelectNextItemWithOffset(int scrollOffset)
 
             renderOffset = adjustRenderOffset((selectionEndIndex + 1) * rowHeight + titleHeight - rect().height());
 
+            updateVisibleItems();
             repaint();
         }
     }
@@ -1150,15 +1193,21 @@ QList<ListItem*> ListView::getSearchItems(QList<ListItem*> items)
     if (searchContent == "" || searchAlgorithm == NULL) {
         return items;
     } else {
-        QList<ListItem*> *searchItems = new QList<ListItem*>();
+        QList<ListItem*> searchItems;
 
+        // Children of a matching item are shown with it.
         for (ListItem *item : items) {
-            if (searchAlgorithm(item, searchContent)) {
-                searchItems->append(item);
+            ListItem *matchItem = item;
+            while (matchItem != NULL && !searchAlgorithm(matchItem, searchContent)) {
+                matchItem = matchItem->getParentItem();
+            }
+
+            if (matchItem != NULL) {
+                searchItems.append(item);
             }
         }
 
-        return *searchItems;
+        return searchItems;
     }
 }
 
@@ -1172,6 +1221,95 @@ int ListView::getBottomRenderOffset()
     }
 }
 
+void ListView::groupChildItems()
+{
+    // Collect children in current order, so siblings keep the sort order among themselves.
+    QHash<ListItem*, QList<ListItem*>> childItems;
+    for (ListItem *item : *renderItems) {
+        if (item->getParentItem() != NULL) {
+            childItems[item->getParentItem()].append(item);
+        }
+    }
+
+    // Parents that aren't rendered are reset too, so hasChildren() tells whether an item's parent is rendered.
+    for (auto parent = childItems.begin(); parent != childItems.end(); ++parent) {
+        parent.key()->setHasChildren(false);
+    }
+    for (ListItem *item : *renderItems) {
+        item->setHasChildren(childItems.contains(item));
+    }
+
+    if (childItems.isEmpty()) {
+        return;
+    }
+
+    // Walk from top level items with a stack, process trees can be deep. Children of collapsed items are left out,
+    // children whose parent isn't rendered (such as search matches under a parent that doesn't match) are top level.
+    QList<ListItem*> items;
+    QList<ListItem*> stack;
+    items.reserve(renderItems->count());
+    for (ListItem *item : *renderItems) {
+        if (item->getParentItem() != NULL && item->getParentItem()->hasChildren()) {
+            continue;
+        }
+
+        stack.append(item);
+        while (!stack.isEmpty()) {
+            ListItem *top = stack.takeLast();
+            items.append(top);
+
+            auto children = childItems.find(top);
+            if (children != childItems.end() && !top->isCollapsed()) {
+                // Pushed backwards to come off the stack in order.
+                for (int i = children.value().count() - 1; i >= 0; i--) {
+                    stack.append(children.value()[i]);
+                }
+            }
+        }
+    }
+
+    renderItems->swap(items);
+}
+
+void ListView::setItemsCollapsed(QList<ListItem*> items, bool collapsed)
+{
+    bool changed = false;
+    for (ListItem *item : items) {
+        if (item->hasChildren() && item->isCollapsed() != collapsed) {
+            item->setCollapsed(collapsed);
+            changed = true;
+        }
+    }
+
+    if (!changed) {
+        return;
+    }
+
+    updateRenderItems();
+
+    // Rows hidden under a collapsed item can't stay selected, the walk stops at parents that aren't rendered.
+    auto isHidden = [](ListItem *item) {
+        for (ListItem *parent = item->getParentItem(); parent != NULL && parent->hasChildren(); parent = parent->getParentItem()) {
+            if (parent->isCollapsed()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    auto dropHidden = [&](ListItem *item) {
+        return isHidden(item) && selectionSet.remove(item);
+    };
+    selectionItems->erase(std::remove_if(selectionItems->begin(), selectionItems->end(), dropHidden), selectionItems->end());
+    if (lastSelectItem != NULL && isHidden(lastSelectItem)) {
+        lastSelectItem = NULL;
+    }
+
+    renderOffset = adjustRenderOffset(renderOffset);
+
+    updateVisibleItems();
+    repaint();
+}
+
 void ListView::sortItemsByColumn(int column, bool descendingSort)
 {
     if (sortingAlgorithms->count() != 0 && sortingAlgorithms->count() == columnTitles.count() && sortingOrderes->count() == columnTitles.count()) {
@@ -1179,6 +1317,46 @@ void ListView::sortItemsByColumn(int column, bool descendingSort)
                 return (*sortingAlgorithms)[column](item1, item2, descendingSort);
             });
     }
+
+    groupChildItems();
+}
+
+void ListView::updateRenderItems()
+{
+    // Always start from every item, so children hidden under a collapsed item are grouped and counted too.
+    renderItems->clear();
+    renderItems->append(getSearchItems(*listItems));
+
+    if (defaultSortingColumn != -1) {
+        sortItemsByColumn(defaultSortingColumn, defaultSortingOrder);
+    } else {
+        groupChildItems();
+    }
+}
+
+void ListView::updateVisibleItems()
+{
+    if (!isVisible()) {
+        return;
+    }
+
+    // Rows painted with the current offset, see paintEvent.
+    QList<ListItem*> items;
+    int firstRow = std::max(0, renderOffset / rowHeight);
+    for (int rowCounter = firstRow; rowCounter < renderItems->count(); rowCounter++) {
+        if (titleHeight + rowCounter * rowHeight - renderOffset >= rect().height()) {
+            break;
+        }
+        items << (*renderItems)[rowCounter];
+    }
+
+    // Tell whoever loads details lazily which rows need them now.
+    if (items != visibleItems || *selectionItems != visibleSelectionItems) {
+        visibleItems = items;
+        visibleSelectionItems = *selectionItems;
+
+        visibleItemsChanged(visibleItems, visibleSelectionItems);
+    }
 }
 
 void ListView::startScrollAnimation()
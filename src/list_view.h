@@ -26,6 +26,8 @@
 
 #include "list_item.h"
 #include <QImage>
+#include <QPainterPath>
+#include <QSet>
 #include <QTimer>
 #include <QWidget>
 
@@ -128,13 +130,14 @@ public:
     void clearSelections(bool clearLastSelection=true);
     
     /*
-     * Refresh all items in ListView.
-     * This function is different that addItems is: it will clear items first before add new items.
-     * This function will keep selection status and scroll offset when add items.
+     * Update items in ListView.
+     * Items that are still alive keep their pointer and are changed in place by the caller,
+     * so only births and deaths are passed here, selection status and scroll offset are kept.
      * 
-     * @items List of ListItem* to add
+     * @newItems List of ListItem* to add
+     * @removedItems List of ListItem* to remove, ListView deletes them
      */
-    void refreshItems(QList<ListItem*> items);
+    void updateItems(QList<ListItem*> newItems, QList<ListItem*> removedItems);
     
     /*
      * Search
@@ -170,6 +173,15 @@ signals:
     void pressSearchKey();
     void rightClickItems(QPoint pos, QList<ListItem*> items);
     
+    /*
+     * Rows on screen or selection changed, emitted when items, selection, scrolling or size change,
+     * never while the view is hidden. Items are only valid while the signal is handled, connect it directly.
+     * 
+     * @items items drawn on screen
+     * @selectedItems items selected, on screen or not
+     */
+    void visibleItemsChanged(QList<ListItem*> items, QList<ListItem*> selectedItems);
+    
 private slots:
     void scrollAnimation();
     void hideScrollbar();
@@ -182,8 +194,10 @@ private:
     void mouseReleaseEvent(QMouseEvent *mouseEvent);
     void paintEvent(QPaintEvent *);
     void paintScrollbar(QPainter *painter);
+    void resizeEvent(QResizeEvent *event);
     void selectNextItemWithOffset(int scrollOffset);
     void selectPrevItemWithOffset(int scrollOffset);
+    void showEvent(QShowEvent *event);
     void shiftSelectItemsWithBound(int selectionStartIndex, int selectionEndIndex);
     void shiftSelectNextItemWithOffset(int scrollOffset);
     void shiftSelectPrevItemWithOffset(int scrollOffset);
@@ -200,9 +214,13 @@ private:
     int getScrollbarHeight();
     int getScrollbarY();
     int getTopRenderOffset();
+    void groupChildItems();
+    void setItemsCollapsed(QList<ListItem*> items, bool collapsed);
     void sortItemsByColumn(int column, bool descendingSort);
     void startScrollAnimation();
     void startScrollbarHideTimer();
+    void updateRenderItems();
+    void updateVisibleItems();
     
     ListItem *lastSelectItem;
     QImage arrowDownImage;
@@ -210,12 +228,18 @@ private:
     QList<ListItem*> *listItems;
     QList<ListItem*> *renderItems;
     QList<ListItem*> *selectionItems;
+    QList<ListItem*> visibleItems;
+    QList<ListItem*> visibleSelectionItems;
     QList<QString> columnTitles;
     QList<SortAlgorithm> *sortingAlgorithms;
     QList<bool> *sortingOrderes;
     QList<bool> columnToggleHideFlags;
     QList<bool> columnVisibles;
     QList<int> columnWidths;
+    QSet<ListItem*> selectionSet;
+    QPainterPath clipPath;
+    QPainterPath scrollAreaClipPath;
+    QSize clipPathSize;
     QString searchContent;
     QTimer *hideScrollbarTimer;
     QTimer *scrollAnimationTimer;
@@ -24,19 +24,110 @@
 #include <DApplication>
 #include <DMainWindow>
 #include <QApplication>
+#include <QCoreApplication>
 #include <QDesktopWidget>
 #include <dutility.h>
 
 #include "utils.h"
 #include "main_window.h"
 #include "network_traffic_filter.h"
+#include "snapshot_recording.h"
+#include "snapshot_ring.h"
+#include "status_sampler.h"
 #include <iostream>
+#include <signal.h>
+#include <string.h>
 #include <thread>
 
 DWIDGET_USE_NAMESPACE
 
+// Milliseconds between two samples without a window, the same as the window's.
+static const int HEADLESS_INTERVAL = 2000;
+
+/*
+ * Sample every process without a display.
+ *
+ * @collector publish into shared memory, meant to run as root so viewers started by any user see what only root may read
+ * @recordFile append every sample to this recording, empty to record nothing
+ */
+static int runHeadless(int argc, char *argv[], bool collector, QString recordFile)
+{
+    // Blocked before any thread starts, so only the signal thread below takes them.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    QCoreApplication app(argc, argv);
+
+    SnapshotRing *ring = nullptr;
+    if (collector) {
+        ring = SnapshotRing::create(HEADLESS_INTERVAL);
+        if (ring == nullptr) {
+            std::cerr << "Another collector is running, the collector isn't run as root, or shared memory can't be created." << std::endl;
+            return 1;
+        }
+    }
+
+    SnapshotRecorder *recorder = nullptr;
+    if (!recordFile.isEmpty()) {
+        recorder = SnapshotRecorder::open(recordFile);
+        if (recorder == nullptr) {
+            std::cerr << "Can't record into " << recordFile.toStdString() << "." << std::endl;
+            delete ring;
+            return 1;
+        }
+    }
+
+    // Quit the event loop from a thread of its own, a signal handler can't safely.
+    std::thread signal_thread([&app, signals]() {
+        int signal;
+        sigwait(&signals, &signal);
+        QMetaObject::invokeMethod(&app, "quit", Qt::QueuedConnection);
+    });
+    signal_thread.detach();
+
+    NetworkTrafficFilter::startNethogsMonitor();
+
+    StatusSampler sampler(HEADLESS_INTERVAL);
+    sampler.setHeadless();
+    sampler.setPublishRing(ring);
+    sampler.setRecorder(recorder);
+    sampler.start();
+
+    int result = app.exec();
+
+    // Viewers notice the segment going stale and sample on their own again, capturing traffic included.
+    sampler.stop();
+    delete recorder;
+    delete ring;
+
+    return result;
+}
+
 int main(int argc, char *argv[]) 
 {
+    bool collector = false;
+    bool replayMaxSpeed = false;
+    QString recordFile;
+    QString replayFile;
+    for (int index = 1; index < argc; index++) {
+        if (strcmp(argv[index], "--collector") == 0) {
+            collector = true;
+        } else if (strcmp(argv[index], "--record") == 0 && index + 1 < argc) {
+            recordFile = QString::fromLocal8Bit(argv[++index]);
+        } else if (strcmp(argv[index], "--replay") == 0 && index + 1 < argc) {
+            replayFile = QString::fromLocal8Bit(argv[++index]);
+        } else if (strcmp(argv[index], "--max-speed") == 0) {
+            replayMaxSpeed = true;
+        }
+    }
+
+    if (collector || !recordFile.isEmpty()) {
+        return runHeadless(argc, argv, collector, recordFile);
+    }
+
     DApplication::loadDXcbPlugin();
     
     const char *descriptionText = QT_TRANSLATE_NOOP("MainWindow", 
@@ -49,7 +140,8 @@ int main(int argc, char *argv[])
 
     DApplication app(argc, argv);
 
-    if (app.setSingleInstance("deepin-system-monitor")) {
+    // A replay doesn't get in the way of the window watching the live system.
+    if (!replayFile.isEmpty() || app.setSingleInstance("deepin-system-monitor")) {
         app.loadTranslator();
         
         app.setOrganizationName("deepin");
@@ -64,9 +156,13 @@ int main(int argc, char *argv[])
         app.setTheme("dark");
         app.setWindowIcon(QIcon(Utils::getQrcPath("deepin-system-monitor.svg")));
         
-        std::thread nethogs_monitor_thread(&NetworkTrafficFilter::nethogsMonitorThreadProc);
+        // A running collector captures traffic for every viewer, capturing needs privileges the window shouldn't have.
+        // The sampler starts capturing itself should the collector stop later on.
+        if (replayFile.isEmpty() && !SnapshotRing::isCollectorRunning()) {
+            NetworkTrafficFilter::startNethogsMonitor();
+        }
 
-        MainWindow window;
+        MainWindow window(replayFile, replayMaxSpeed);
         
         window.setMinimumSize(QSize(1024, 700));
         DUtility::moveToCenter(&window);
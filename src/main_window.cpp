@@ -25,6 +25,7 @@
 #include <QStyleFactory>
 #include <QApplication>
 #include <QDesktopWidget>
+#include <QWindow>
 #include <QDebug>
 #include <signal.h>
 
@@ -32,9 +33,10 @@
 #include <iostream>
 using namespace std;
 
-MainWindow::MainWindow(DMainWindow *parent) : DMainWindow(parent)
+MainWindow::MainWindow(QString replayFile, bool replayMaxSpeed, DMainWindow *parent) : DMainWindow(parent)
 {
     installEventFilter(this);   // add event filter
+    exposeFilterInstalled = false;
 
     if (this->titlebar()) {
         toolbar = new Toolbar();
@@ -44,6 +46,9 @@ MainWindow::MainWindow(DMainWindow *parent) : DMainWindow(parent)
         killAction = new QAction("结束应用程序", this);
         connect(killAction, &QAction::triggered, this, &MainWindow::showWindowKiller);
         menu->addAction(killAction);
+        treeAction = new QAction("树状显示进程", this);
+        treeAction->setCheckable(true);
+        menu->addAction(treeAction);
         menu->addSeparator();
 
         this->titlebar()->setCustomWidget(toolbar, Qt::AlignVCenter, false);
@@ -55,18 +60,21 @@ MainWindow::MainWindow(DMainWindow *parent) : DMainWindow(parent)
         this->setCentralWidget(layoutWidget);
 
         processManager = new ProcessManager();
-        statusMonitor = new StatusMonitor();
+        statusMonitor = new StatusMonitor(replayFile, replayMaxSpeed);
+
+        treeAction->setChecked(statusMonitor->isTreeMode());
+        connect(treeAction, &QAction::toggled, statusMonitor, &StatusMonitor::setTreeMode);
 
         connect(processManager, &ProcessManager::activeTab, this, &MainWindow::switchTab);
         connect(processManager, &ProcessManager::pressSearchKey, toolbar, &Toolbar::focusInput);
+        connect(processManager, &ProcessManager::toggleThreads, statusMonitor, &StatusMonitor::toggleThreads);
+        connect(processManager, &ProcessManager::visiblePidsChanged, statusMonitor, &StatusMonitor::setVisiblePids);
 
         connect(statusMonitor, &StatusMonitor::updateProcessStatus, processManager, &ProcessManager::updateStatus, Qt::QueuedConnection);
         connect(statusMonitor, &StatusMonitor::updateProcessNumber, processManager, &ProcessManager::updateProcessNumber, Qt::QueuedConnection);
 
         connect(toolbar, &Toolbar::search, processManager, &ProcessManager::handleSearch, Qt::QueuedConnection);
 
-        statusMonitor->updateStatus();
-
         layout->addWidget(statusMonitor);
         layout->addWidget(processManager);
 
@@ -89,6 +97,16 @@ MainWindow::~MainWindow()
 
 bool MainWindow::eventFilter(QObject *, QEvent *event)
 {
+    // Expose events only reach the native window, they tell when it is unmapped on another workspace.
+    if (event->type() == QEvent::Show && windowHandle() != NULL && !exposeFilterInstalled) {
+        windowHandle()->installEventFilter(this);
+        exposeFilterInstalled = true;
+    }
+
+    if (event->type() == QEvent::Show || event->type() == QEvent::Hide || event->type() == QEvent::Expose || event->type() == QEvent::WindowStateChange) {
+        statusMonitor->setWindowVisible(isVisible() && !isMinimized() && (windowHandle() == NULL || windowHandle()->isExposed()));
+    }
+
     if (event->type() == QEvent::WindowStateChange) {
         QRect rect = QApplication::desktop()->screenGeometry();
         
@@ -155,7 +173,9 @@ void MainWindow::switchTab(int index)
         statusMonitor->switchToOnlyGui();
     } else if (index == 1) {
         statusMonitor->switchToOnlyMe();
-    } else {
+    } else if (index == 2) {
         statusMonitor->switchToAllProcess();
+    } else {
+        statusMonitor->switchToServices();
     }
 }
@@ -41,7 +41,11 @@ class MainWindow : public DMainWindow
     Q_OBJECT
     
 public:
-    MainWindow(DMainWindow *parent = 0);
+    /*
+     * @replayFile recording to show instead of the live system, empty to sample
+     * @replayMaxSpeed play the recording as fast as the window keeps up
+     */
+    MainWindow(QString replayFile = QString(), bool replayMaxSpeed = false, DMainWindow *parent = 0);
     ~MainWindow();
                                        
     bool eventFilter(QObject *, QEvent *);
@@ -59,11 +63,13 @@ private:
     InteractiveKill *killer;
     ProcessManager *processManager;
     QAction *killAction;
+    QAction *treeAction;
     QHBoxLayout *layout;
     QMenu *menu;
     QWidget *layoutWidget;
     StatusMonitor *statusMonitor;
     Toolbar *toolbar;
+    bool exposeFilterInstalled;
     int killPid;
 };
 
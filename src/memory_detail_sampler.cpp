@@ -0,0 +1,174 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "memory_detail_sampler.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_set>
+
+MemoryDetailSampler::MemoryDetailSampler(int ttl) : ttl(ttl)
+{
+    stopping = false;
+
+    worker = std::thread(&MemoryDetailSampler::workerLoop, this);
+}
+
+MemoryDetailSampler::~MemoryDetailSampler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_one();
+
+    worker.join();
+}
+
+void MemoryDetailSampler::request(const std::vector<Request> &newRequests)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests = newRequests;
+
+        // Drop expired values of processes nobody looks at any more, requested ones are read again instead.
+        std::unordered_set<pid_t> requestedPids;
+        for (const Request &request : requests) {
+            requestedPids.insert(request.pid);
+        }
+
+        Clock::time_point now = Clock::now();
+        for (auto detail = details.begin(); detail != details.end();) {
+            if (detail->second.readTime + ttl <= now && requestedPids.count(detail->first) == 0) {
+                detail = details.erase(detail);
+            } else {
+                ++detail;
+            }
+        }
+    }
+    condition.notify_one();
+}
+
+bool MemoryDetailSampler::find(pid_t pid, unsigned long long startTime, MemoryDetail &detail)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto cached = details.find(pid);
+    if (cached == details.end() || cached->second.startTime != startTime || !cached->second.valid) {
+        return false;
+    }
+
+    detail = cached->second.detail;
+    return true;
+}
+
+bool MemoryDetailSampler::readProcess(pid_t pid, MemoryDetail &detail)
+{
+    char path[40];
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+
+    // smaps_rollup came with Linux 4.14, smaps has the same fields once per mapping.
+    FILE *file = fopen(path, "re");
+    if (file == nullptr) {
+        snprintf(path, sizeof(path), "/proc/%d/smaps", pid);
+        file = fopen(path, "re");
+    }
+    if (file == nullptr) {
+        return false;
+    }
+
+    // Values are in kB.
+    long pss = 0;
+    long privateClean = 0;
+    long privateDirty = 0;
+    bool found = false;
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        if (strncmp(line, "Pss:", 4) == 0) {
+            pss += strtol(line + 4, nullptr, 10);
+            found = true;
+        } else if (strncmp(line, "Private_Clean:", 14) == 0) {
+            privateClean += strtol(line + 14, nullptr, 10);
+        } else if (strncmp(line, "Private_Dirty:", 14) == 0) {
+            privateDirty += strtol(line + 14, nullptr, 10);
+        }
+    }
+    fclose(file);
+
+    // Kernel threads have no mappings at all.
+    if (!found) {
+        return false;
+    }
+
+    detail.pss = pss * 1024;
+    detail.uss = (privateClean + privateDirty) * 1024;
+
+    return true;
+}
+
+bool MemoryDetailSampler::isFresh(const Request &request, Clock::time_point now) const
+{
+    auto cached = details.find(request.pid);
+    return cached != details.end() && cached->second.startTime == request.startTime && cached->second.readTime + ttl > now;
+}
+
+void MemoryDetailSampler::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!stopping) {
+        Clock::time_point now = Clock::now();
+
+        // Read the first requested process without a fresh value, or sleep until the next one expires.
+        auto next = std::find_if(requests.begin(), requests.end(),
+                                 [this, now](const Request &request) { return !isFresh(request, now); });
+        if (next == requests.end()) {
+            if (requests.empty()) {
+                condition.wait(lock);
+            } else {
+                Clock::time_point wakeTime = Clock::time_point::max();
+                for (const Request &request : requests) {
+                    wakeTime = std::min(wakeTime, details[request.pid].readTime + ttl);
+                }
+                condition.wait_until(lock, wakeTime);
+            }
+            continue;
+        }
+
+        Request request = *next;
+
+        // Reading may take a while for big processes, requests can be replaced meanwhile.
+        lock.unlock();
+        MemoryDetail detail;
+        bool valid = readProcess(request.pid, detail);
+        lock.lock();
+
+        CachedDetail &cached = details[request.pid];
+        cached.startTime = request.startTime;
+        cached.detail = detail;
+        cached.readTime = Clock::now();
+        cached.valid = valid;
+    }
+}
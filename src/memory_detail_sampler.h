@@ -0,0 +1,108 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEMORYDETAILSAMPLER_H
+#define MEMORYDETAILSAMPLER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Memory of a process with shared pages accounted for.
+ */
+struct MemoryDetail
+{
+    long pss;                           // proportional set size in bytes, shared pages split between their users
+    long uss;                           // unique set size in bytes, pages no other process maps
+};
+
+/**
+ * MemoryDetailSampler reads PSS and USS from /proc/pid/smaps_rollup on a worker thread of its own.
+ *
+ * The kernel walks every mapping of a process to produce those numbers, which is far too slow to do
+ * for all processes on every tick. Callers only request the processes the user can see, the worker
+ * reads the ones it has no fresh value for and keeps results for ttl milliseconds, so a value read
+ * once is shown at once when its row scrolls back into view.
+ */
+class MemoryDetailSampler final
+{
+public:
+    struct Request
+    {
+        pid_t pid;
+        unsigned long long startTime;   // tells a reused pid from the process that was read
+    };
+
+    /*
+     * @ttl milliseconds a value is kept before it's read again
+     */
+    MemoryDetailSampler(int ttl = 10000);
+    ~MemoryDetailSampler();
+
+    /*
+     * Replace the processes to keep up to date, earlier ones are read first.
+     * Values of processes that are no longer requested stay cached until they expire.
+     */
+    void request(const std::vector<Request> &requests);
+
+    /*
+     * Take the last value read for a process, safe to call from any thread.
+     *
+     * @return false if the process wasn't read yet or couldn't be read
+     */
+    bool find(pid_t pid, unsigned long long startTime, MemoryDetail &detail);
+
+    /*
+     * Read a process now, from smaps_rollup or by summing smaps on kernels without it.
+     */
+    static bool readProcess(pid_t pid, MemoryDetail &detail);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct CachedDetail
+    {
+        unsigned long long startTime;
+        MemoryDetail detail;
+        Clock::time_point readTime;
+        bool valid;                     // false when the read failed, it is tried again once expired
+    };
+
+    bool isFresh(const Request &request, Clock::time_point now) const;
+    void workerLoop();
+
+    std::chrono::milliseconds ttl;
+    std::unordered_map<pid_t, CachedDetail> details;
+    std::vector<Request> requests;
+    std::condition_variable condition;
+    std::mutex mutex;
+    std::thread worker;
+    bool stopping;
+};
+
+#endif
@@ -78,8 +78,13 @@ void MemoryMonitor::updateStatus(long uMemory, long tMemory, long uSwap, long tS
         usedSwap = uSwap;
         totalSwap = tSwap;
 
-        animationIndex = 0;
-        timer->start(30);
+        // Jump to the new values while hidden, animating them would only wake the timer for nothing.
+        if (updatesEnabled()) {
+            animationIndex = 0;
+            timer->start(30);
+        } else {
+            animationIndex = animationFrames;
+        }
     }
 }
 
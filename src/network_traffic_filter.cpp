@@ -23,10 +23,12 @@
 
 #include "network_traffic_filter.h"
 #include <string.h>
+#include <thread>
 
 std::mutex NetworkTrafficFilter::m_mutex;
 NetworkTrafficFilter::RowUpdatesMap NetworkTrafficFilter::m_row_updates_map;
 int NetworkTrafficFilter::m_nethogs_monitor_status = NETHOGS_STATUS_OK;
+std::once_flag NetworkTrafficFilter::m_monitor_started;
 
 bool NetworkTrafficFilter::getRowUpdate(NetworkTrafficFilter::Update& update)
 {
@@ -70,6 +72,15 @@ void NetworkTrafficFilter::nethogsMonitorThreadProc()
 	NetworkTrafficFilter::setNetHogsMonitorStatus(status);
 }
 
+void NetworkTrafficFilter::startNethogsMonitor()
+{
+	// nethogs keeps global state, a second capture loop would share it.
+	std::call_once(m_monitor_started, []() {
+		std::thread nethogs_monitor_thread(&NetworkTrafficFilter::nethogsMonitorThreadProc);
+		nethogs_monitor_thread.detach();
+	});
+}
+
 void NetworkTrafficFilter::onNethogsUpdate(int action, NethogsMonitorRecord const* update)
 {
 	NetworkTrafficFilter::setRowUpdate(action, *update);
@@ -44,6 +44,7 @@ public:
 	static void setNetHogsMonitorStatus(int status);
 	static void setRowUpdate(int action, NethogsMonitorRecord const& record);
     static void nethogsMonitorThreadProc();
+    static void startNethogsMonitor();
     static void onNethogsUpdate(int action, NethogsMonitorRecord const* update);
     
 private:
@@ -51,6 +52,7 @@ private:
 	static RowUpdatesMap m_row_updates_map;
 	static int m_nethogs_monitor_status;
 	static std::mutex m_mutex;
+	static std::once_flag m_monitor_started;
 };
 
 #endif // NETWORKTRAFFICFILTER_H
@@ -0,0 +1,167 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pid_state_table.h"
+#include <string.h>
+
+PidStateTable::PidStateTable(size_t capacity)
+{
+    size_t size = 16;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    slots.assign(size, PidState());
+    memset(slots.data(), 0, sizeof(PidState) * size);
+    mask = size - 1;
+    occupiedNumber = 0;
+    generation = 0;
+}
+
+void PidStateTable::beginGeneration()
+{
+    generation++;
+
+    // Generation 0 marks empty slots, skip it (and its neighbour) when the counter wraps.
+    if (generation < 2) {
+        for (PidState &state : slots) {
+            state.generation = 0;
+        }
+        occupiedNumber = 0;
+        generation = 2;
+    }
+}
+
+PidState* PidStateTable::touch(pid_t pid, unsigned long long startTime, bool *created)
+{
+    // Keep load factor (stale entries included) under 3/4.
+    if ((occupiedNumber + 1) * 4 > slots.size() * 3) {
+        rehash(slots.size());
+    }
+
+    PidState *reusable = nullptr;
+    size_t index = hashKey(pid, startTime);
+    while (true) {
+        PidState &state = slots[index];
+
+        if (state.generation == 0) {
+            if (reusable == nullptr) {
+                reusable = &state;
+                occupiedNumber++;
+            }
+            break;
+        } else if (isStale(state)) {
+            if (reusable == nullptr) {
+                reusable = &state;
+            }
+        } else if (state.pid == pid && state.startTime == startTime) {
+            state.generation = generation;
+            if (created != nullptr) {
+                *created = false;
+            }
+
+            return &state;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    memset(reusable, 0, sizeof(PidState));
+    reusable->pid = pid;
+    reusable->startTime = startTime;
+    reusable->generation = generation;
+    if (created != nullptr) {
+        *created = true;
+    }
+
+    return reusable;
+}
+
+PidState* PidStateTable::find(pid_t pid, unsigned long long startTime)
+{
+    size_t index = hashKey(pid, startTime);
+    while (slots[index].generation != 0) {
+        PidState &state = slots[index];
+        if (state.pid == pid && state.startTime == startTime && !isStale(state)) {
+            return &state;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    return nullptr;
+}
+
+unsigned int PidStateTable::currentGeneration() const
+{
+    return generation;
+}
+
+bool PidStateTable::isStale(const PidState &state) const
+{
+    return state.generation + 1 < generation;
+}
+
+size_t PidStateTable::hashKey(pid_t pid, unsigned long long startTime) const
+{
+    uint64_t key = static_cast<uint64_t>(pid) * 0x9E3779B97F4A7C15ULL ^ startTime * 0xC2B2AE3D27D4EB4FULL;
+    key ^= key >> 29;
+
+    return static_cast<size_t>(key) & mask;
+}
+
+void PidStateTable::rehash(size_t capacity)
+{
+    std::vector<PidState> oldSlots;
+    oldSlots.swap(slots);
+
+    size_t liveNumber = 0;
+    for (const PidState &state : oldSlots) {
+        if (state.generation != 0 && !isStale(state)) {
+            liveNumber++;
+        }
+    }
+
+    // Grow only when live entries alone would fill half of the table.
+    size_t size = capacity;
+    while (liveNumber * 2 > size) {
+        size <<= 1;
+    }
+
+    slots.assign(size, PidState());
+    memset(slots.data(), 0, sizeof(PidState) * size);
+    mask = size - 1;
+    occupiedNumber = 0;
+
+    for (const PidState &state : oldSlots) {
+        if (state.generation != 0 && !isStale(state)) {
+            size_t index = hashKey(state.pid, state.startTime);
+            while (slots[index].generation != 0) {
+                index = (index + 1) & mask;
+            }
+
+            slots[index] = state;
+            occupiedNumber++;
+        }
+    }
+}
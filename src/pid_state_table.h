@@ -0,0 +1,102 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIDSTATETABLE_H
+#define PIDSTATETABLE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * Counters remembered from the previous tick for one process.
+ * A process is identified by (pid, startTime) so a reused pid starts from a fresh state.
+ */
+struct PidState
+{
+    pid_t pid;
+    unsigned long long startTime;
+    unsigned int generation;            // last generation this entry was touched in, 0 means empty slot
+    bool hasIO;                         // readBytes and writeBytes are valid
+    bool taskstatsIO;                   // readBytes and writeBytes came from taskstats, not /proc/pid/io
+    unsigned long long cpuTime;         // utime + stime
+    unsigned long readBytes;            // rchar
+    unsigned long writeBytes;           // wchar
+    long long ioTime;                   // sampler clock in milliseconds when readBytes and writeBytes were read
+    unsigned long long exitedCpuTime;   // exit records of threads that ended while the process was sampled, microseconds
+    unsigned long long exitedReadBytes;
+    unsigned long long exitedWriteBytes;
+    float readKbs;                      // last disk rates, shown while reading them again is skipped
+    float writeKbs;
+    uint32_t sentBytes;
+    uint32_t recvBytes;
+};
+
+/**
+ * Open-addressing (linear probing) table of PidState.
+ *
+ * Every tick starts a new generation and touches the processes it sees. Entries that were not
+ * touched in the current or previous generation are stale: lookups skip them, inserts reuse their
+ * slots and rehashing drops them, so dead pids never need an explicit cleanup pass.
+ *
+ * Pointers returned by touch() and find() are only valid until the next touch().
+ */
+class PidStateTable final
+{
+public:
+    PidStateTable(size_t capacity = 1024);
+
+    /*
+     * Start a new tick, entries not touched in this or the previous tick become stale.
+     */
+    void beginGeneration();
+
+    /*
+     * Find the state of a process, inserting a zeroed entry if it's not known yet.
+     *
+     * @created set to true if the entry is new, counters of a new entry are zero
+     * @return the entry, stamped with the current generation
+     */
+    PidState* touch(pid_t pid, unsigned long long startTime, bool *created = nullptr);
+
+    /*
+     * Find the state of a process without inserting.
+     *
+     * @return the entry or nullptr if the process is unknown or stale
+     */
+    PidState* find(pid_t pid, unsigned long long startTime);
+
+    unsigned int currentGeneration() const;
+
+private:
+    bool isStale(const PidState &state) const;
+    size_t hashKey(pid_t pid, unsigned long long startTime) const;
+    void rehash(size_t capacity);
+
+    std::vector<PidState> slots;
+    size_t mask;
+    size_t occupiedNumber;
+    unsigned int generation;
+};
+
+#endif
@@ -0,0 +1,170 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline_profiler.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+PipelineProfiler::Timer::Timer(PipelineProfiler *timerProfiler, Stage timerStage)
+{
+    profiler = timerProfiler;
+    stage = timerStage;
+    itemNumber = 0;
+    startTime = profiler != nullptr ? PipelineProfiler::now() : 0;
+}
+
+PipelineProfiler::Timer::~Timer()
+{
+    if (profiler != nullptr) {
+        profiler->add(stage, PipelineProfiler::now() - startTime, itemNumber);
+    }
+}
+
+void PipelineProfiler::Timer::setItemNumber(size_t number)
+{
+    itemNumber = number;
+}
+
+PipelineProfiler::PipelineProfiler()
+{
+    memset(histograms, 0, sizeof(histograms));
+    memset(tickDurations, 0, sizeof(tickDurations));
+    memset(tickItemNumbers, 0, sizeof(tickItemNumbers));
+    memset(tickStages, 0, sizeof(tickStages));
+}
+
+void PipelineProfiler::add(Stage stage, int64_t duration, size_t itemNumber)
+{
+    tickDurations[stage] += duration;
+    tickItemNumbers[stage] += itemNumber;
+    tickStages[stage] = true;
+}
+
+void PipelineProfiler::endTick()
+{
+    for (int stage = 0; stage < StageNumber; stage++) {
+        if (!tickStages[stage]) {
+            continue;
+        }
+
+        Histogram &histogram = histograms[stage];
+        histogram.buckets[bucketIndex(tickDurations[stage])]++;
+        histogram.count++;
+        histogram.itemNumber += tickItemNumbers[stage];
+        if (tickDurations[stage] > histogram.maximum) {
+            histogram.maximum = tickDurations[stage];
+        }
+
+        tickDurations[stage] = 0;
+        tickItemNumbers[stage] = 0;
+        tickStages[stage] = false;
+    }
+}
+
+std::string PipelineProfiler::takeReport()
+{
+    std::string report;
+    char field[96];
+
+    for (int stage = 0; stage < StageNumber; stage++) {
+        const Histogram &histogram = histograms[stage];
+        if (histogram.count == 0) {
+            continue;
+        }
+
+        snprintf(field, sizeof(field), "%s%s %lld/%lld/%lld (%llu)",
+                 report.empty() ? "" : ", ",
+                 stageName(static_cast<Stage>(stage)),
+                 static_cast<long long>(percentile(histogram, 0.5) / 1000),
+                 static_cast<long long>(percentile(histogram, 0.99) / 1000),
+                 static_cast<long long>(histogram.maximum / 1000),
+                 static_cast<unsigned long long>(histogram.itemNumber / histogram.count));
+        report += field;
+    }
+
+    memset(histograms, 0, sizeof(histograms));
+
+    return report;
+}
+
+const char* PipelineProfiler::stageName(Stage stage)
+{
+    static const char *names[StageNumber] = {
+        "read", "desktop", "titles", "identity", "rows", "threads",
+        "io", "exits", "memory", "network", "merge", "tree", "services", "publish", "tick"
+    };
+
+    return names[stage];
+}
+
+int64_t PipelineProfiler::now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    // Nanoseconds.
+    return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+int PipelineProfiler::bucketIndex(int64_t value)
+{
+    if (value < EXACT_BUCKET_NUMBER) {
+        return value < 0 ? 0 : static_cast<int>(value);
+    }
+
+    // Position of the highest bit picks the power of two, the next bits the bucket inside it.
+    int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+    int subBucket = static_cast<int>((value >> (exponent - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1));
+
+    return EXACT_BUCKET_NUMBER + (exponent - 4) * (1 << SUB_BUCKET_BITS) + subBucket;
+}
+
+int64_t PipelineProfiler::bucketValue(int index)
+{
+    if (index < EXACT_BUCKET_NUMBER) {
+        return index;
+    }
+
+    int exponent = (index - EXACT_BUCKET_NUMBER) / (1 << SUB_BUCKET_BITS) + 4;
+    int subBucket = (index - EXACT_BUCKET_NUMBER) % (1 << SUB_BUCKET_BITS);
+
+    // Middle of the bucket.
+    int64_t lower = (static_cast<int64_t>(1) << exponent) + (static_cast<int64_t>(subBucket) << (exponent - SUB_BUCKET_BITS));
+    return lower + (static_cast<int64_t>(1) << (exponent - SUB_BUCKET_BITS)) / 2;
+}
+
+int64_t PipelineProfiler::percentile(const Histogram &histogram, double fraction)
+{
+    uint64_t rank = static_cast<uint64_t>(fraction * (histogram.count - 1)) + 1;
+    uint64_t seen = 0;
+
+    for (int index = 0; index < BUCKET_NUMBER; index++) {
+        seen += histogram.buckets[index];
+        if (seen >= rank) {
+            return bucketValue(index) < histogram.maximum ? bucketValue(index) : histogram.maximum;
+        }
+    }
+
+    return histogram.maximum;
+}
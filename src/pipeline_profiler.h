@@ -0,0 +1,118 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINEPROFILER_H
+#define PIPELINEPROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * PipelineProfiler records how long every stage of a sampler tick takes, and how many items it handled.
+ *
+ * A stage may be timed several times in one tick (once per process, say), durations and items are
+ * summed until endTick() puts every stage that ran into its histogram. Histograms have a fixed number
+ * of log-linear buckets (8 per power of two, so within 12.5%), recording never allocates.
+ */
+class PipelineProfiler final
+{
+public:
+    enum Stage {
+        ProcessRead,                    // /proc walk and stat/statm/status reads
+        DesktopEntries,                 // desktop file index refresh
+        WindowTitles,                   // X11 window list
+        ProcessIdentity,                // cmdline and desktop file match of new or exec'd processes
+        Rows,                           // building rows, identities and threads included
+        Threads,                        // /proc/pid/task of expanded and busy processes
+        DiskIO,                         // taskstats batch or /proc/pid/io
+        ExitAccounting,                 // taskstats exit records
+        Memory,                         // /proc/meminfo
+        Network,                        // nethogs drain
+        Merge,                          // grouping rows of the same application
+        Tree,                           // parents and subtree totals of rows in tree mode
+        Services,                       // cgroup totals of the services tab
+        Publish,                        // writing the tick into the collector's shared memory
+        Tick,                           // whole tick
+        StageNumber
+    };
+
+    /**
+     * Times one run of a stage for as long as it is in scope.
+     */
+    class Timer final
+    {
+    public:
+        Timer(PipelineProfiler *profiler, Stage stage);
+        ~Timer();
+
+        void setItemNumber(size_t number);
+
+    private:
+        PipelineProfiler *profiler;
+        Stage stage;
+        size_t itemNumber;
+        int64_t startTime;
+    };
+
+    PipelineProfiler();
+
+    void add(Stage stage, int64_t duration, size_t itemNumber);
+
+    /*
+     * Put durations of the stages that ran in this tick into their histograms.
+     */
+    void endTick();
+
+    /*
+     * One line with p50/p99/max in microseconds and average item number of every stage that ran, then start over.
+     */
+    std::string takeReport();
+
+    static const char* stageName(Stage stage);
+    static int64_t now();
+
+private:
+    static const int EXACT_BUCKET_NUMBER = 16;
+    static const int SUB_BUCKET_BITS = 3;
+    static const int BUCKET_NUMBER = EXACT_BUCKET_NUMBER + (64 - 4) * (1 << SUB_BUCKET_BITS);
+
+    struct Histogram
+    {
+        uint32_t buckets[BUCKET_NUMBER];
+        uint64_t count;
+        uint64_t itemNumber;
+        int64_t maximum;
+    };
+
+    static int bucketIndex(int64_t value);
+    static int64_t bucketValue(int index);
+    static int64_t percentile(const Histogram &histogram, double fraction);
+
+    Histogram histograms[StageNumber];
+    int64_t tickDurations[StageNumber];
+    size_t tickItemNumbers[StageNumber];
+    bool tickStages[StageNumber];
+};
+
+#endif
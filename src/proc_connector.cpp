@@ -0,0 +1,258 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "proc_connector.h"
+#include <errno.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// The kernel acknowledges a subscription right away, no answer at all means it ignored us.
+static const int ACK_TIMEOUT = 500;
+
+// Polls between two full /proc walks, in case events stop coming without the socket telling us.
+static const unsigned int RESYNC_POLLS = 60;
+
+static long long monotonicMilliseconds()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000LL + time.tv_nsec / 1000000;
+}
+
+ProcConnector::ProcConnector()
+{
+    socketFd = -1;
+    overrun = false;
+    synced = false;
+    pollsSinceResync = 0;
+}
+
+ProcConnector::~ProcConnector()
+{
+    if (socketFd >= 0) {
+        subscribe(false);
+        close(socketFd);
+    }
+}
+
+bool ProcConnector::start()
+{
+    socketFd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (socketFd < 0) {
+        return false;
+    }
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+
+    // Fork storms queue a lot of events between two ticks, ask for a larger buffer than the default.
+    int bufferSize = 4 * 1024 * 1024;
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    // Binding works in any namespace, but only the init pid and user namespaces get events, and recent kernels
+    // refuse unprivileged listeners. Both only show in the acknowledgement.
+    if (bind(socketFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0 || !subscribe(true) || !waitForAck()) {
+        close(socketFd);
+        socketFd = -1;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool ProcConnector::subscribe(bool listen)
+{
+    char buffer[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))] __attribute__((aligned(NLMSG_ALIGNTO)));
+    memset(buffer, 0, sizeof(buffer));
+
+    struct nlmsghdr *header = reinterpret_cast<struct nlmsghdr*>(buffer);
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = getpid();
+
+    struct cn_msg *message = static_cast<struct cn_msg*>(NLMSG_DATA(header));
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->ack = getpid();
+    message->len = sizeof(enum proc_cn_mcast_op);
+
+    enum proc_cn_mcast_op operation = listen ? PROC_CN_MCAST_LISTEN : PROC_CN_MCAST_IGNORE;
+    memcpy(message->data, &operation, sizeof(operation));
+
+    return send(socketFd, buffer, header->nlmsg_len, 0) == static_cast<ssize_t>(header->nlmsg_len);
+}
+
+bool ProcConnector::waitForAck()
+{
+    char buffer[4096] __attribute__((aligned(NLMSG_ALIGNTO)));
+    long long deadline = monotonicMilliseconds() + ACK_TIMEOUT;
+
+    while (true) {
+        long long remaining = deadline - monotonicMilliseconds();
+        struct pollfd pollFd = {socketFd, POLLIN, 0};
+        if (remaining <= 0 || ::poll(&pollFd, 1, static_cast<int>(remaining)) <= 0) {
+            return false;
+        }
+
+        struct sockaddr_nl address;
+        socklen_t addressLength = sizeof(address);
+        ssize_t length = recvfrom(socketFd, buffer, sizeof(buffer), 0, reinterpret_cast<struct sockaddr*>(&address), &addressLength);
+        if (length < 0 || address.nl_pid != 0) {
+            continue;
+        }
+
+        // Events and acknowledgements of other listeners arrive too, ours answers the ack number we sent plus one.
+        for (struct nlmsghdr *header = reinterpret_cast<struct nlmsghdr*>(buffer);
+             NLMSG_OK(header, static_cast<unsigned int>(length));
+             header = NLMSG_NEXT(header, length)) {
+            struct cn_msg *message = static_cast<struct cn_msg*>(NLMSG_DATA(header));
+            if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP ||
+                message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC ||
+                message->ack != static_cast<__u32>(getpid()) + 1) {
+                continue;
+            }
+
+            const struct proc_event *event = reinterpret_cast<const struct proc_event*>(message->data);
+            if (event->what == proc_event::PROC_EVENT_NONE) {
+                return event->event_data.ack.err == 0;
+            }
+        }
+    }
+}
+
+void ProcConnector::poll()
+{
+    if (socketFd < 0) {
+        return;
+    }
+    pollsSinceResync++;
+
+    char buffer[16384] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+    while (true) {
+        struct sockaddr_nl address;
+        socklen_t addressLength = sizeof(address);
+        ssize_t length = recvfrom(socketFd, buffer, sizeof(buffer), 0, reinterpret_cast<struct sockaddr*>(&address), &addressLength);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == ENOBUFS) {
+                // The kernel dropped events, the live set can't be trusted until the next resync.
+                overrun = true;
+                continue;
+            }
+            break;
+        }
+
+        // Only the kernel may talk to us.
+        if (address.nl_pid != 0) {
+            continue;
+        }
+
+        for (struct nlmsghdr *header = reinterpret_cast<struct nlmsghdr*>(buffer);
+             NLMSG_OK(header, static_cast<unsigned int>(length));
+             header = NLMSG_NEXT(header, length)) {
+            if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP) {
+                continue;
+            }
+
+            struct cn_msg *message = static_cast<struct cn_msg*>(NLMSG_DATA(header));
+            if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) {
+                continue;
+            }
+
+            handleEvent(reinterpret_cast<const struct proc_event*>(message->data));
+        }
+    }
+}
+
+void ProcConnector::handleEvent(const struct proc_event *event)
+{
+    // Threads fork and exit too, only thread group leaders are processes.
+    switch (event->what) {
+    case proc_event::PROC_EVENT_FORK:
+        if (event->event_data.fork.child_pid == event->event_data.fork.child_tgid) {
+            live.insert(event->event_data.fork.child_tgid);
+        }
+        break;
+    case proc_event::PROC_EVENT_EXEC:
+        changed.push_back(event->event_data.exec.process_tgid);
+        break;
+    case proc_event::PROC_EVENT_COMM:
+        changed.push_back(event->event_data.comm.process_tgid);
+        break;
+    case proc_event::PROC_EVENT_UID:
+    case proc_event::PROC_EVENT_GID:
+        // The owner shown for a process is the one of its leader.
+        if (event->event_data.id.process_pid == event->event_data.id.process_tgid) {
+            changed.push_back(event->event_data.id.process_tgid);
+        }
+        break;
+    case proc_event::PROC_EVENT_EXIT:
+        // A leader exiting doesn't end the process, other threads run on after pthread_exit() from main.
+        // Processes stay listed until the sampler fails to read them, as zombies do when /proc is walked.
+        break;
+    default:
+        break;
+    }
+}
+
+void ProcConnector::resync(const std::vector<pid_t> &pids)
+{
+    live.clear();
+    live.insert(pids.begin(), pids.end());
+
+    overrun = false;
+    synced = true;
+    pollsSinceResync = 0;
+}
+
+void ProcConnector::forget(pid_t pid)
+{
+    live.erase(pid);
+}
+
+void ProcConnector::livePids(std::vector<pid_t> &pids) const
+{
+    pids.assign(live.begin(), live.end());
+}
+
+void ProcConnector::takeChangedPids(std::vector<pid_t> &pids)
+{
+    pids.swap(changed);
+    changed.clear();
+}
+
+bool ProcConnector::needsResync() const
+{
+    return !synced || overrun || pollsSinceResync >= RESYNC_POLLS;
+}
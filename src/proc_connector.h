@@ -0,0 +1,97 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROCCONNECTOR_H
+#define PROCCONNECTOR_H
+
+#include <set>
+#include <sys/types.h>
+#include <vector>
+
+struct proc_event;
+
+/**
+ * ProcConnector listens to the kernel proc connector (NETLINK_CONNECTOR, CN_IDX_PROC) and keeps
+ * the set of live processes up to date from fork events, so the sampler doesn't have to list
+ * /proc on every tick to find births. Processes are dropped once the sampler fails to read them.
+ *
+ * Subscribing needs CAP_NET_ADMIN and the init pid and user namespaces, start() waits for the
+ * kernel to acknowledge it and returns false otherwise, the caller then keeps walking /proc.
+ * If the socket buffer overflows events are lost, needsResync() then asks for one full /proc
+ * walk to be passed to resync(). It also asks for one every so often, in case events stopped
+ * coming without notice.
+ */
+class ProcConnector final
+{
+public:
+    ProcConnector();
+    ~ProcConnector();
+
+    /*
+     * Open the netlink socket and subscribe to process events.
+     *
+     * @return false if the connector is unavailable or we lack the privilege
+     */
+    bool start();
+
+    /*
+     * Apply every event queued since the last call, never blocks.
+     */
+    void poll();
+
+    /*
+     * Replace the live set with a full /proc walk, after start() and whenever needsResync() is true.
+     */
+    void resync(const std::vector<pid_t> &pids);
+
+    /*
+     * Drop a pid the sampler found gone.
+     */
+    void forget(pid_t pid);
+
+    /*
+     * @pids filled with live pids in ascending order
+     */
+    void livePids(std::vector<pid_t> &pids) const;
+
+    /*
+     * @pids filled with processes that exec'd, were renamed or changed credentials since the last call
+     */
+    void takeChangedPids(std::vector<pid_t> &pids);
+
+    bool needsResync() const;
+
+private:
+    void handleEvent(const struct proc_event *event);
+    bool subscribe(bool listen);
+    bool waitForAck();
+
+    std::set<pid_t> live;
+    std::vector<pid_t> changed;
+    bool overrun;
+    bool synced;
+    int socketFd;
+    unsigned int pollsSinceResync;
+};
+
+#endif
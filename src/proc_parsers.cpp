@@ -0,0 +1,301 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "proc_parsers.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace ProcParsers {
+    static inline const char* skipSpaces(const char *c)
+    {
+        while (*c == ' ' || *c == '\t') {
+            c++;
+        }
+
+        return c;
+    }
+
+    static inline const char* skipField(const char *c)
+    {
+        c = skipSpaces(c);
+        while (*c != ' ' && *c != '\n' && *c != '\0') {
+            c++;
+        }
+
+        return c;
+    }
+
+    /*
+     * Scan an unsigned decimal after optional blanks.
+     *
+     * @return position after the last digit, or nullptr if there is no digit
+     */
+    static inline const char* scanUnsigned(const char *c, unsigned long long &value)
+    {
+        c = skipSpaces(c);
+        if (*c < '0' || *c > '9') {
+            return nullptr;
+        }
+
+        value = 0;
+        for (; *c >= '0' && *c <= '9'; c++) {
+            value = value * 10 + (*c - '0');
+        }
+
+        return c;
+    }
+
+    ssize_t preadFile(int fd, char *buffer, size_t size)
+    {
+        ssize_t length = pread(fd, buffer, size - 1, 0);
+        if (length <= 0) {
+            return -1;
+        }
+
+        buffer[length] = '\0';
+        return length;
+    }
+
+    ssize_t readFileAt(int dirFd, const char *path, char *buffer, size_t size)
+    {
+        int fd = openat(dirFd, path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+
+        ssize_t length = read(fd, buffer, size - 1);
+        close(fd);
+
+        if (length < 0) {
+            return -1;
+        }
+
+        buffer[length] = '\0';
+        return length;
+    }
+
+    bool parseStat(const char *buffer, ProcessSample &sample)
+    {
+        // The command name may contain spaces and parentheses, so split on the first '(' and last ')'.
+        const char *nameStart = strchr(buffer, '(');
+        const char *nameEnd = strrchr(buffer, ')');
+        if (nameStart == NULL || nameEnd == NULL || nameEnd < nameStart || nameEnd[1] == '\0') {
+            return false;
+        }
+
+        size_t nameLength = static_cast<size_t>(nameEnd - nameStart - 1);
+        if (nameLength > sizeof(sample.cmd) - 1) {
+            nameLength = sizeof(sample.cmd) - 1;
+        }
+        memcpy(sample.cmd, nameStart + 1, nameLength);
+        sample.cmd[nameLength] = '\0';
+
+        const char *c = nameEnd + 2;
+        sample.state = *c;
+        c++;
+
+        // Fields after state start with ppid (4) and run up to starttime (22), see proc(5).
+        // Only the ones we keep are converted, the rest (some of them signed) are just skipped.
+        unsigned long long value;
+        for (int field = 4; field <= 22; field++) {
+            switch (field) {
+            case 4:
+            case 14:
+            case 15:
+            case 20:
+            case 22:
+                c = scanUnsigned(c, value);
+                if (c == nullptr) {
+                    return false;
+                }
+                break;
+            default:
+                c = skipField(c);
+                continue;
+            }
+
+            switch (field) {
+            case 4:
+                sample.ppid = static_cast<pid_t>(value);
+                break;
+            case 14:
+                sample.utime = value;
+                break;
+            case 15:
+                sample.stime = value;
+                break;
+            case 20:
+                sample.nlwp = static_cast<int>(value);
+                break;
+            case 22:
+                sample.start_time = value;
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    bool parseStatm(const char *buffer, ProcessSample &sample)
+    {
+        // size resident shared text lib data dt
+        unsigned long long value;
+        const char *c = scanUnsigned(buffer, value);
+        if (c == nullptr || (c = scanUnsigned(c, value)) == nullptr) {
+            return false;
+        }
+        sample.resident = static_cast<long>(value);
+
+        if ((c = scanUnsigned(c, value)) == nullptr) {
+            return false;
+        }
+        sample.share = static_cast<long>(value);
+
+        return true;
+    }
+
+    bool parseStatus(const char *buffer, ProcessSample &sample)
+    {
+        // Uid: real effective saved filesystem
+        const char *uidLine = strstr(buffer, "\nUid:");
+        if (uidLine == NULL) {
+            return false;
+        }
+
+        unsigned long long value;
+        const char *c = scanUnsigned(uidLine + 5, value);
+        if (c == nullptr || scanUnsigned(c, value) == nullptr) {
+            return false;
+        }
+        sample.euid = static_cast<uid_t>(value);
+
+        return true;
+    }
+
+    bool parseIO(const char *buffer, ProcPidIO &io)
+    {
+        bool hasChar = false;
+
+        for (const char *line = buffer; *line != '\0';) {
+            const char *colon = strchr(line, ':');
+            if (colon == NULL) {
+                break;
+            }
+
+            unsigned long long value;
+            const char *end = scanUnsigned(colon + 1, value);
+            size_t keyLength = colon - line;
+
+            if (end != nullptr) {
+                // Keys are told apart by length first, then by a single compare.
+                switch (keyLength) {
+                case 5:
+                    if (memcmp(line, "rchar", 5) == 0) {
+                        io.rchar = value;
+                        hasChar = true;
+                    } else if (memcmp(line, "wchar", 5) == 0) {
+                        io.wchar = value;
+                        hasChar = true;
+                    } else if (memcmp(line, "syscr", 5) == 0) {
+                        io.syscr = value;
+                    } else if (memcmp(line, "syscw", 5) == 0) {
+                        io.syscw = value;
+                    }
+                    break;
+                case 10:
+                    if (memcmp(line, "read_bytes", 10) == 0) {
+                        io.read_bytes = value;
+                    }
+                    break;
+                case 11:
+                    if (memcmp(line, "write_bytes", 11) == 0) {
+                        io.write_bytes = value;
+                    }
+                    break;
+                case 21:
+                    if (memcmp(line, "cancelled_write_bytes", 21) == 0) {
+                        io.cancelled_write_bytes = value;
+                    }
+                    break;
+                }
+            }
+
+            const char *next = strchr(colon, '\n');
+            if (next == NULL) {
+                break;
+            }
+            line = next + 1;
+        }
+
+        return hasChar;
+    }
+
+    size_t parseCmdline(char *buffer, size_t length)
+    {
+        // Arguments end with '\0', drop the trailing ones before joining so there's no dangling space.
+        while (length > 0 && buffer[length - 1] == '\0') {
+            length--;
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            if (buffer[i] == '\0') {
+                buffer[i] = ' ';
+            }
+        }
+        buffer[length] = '\0';
+
+        return length;
+    }
+
+    bool readIO(pid_t pid, ProcPidIO &io)
+    {
+        char path[32];
+        char buffer[512];
+
+        snprintf(path, sizeof(path), "/proc/%d/io", pid);
+        if (readFileAt(AT_FDCWD, path, buffer, sizeof(buffer)) <= 0) {
+            return false;
+        }
+
+        return parseIO(buffer, io);
+    }
+
+    ssize_t readCmdline(pid_t pid, char *buffer, size_t size, bool *truncated)
+    {
+        char path[32];
+
+        snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+        ssize_t length = readFileAt(AT_FDCWD, path, buffer, size);
+        if (length < 0) {
+            return -1;
+        }
+
+        if (truncated != nullptr) {
+            *truncated = (static_cast<size_t>(length) == size - 1);
+        }
+
+        return parseCmdline(buffer, length);
+    }
+}
@@ -0,0 +1,136 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROCPARSERS_H
+#define PROCPARSERS_H
+
+#include "process_sampler.h"
+#include <sys/types.h>
+
+/**
+ * Process IO details from /proc/pid/io. Note that the IO counters encompass all IO, not only to disk, but also pipes and sockets.
+ * Root access is required to read /prod/pid/io (one may detect the size of a password of another process by examining this file),
+ */
+struct ProcPidIO {
+    /**
+     * characters read - The number of bytes which this task has caused to be read from storage. This is simply the sum of bytes which this process passed to
+     * read(2) and similar system calls. It includes things such as terminal I/O and is unaffected by whether or not actual physical disk I/O
+     * was required (the read might have been satisfied from pagecache).
+     */
+    unsigned long rchar;
+    /**
+     * characters written - The number of bytes which this task has caused, or shall cause to be written to disk.  Similar caveats apply here as with rchar.
+     */
+    unsigned long wchar;
+    /**
+     * read syscalls - Attempt to count the number of read I/O operations—that is, system calls such as read(2) and pread(2).
+     */
+    unsigned long syscr;
+    /**
+     * write syscalls - Attempt to count the number of write I/O operations—that is, system calls such as write(2) and pwrite(2).
+     */
+    unsigned long syscw;
+    /**
+     * bytes read - Attempt to count the number of bytes which this process really did cause to be fetched from the  storage  layer.   This  is  accurate  for
+     * block-backed filesystems.
+     */
+    unsigned long read_bytes;
+    /**
+     * bytes written - Attempt to count the number of bytes which this process caused to be sent to the storage layer.
+     */
+    unsigned long write_bytes;
+    /**
+     * The  big  inaccuracy  here is truncate.  If a process writes 1MB to a file and then deletes the file, it will in fact perform no writeout.
+     * But it will have been accounted as having caused 1MB of write.  In other words: this field represents  the  number  of  bytes  which  this
+     * process caused to not happen, by truncating pagecache.  A task can cause "negative" I/O too.  If this task truncates some dirty pagecache,
+     * some I/O which another task has been accounted for (in its write_bytes) will not be happening.
+     */
+    unsigned long cancelled_write_bytes;
+};
+
+/**
+ * Parsers for /proc files that never touch the heap: each file is read with a single read() into a
+ * caller-provided buffer and numbers are scanned by hand, so they are safe to call for every process
+ * on every tick and from any thread.
+ *
+ * Buffers passed to the parse functions must be NUL-terminated, the read functions take care of that.
+ */
+namespace ProcParsers {
+    /*
+     * Read up to size - 1 bytes from the start of fd.
+     *
+     * @return length read, or -1 if nothing could be read
+     */
+    ssize_t preadFile(int fd, char *buffer, size_t size);
+
+    /*
+     * Open path relative to dirFd (AT_FDCWD for absolute paths), read it and close it.
+     *
+     * @return length read, or -1 if nothing could be read
+     */
+    ssize_t readFileAt(int dirFd, const char *path, char *buffer, size_t size);
+
+    /*
+     * /proc/pid/stat: command name, state, ppid, utime, stime and start time.
+     */
+    bool parseStat(const char *buffer, ProcessSample &sample);
+
+    /*
+     * /proc/pid/statm: resident and shared pages.
+     */
+    bool parseStatm(const char *buffer, ProcessSample &sample);
+
+    /*
+     * /proc/pid/status: effective uid.
+     */
+    bool parseStatus(const char *buffer, ProcessSample &sample);
+
+    /*
+     * /proc/pid/io, fields the kernel doesn't report keep their previous value.
+     *
+     * @return false if rchar and wchar are both missing
+     */
+    bool parseIO(const char *buffer, ProcPidIO &io);
+
+    /*
+     * Turn the NUL-separated arguments of /proc/pid/cmdline into one space-separated string, in place.
+     *
+     * @return length of the string, trailing separators removed
+     */
+    size_t parseCmdline(char *buffer, size_t length);
+
+    /*
+     * Read and parse /proc/pid/io.
+     */
+    bool readIO(pid_t pid, ProcPidIO &io);
+
+    /*
+     * Read /proc/pid/cmdline into buffer, joined with spaces.
+     *
+     * @truncated set to true if the command line didn't fit in buffer
+     * @return length of the command line, or -1 if the process is gone
+     */
+    ssize_t readCmdline(pid_t pid, char *buffer, size_t size, bool *truncated = nullptr);
+}
+
+#endif
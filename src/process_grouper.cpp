@@ -0,0 +1,161 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "process_grouper.h"
+#include <QStringList>
+#include <algorithm>
+
+namespace {
+    enum MatchType {
+        ArgumentPrefix,                 // some argument starts with pattern
+        ExecutableName                  // basename of argv[0] is pattern
+    };
+
+    struct GroupRule
+    {
+        MatchType type;
+        const char *pattern;
+    };
+
+    // Helpers are told apart by their command line, a new multi-process application is one line here.
+    const GroupRule GROUP_RULES[] = {
+        {ArgumentPrefix, "--type="},                    // Chrome, Chromium, Electron: zygote, renderer, gpu-process, utility
+        {ArgumentPrefix, "-contentproc"},               // Firefox: content, gpu, rdd, socket
+        {ExecutableName, "chrome_crashpad_handler"},
+        {ExecutableName, "crashpad_handler"},
+        {ExecutableName, "QtWebEngineProcess"},
+        {ExecutableName, "WebKitWebProcess"},           // WebKitGTK
+        {ExecutableName, "WebKitNetworkProcess"},
+        {ExecutableName, "WebKitGPUProcess"},
+    };
+}
+
+bool ProcessGrouper::isHelper(const QString &cmdline)
+{
+    QStringList arguments = cmdline.split(' ', QString::SkipEmptyParts);
+    if (arguments.isEmpty()) {
+        return false;
+    }
+
+    QString executable = arguments.first().section('/', -1);
+
+    for (const GroupRule &rule : GROUP_RULES) {
+        if (rule.type == ExecutableName) {
+            if (executable == QLatin1String(rule.pattern)) {
+                return true;
+            }
+        } else {
+            for (int index = 1; index < arguments.size(); index++) {
+                if (arguments[index].startsWith(QLatin1String(rule.pattern))) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+void ProcessGrouper::group(const ProcessSampler::Snapshot &processes, const std::vector<GroupInfo> &infos, QVector<ProcessEntry> &entries,
+                           std::unordered_map<pid_t, pid_t> *foldedRoots)
+{
+    int number = static_cast<int>(processes.size());
+    tree.build(processes);
+
+    // Rows and processes are both in pid order, walk them side by side.
+    rows.assign(number, -1);
+    int cursor = 0;
+    for (int row = 0; row < entries.size(); row++) {
+        while (cursor < number && processes[cursor].tid < entries[row].pid) {
+            cursor++;
+        }
+        if (cursor < number && processes[cursor].tid == entries[row].pid) {
+            rows[cursor] = row;
+        }
+    }
+
+    // Application above every process, in preorder so the parent's is known first. Helpers join the application of their parent, processes
+    // without a row are looked through, any other row starts its own application or none.
+    const std::vector<int> &order = tree.preorder();
+    roots.assign(number, -1);
+    for (int index : order) {
+        int parent = tree.parentOf(index);
+        int parentRoot = parent >= 0 ? roots[parent] : -1;
+        bool helper = infos[index].helper || (parent >= 0 && infos[index].nameHash == infos[parent].nameHash);
+
+        if (rows[index] < 0 || (helper && parentRoot >= 0)) {
+            roots[index] = parentRoot;
+        } else if (entries[rows[index]].desktopFile.size() != 0) {
+            roots[index] = index;
+        }
+    }
+
+    // Backwards, descendants come before their ancestors, fold every helper row into its application.
+    folded.assign(entries.size(), 0);
+    if (foldedRoots != nullptr) {
+        foldedRoots->clear();
+    }
+    for (auto index = order.rbegin(); index != order.rend(); ++index) {
+        int row = rows[*index];
+        int root = roots[*index];
+        if (row < 0 || root < 0 || root == *index) {
+            continue;
+        }
+
+        const ProcessEntry &entry = entries[row];
+        ProcessEntry &rootEntry = entries[rows[root]];
+        rootEntry.cpu += entry.cpu;
+        rootEntry.memory += entry.memory;
+        rootEntry.diskStatus.readKbs += entry.diskStatus.readKbs;
+        rootEntry.diskStatus.writeKbs += entry.diskStatus.writeKbs;
+        rootEntry.networkStatus.sentBytes += entry.networkStatus.sentBytes;
+        rootEntry.networkStatus.recvBytes += entry.networkStatus.recvBytes;
+        rootEntry.networkStatus.sentKbs += entry.networkStatus.sentKbs;
+        rootEntry.networkStatus.recvKbs += entry.networkStatus.recvKbs;
+
+        // Shared memory is only shown for an application once every one of its processes was read.
+        if (rootEntry.pss >= 0 && entry.pss >= 0) {
+            rootEntry.pss += entry.pss;
+            rootEntry.uss += entry.uss;
+        } else {
+            rootEntry.pss = -1;
+            rootEntry.uss = -1;
+        }
+
+        folded[row] = 1;
+        if (foldedRoots != nullptr) {
+            (*foldedRoots)[entry.pid] = rootEntry.pid;
+        }
+    }
+
+    int kept = 0;
+    for (int row = 0; row < entries.size(); row++) {
+        if (!folded[row]) {
+            if (kept != row) {
+                entries[kept] = entries[row];
+            }
+            kept++;
+        }
+    }
+    entries.resize(kept);
+}
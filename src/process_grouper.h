@@ -0,0 +1,80 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROCESSGROUPER_H
+#define PROCESSGROUPER_H
+
+#include "process_sampler.h"
+#include "process_tree.h"
+#include "status_snapshot.h"
+#include <unordered_map>
+#include <vector>
+
+/**
+ * What the grouper needs to know about one sampled process, indexed like the sample.
+ */
+struct GroupInfo
+{
+    bool helper;                        // matched a helper rule, see ProcessGrouper::isHelper()
+    unsigned int nameHash;              // children running the same program as their parent are helpers too
+};
+
+/**
+ * ProcessGrouper folds the rows of helper processes into the row of the application they belong to,
+ * so a browser with dozens of renderers shows up as one application.
+ *
+ * The process tree is walked once: in preorder to give every process the group root above it, then
+ * backwards to fold rows into their root. Whether a process is a helper comes from a table of rules matched against
+ * its command line, callers cache that per process since it only changes on exec.
+ */
+class ProcessGrouper final
+{
+public:
+    /*
+     * Whether a process is a helper of the application that started it.
+     *
+     * @cmdline arguments separated by spaces, as returned by getProcessCmdline()
+     */
+    static bool isHelper(const QString &cmdline);
+
+    /*
+     * Fold helper rows into the closest application row above them.
+     * Applications are rows with a desktop file, rows of processes outside any application are kept.
+     *
+     * @processes all sampled processes, sorted by pid
+     * @infos one per process, indexed like processes
+     * @entries rows built from processes, in pid order, folded rows are removed
+     * @foldedRoots if not null, filled with the pid of the row each folded row went into
+     */
+    void group(const ProcessSampler::Snapshot &processes, const std::vector<GroupInfo> &infos, QVector<ProcessEntry> &entries,
+               std::unordered_map<pid_t, pid_t> *foldedRoots = nullptr);
+
+private:
+    // Scratch arrays reused between ticks.
+    ProcessTree tree;
+    std::vector<int> roots;
+    std::vector<int> rows;
+    std::vector<char> folded;
+};
+
+#endif
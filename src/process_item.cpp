@@ -52,11 +52,15 @@ ProcessItem::ProcessItem(QPixmap processIcon, QString processName, QString dName
 
     diskStatus.readKbs = 0;
     diskStatus.writeKbs = 0;
-}
 
-bool ProcessItem::sameAs(ListItem *item)
-{
-    return pid == ((static_cast<ProcessItem*>(item)))->pid;
+    pss = -1;
+    uss = -1;
+    startTime = 0;
+
+    subtreeCpu = cpu;
+    subtreeMemory = memory;
+    subtreeDiskStatus = diskStatus;
+    subtreeNetworkStatus = networkStatus;
 }
 
 void ProcessItem::drawBackground(QRect rect, QPainter *painter, int index, bool isSelect)
@@ -95,8 +99,30 @@ void ProcessItem::drawForeground(QRect rect, QPainter *painter, int column, int,
         painter->setPen(QPen(QColor("#666666")));
     }
 
-    // Draw icon and process name.
+    // Draw expander, icon and process name, indented one icon per level below the top.
     if (column == 0) {
+        int indent = getIndent();
+        rect = QRect(rect.x() + indent, rect.y(), rect.width() - indent, rect.height());
+
+        if (hasChildren()) {
+            int arrowSize = 8;
+            int arrowX = rect.x() + (padding - arrowSize) / 2;
+            int arrowY = rect.y() + (rect.height() - arrowSize) / 2;
+
+            QPainterPath arrowPath;
+            if (isCollapsed()) {
+                arrowPath.moveTo(arrowX + 1, arrowY);
+                arrowPath.lineTo(arrowX + arrowSize - 1, arrowY + arrowSize / 2);
+                arrowPath.lineTo(arrowX + 1, arrowY + arrowSize);
+            } else {
+                arrowPath.moveTo(arrowX, arrowY + 1);
+                arrowPath.lineTo(arrowX + arrowSize, arrowY + 1);
+                arrowPath.lineTo(arrowX + arrowSize / 2, arrowY + arrowSize - 1);
+            }
+            arrowPath.closeSubpath();
+            painter->fillPath(arrowPath, painter->pen().color());
+        }
+
         setFontSize(*painter, 10);
         painter->drawPixmap(QRect(rect.x() + padding, rect.y() + (rect.height() - iconSize) / 2, iconSize, iconSize), iconPixmap);
 
@@ -128,7 +154,7 @@ void ProcessItem::drawForeground(QRect rect, QPainter *painter, int column, int,
         }
 
         setFontSize(*painter, 9);
-        painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, QString("%1%").arg(QString::number(cpu, 'f', 1)));
+        painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, QString("%1%").arg(QString::number(getCPU(), 'f', 1)));
     }
     // Draw memory.
     else if (column == 2) {
@@ -139,11 +165,25 @@ void ProcessItem::drawForeground(QRect rect, QPainter *painter, int column, int,
         }
 
         setFontSize(*painter, 9);
-        painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, formatByteCount(memory));
+        painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, formatByteCount(getMemory()));
+    }
+    // Draw PSS and USS, left empty until they are read.
+    else if (column == 3 || column == 4) {
+        long value = column == 3 ? pss : uss;
+        if (value >= 0) {
+            if (isSelect) {
+                painter->setOpacity(1);
+            } else {
+                painter->setOpacity(0.5);
+            }
+
+            setFontSize(*painter, 9);
+            painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, formatByteCount(value));
+        }
     }
     // Draw write.
-    else if (column == 3) {
-        if (diskStatus.writeKbs > 0) {
+    else if (column == 5) {
+        if (getDiskStatus().writeKbs > 0) {
             if (isSelect) {
                 painter->setOpacity(1);
             } else {
@@ -151,12 +191,12 @@ void ProcessItem::drawForeground(QRect rect, QPainter *painter, int column, int,
             }
 
             setFontSize(*painter, 9);
-            painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, QString("%1/s").arg(formatByteCount(diskStatus.writeKbs)));
+            painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, QString("%1/s").arg(formatByteCount(getDiskStatus().writeKbs)));
         }
     }
     // Draw read.
-    else if (column == 4) {
-        if (diskStatus.readKbs > 0) {
+    else if (column == 6) {
+        if (getDiskStatus().readKbs > 0) {
             if (isSelect) {
                 painter->setOpacity(1);
             } else {
@@ -164,12 +204,12 @@ void ProcessItem::drawForeground(QRect rect, QPainter *painter, int column, int,
             }
 
             setFontSize(*painter, 9);
-            painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, QString("%1/s").arg(formatByteCount(diskStatus.readKbs)));
+            painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, QString("%1/s").arg(formatByteCount(getDiskStatus().readKbs)));
         }
     }
     // Draw download.
-    else if (column == 5) {
-        if (networkStatus.recvKbs > 0) {
+    else if (column == 7) {
+        if (getNetworkStatus().recvKbs > 0) {
             if (isSelect) {
                 painter->setOpacity(1);
             } else {
@@ -177,12 +217,12 @@ void ProcessItem::drawForeground(QRect rect, QPainter *painter, int column, int,
             }
 
             setFontSize(*painter, 9);
-            painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, formatBandwidth(networkStatus.recvKbs));
+            painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, formatBandwidth(getNetworkStatus().recvKbs));
         }
     }
     // Draw upload.
-    else if (column == 6) {
-        if (networkStatus.sentKbs > 0) {
+    else if (column == 8) {
+        if (getNetworkStatus().sentKbs > 0) {
             if (isSelect) {
                 painter->setOpacity(1);
             } else {
@@ -190,11 +230,11 @@ void ProcessItem::drawForeground(QRect rect, QPainter *painter, int column, int,
             }
 
             setFontSize(*painter, 9);
-            painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, formatBandwidth(networkStatus.sentKbs));
+            painter->drawText(QRect(rect.x(), rect.y(), rect.width() - textPadding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, formatBandwidth(getNetworkStatus().sentKbs));
         }
     }
     // Draw pid.
-    else if (column == 7) {
+    else if (column == 9) {
         if (isSelect) {
             painter->setOpacity(1);
         } else {
@@ -349,14 +389,65 @@ bool ProcessItem::sortByPid(const ListItem *item1, const ListItem *item2, bool d
     return descendingSort ? sortOrder : !sortOrder;
 }
 
+bool ProcessItem::sortByPss(const ListItem *item1, const ListItem *item2, bool descendingSort)
+{
+    const ProcessItem *process1 = static_cast<const ProcessItem*>(item1);
+    const ProcessItem *process2 = static_cast<const ProcessItem*>(item2);
+
+    return sortByMemoryDetail(process1, process1->getPss(), process2, process2->getPss(), descendingSort);
+}
+
+bool ProcessItem::sortByUss(const ListItem *item1, const ListItem *item2, bool descendingSort)
+{
+    const ProcessItem *process1 = static_cast<const ProcessItem*>(item1);
+    const ProcessItem *process2 = static_cast<const ProcessItem*>(item2);
+
+    return sortByMemoryDetail(process1, process1->getUss(), process2, process2->getUss(), descendingSort);
+}
+
+bool ProcessItem::sortByMemoryDetail(const ProcessItem *item1, long detail1, const ProcessItem *item2, long detail2, bool descendingSort)
+{
+    // Rows not read yet go after the others whichever the order, ordered by their own resident memory among
+    // themselves: a collapsed row shows a subtree total, which can't be compared with anybody's PSS or USS.
+    bool known1 = detail1 >= 0;
+    bool known2 = detail2 >= 0;
+    if (known1 != known2) {
+        return known1;
+    }
+
+    long memory1 = known1 ? detail1 : item1->memory;
+    long memory2 = known2 ? detail2 : item2->memory;
+    bool sortOrder;
+
+    // Sort item with cpu if memory is same.
+    if (memory1 == memory2) {
+        sortOrder = item1->getCPU() > item2->getCPU();
+    }
+    // Otherwise sort by memory.
+    else {
+        sortOrder = memory1 > memory2;
+    }
+
+    return descendingSort ? sortOrder : !sortOrder;
+}
+
+QRect ProcessItem::getExpanderRect(QRect rect) const
+{
+    if (!hasChildren()) {
+        return QRect();
+    }
+
+    return QRect(rect.x() + getIndent(), rect.y(), padding, rect.height());
+}
+
 DiskStatus ProcessItem::getDiskStatus() const
 {
-    return diskStatus;
+    return showsSubtree() ? subtreeDiskStatus : diskStatus;
 }
 
 NetworkStatus ProcessItem::getNetworkStatus() const
 {
-    return networkStatus;
+    return showsSubtree() ? subtreeNetworkStatus : networkStatus;
 }
 
 QString ProcessItem::getDisplayName() const
@@ -376,7 +467,7 @@ QString ProcessItem::getUser() const
 
 double ProcessItem::getCPU() const
 {
-    return cpu;
+    return showsSubtree() ? subtreeCpu : cpu;
 }
 
 int ProcessItem::getPid() const
@@ -386,21 +477,22 @@ int ProcessItem::getPid() const
 
 long ProcessItem::getMemory() const
 {
-    return memory;
+    return showsSubtree() ? subtreeMemory : memory;
 }
 
-void ProcessItem::mergeItem(ListItem *item)
+long ProcessItem::getPss() const
 {
-    const ProcessItem *processItem = static_cast<const ProcessItem*>(item);
+    return pss;
+}
+
+long ProcessItem::getUss() const
+{
+    return uss;
+}
 
-    cpu += processItem->getCPU();
-    memory += processItem->getMemory();
-    diskStatus.readKbs += processItem->getDiskStatus().readKbs;
-    diskStatus.writeKbs += processItem->getDiskStatus().writeKbs;
-    networkStatus.sentBytes += processItem->getNetworkStatus().sentBytes;
-    networkStatus.recvBytes += processItem->getNetworkStatus().recvBytes;
-    networkStatus.sentKbs += processItem->getNetworkStatus().sentKbs;
-    networkStatus.recvKbs += processItem->getNetworkStatus().recvKbs;
+unsigned long long ProcessItem::getStartTime() const
+{
+    return startTime;
 }
 
 void ProcessItem::setDiskStatus(DiskStatus dStatus)
@@ -408,7 +500,56 @@ void ProcessItem::setDiskStatus(DiskStatus dStatus)
     diskStatus = dStatus;
 }
 
+void ProcessItem::setIcon(QPixmap processIcon)
+{
+    iconPixmap = processIcon;
+}
+
+void ProcessItem::setMemoryDetail(long processPss, long processUss)
+{
+    pss = processPss;
+    uss = processUss;
+}
+
 void ProcessItem::setNetworkStatus(NetworkStatus nStatus)
 {
     networkStatus = nStatus;
 }
+
+void ProcessItem::setStartTime(unsigned long long processStartTime)
+{
+    startTime = processStartTime;
+}
+
+void ProcessItem::setSubtreeStatus(double treeCpu, long treeMemory, DiskStatus treeDiskStatus, NetworkStatus treeNetworkStatus)
+{
+    subtreeCpu = treeCpu;
+    subtreeMemory = treeMemory;
+    subtreeDiskStatus = treeDiskStatus;
+    subtreeNetworkStatus = treeNetworkStatus;
+}
+
+void ProcessItem::updateStatus(QString processName, QString dName, double processCpu, long processMemory, QString processUser, char processState)
+{
+    name = processName;
+    displayName = dName;
+    cpu = processCpu;
+    memory = processMemory;
+    user = processUser;
+    state = processState;
+}
+
+bool ProcessItem::showsSubtree() const
+{
+    return isCollapsed() && hasChildren();
+}
+
+int ProcessItem::getIndent() const
+{
+    int depth = 0;
+    for (ListItem *item = getParentItem(); item != NULL; item = item->getParentItem()) {
+        depth++;
+    }
+
+    return depth * iconSize;
+}
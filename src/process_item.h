@@ -37,7 +37,6 @@ class ProcessItem : public ListItem
 public:
     ProcessItem(QPixmap processIcon, QString processName, QString dName, double processCpu, long processMemory, int processPid, QString processUser, char processState);
     
-    bool sameAs(ListItem *item);
     void drawBackground(QRect rect, QPainter *painter, int index, bool isSelect);
     void drawForeground(QRect rect, QPainter *painter, int column, int index, bool isSelect);
     
@@ -50,7 +49,17 @@ public:
     static bool sortByNetworkDownload(const ListItem *item1, const ListItem *item2, bool descendingSort);
     static bool sortByNetworkUpload(const ListItem *item1, const ListItem *item2, bool descendingSort);
     static bool sortByPid(const ListItem *item1, const ListItem *item2, bool descendingSort);
+    static bool sortByPss(const ListItem *item1, const ListItem *item2, bool descendingSort);
+    static bool sortByUss(const ListItem *item1, const ListItem *item2, bool descendingSort);
     
+    /*
+     * The expander sits left of the icon, indented like the rest of the first column.
+     */
+    QRect getExpanderRect(QRect rect) const;
+    
+    /*
+     * Values as shown, cpu, memory, disk and network of a collapsed row are those of its whole subtree.
+     */
     DiskStatus getDiskStatus() const;
     NetworkStatus getNetworkStatus() const;
     QString getDisplayName() const;
@@ -59,12 +68,41 @@ public:
     double getCPU() const;
     int getPid() const;
     long getMemory() const;
-    void mergeItem(ListItem *item);
+    long getPss() const;
+    long getUss() const;
+    unsigned long long getStartTime() const;
     void setDiskStatus(DiskStatus dStatus);
+    void setIcon(QPixmap processIcon);
+    
+    /*
+     * Set memory with shared pages accounted for, -1 while it isn't read yet.
+     */
+    void setMemoryDetail(long processPss, long processUss);
     void setNetworkStatus(NetworkStatus nStatus);
+
+    /*
+     * Set the start time the process was sampled with, it tells the process apart from a later one with the same pid.
+     */
+    void setStartTime(unsigned long long processStartTime);
+    
+    /*
+     * Set totals of the row and every row below it, shown instead of its own values while it's collapsed.
+     */
+    void setSubtreeStatus(double treeCpu, long treeMemory, DiskStatus treeDiskStatus, NetworkStatus treeNetworkStatus);
+    void updateStatus(QString processName, QString dName, double processCpu, long processMemory, QString processUser, char processState);
     
 private:
+    /*
+     * Order two rows by PSS or USS, -1 while the value isn't read yet.
+     */
+    static bool sortByMemoryDetail(const ProcessItem *item1, long detail1, const ProcessItem *item2, long detail2, bool descendingSort);
+
+    bool showsSubtree() const;
+    int getIndent() const;
+    
     DiskStatus diskStatus;
+    DiskStatus subtreeDiskStatus;
+    NetworkStatus subtreeNetworkStatus;
     NetworkStatus networkStatus;
     QPixmap iconPixmap;
     QString displayName;
@@ -73,11 +111,16 @@ private:
     QString user;
     char state;
     double cpu;
+    double subtreeCpu;
     int iconSize;
     int padding;
     int pid;
     int textPadding;
     long memory;
+    long pss;
+    long uss;
+    long subtreeMemory;
+    unsigned long long startTime;
 };
 
 #endif
@@ -27,11 +27,16 @@
 #include "list_view.h"
 #include "process_item.h"
 #include "process_manager.h"
+#include "service_item.h"
+#include "thread_item.h"
 #include <QDebug>
 #include <QProcess>
 #include <QList>
+#include <QSet>
 #include <proc/sysinfo.h>
+#include <errno.h>
 #include <signal.h>
+#include <string.h>
 #include "attributes_dialog.h"
 
 using namespace Utils;
@@ -49,6 +54,7 @@ ProcessManager::ProcessManager(QWidget *parent) : QWidget(parent)
     topLayout->setContentsMargins(2, 0, 2, 0);
     processView = new ProcessView();
     connect(processView, &ListView::pressSearchKey, this, &ProcessManager::pressSearchKey);
+    connect(processView, &ListView::visibleItemsChanged, this, &ProcessManager::updateVisibleItems, Qt::DirectConnection);
     layout->addWidget(topWidget);
     layout->addWidget(processView);
 
@@ -68,6 +74,8 @@ ProcessManager::ProcessManager(QWidget *parent) : QWidget(parent)
     alorithms->append(&ProcessItem::sortByName);
     alorithms->append(&ProcessItem::sortByCPU);
     alorithms->append(&ProcessItem::sortByMemory);
+    alorithms->append(&ProcessItem::sortByPss);
+    alorithms->append(&ProcessItem::sortByUss);
     alorithms->append(&ProcessItem::sortByDiskWrite);
     alorithms->append(&ProcessItem::sortByDiskRead);
     alorithms->append(&ProcessItem::sortByNetworkDownload);
@@ -81,25 +89,47 @@ ProcessManager::ProcessManager(QWidget *parent) : QWidget(parent)
     killProcessDialog->addButton(QString("取消"), false, DDialog::ButtonNormal);
     killProcessDialog->addButton(QString("结束进程"), true, DDialog::ButtonNormal);
     connect(killProcessDialog, &DDialog::buttonClicked, this, &ProcessManager::dialogButtonClicked);
+    // Cancelled or closed, the processes picked for it aren't held any longer.
+    connect(killProcessDialog, &DDialog::finished, this, [this] {
+            signalDispatcher->clear();
+        });
+    killTree = false;
+
+    signalFailedDialog = new DDialog(QString(), QString());
+    signalFailedDialog->setIcon(QIcon(Utils::getQrcPath("deepin-system-monitor.svg")));
+    signalFailedDialog->addButton(QString("确定"), true, DDialog::ButtonNormal);
     
     actionPids = new QList<int>();
+    signalDispatcher = new SignalDispatcher();
 
     rightMenu = new QMenu();
     rightMenu->setStyle(QStyleFactory::create("dlight"));
     killAction = new QAction("结束进程", this);
     connect(killAction, &QAction::triggered, this, &ProcessManager::showKillProcessDialog);
+    killTreeAction = new QAction("结束进程树", this);
+    connect(killTreeAction, &QAction::triggered, this, &ProcessManager::showKillProcessTreeDialog);
     pauseAction = new QAction("暂停进程", this);
     connect(pauseAction, &QAction::triggered, this, &ProcessManager::stopProcesses);
+    stopTreeAction = new QAction("暂停进程树", this);
+    connect(stopTreeAction, &QAction::triggered, this, &ProcessManager::stopProcessTrees);
     resumeAction = new QAction("继续进程", this);
     connect(resumeAction, &QAction::triggered, this, &ProcessManager::resumeProcesses);
+    resumeTreeAction = new QAction("继续进程树", this);
+    connect(resumeTreeAction, &QAction::triggered, this, &ProcessManager::resumeProcessTrees);
     openDirectoryAction = new QAction("打开程序所在目录", this);
     connect(openDirectoryAction, &QAction::triggered, this, &ProcessManager::openProcessDirectory);
     attributesAction = new QAction("属性", this);
     connect(attributesAction, &QAction::triggered, this, &ProcessManager::showAttributes);
+    threadsAction = new QAction("展开/收起线程", this);
+    connect(threadsAction, &QAction::triggered, this, &ProcessManager::toggleProcessThreads);
     rightMenu->addAction(killAction);
+    rightMenu->addAction(killTreeAction);
     rightMenu->addAction(pauseAction);
+    rightMenu->addAction(stopTreeAction);
     rightMenu->addAction(resumeAction);
+    rightMenu->addAction(resumeTreeAction);
     rightMenu->addAction(openDirectoryAction);
+    rightMenu->addAction(threadsAction);
     rightMenu->addAction(attributesAction);
 
     connect(processView, &ProcessView::rightClickItems, this, &ProcessManager::popupMenu, Qt::QueuedConnection);
@@ -108,22 +138,32 @@ ProcessManager::ProcessManager(QWidget *parent) : QWidget(parent)
 ProcessManager::~ProcessManager()
 {
     delete killProcessDialog;
+    delete signalFailedDialog;
     delete processSwitchTab;
     delete processView;
     delete attributesAction;
     delete killAction;
+    delete killTreeAction;
     delete openDirectoryAction;
     delete pauseAction;
     delete resumeAction;
+    delete resumeTreeAction;
+    delete stopTreeAction;
+    delete threadsAction;
     delete statusLabel;
     delete actionPids;
     delete rightMenu;
+    delete signalDispatcher;
 }
 
 void ProcessManager::dialogButtonClicked(int index, QString)
 {
     if (index == 1) {
-        killProcesses();
+        if (killTree) {
+            killProcessTrees();
+        } else {
+            killProcesses();
+        }
     }
 }
 
@@ -134,13 +174,12 @@ void ProcessManager::handleSearch(QString searchContent)
 
 void ProcessManager::killProcesses()
 {
-    for (int pid : *actionPids) {
-        if (kill(pid, SIGTERM) != 0) {
-            qDebug() << QString("Kill process %1 failed, permission denied.").arg(pid);
-        }
-    }
+    sendSignal(SIGTERM, false, "结束进程");
+}
 
-    actionPids->clear();
+void ProcessManager::killProcessTrees()
+{
+    sendSignal(SIGTERM, true, "结束进程树");
 }
 
 void ProcessManager::openProcessDirectory()
@@ -168,22 +207,53 @@ void ProcessManager::openProcessDirectory()
 
 void ProcessManager::popupMenu(QPoint pos, QList<ListItem*> items)
 {
+    // Pids of a menu closed without picking an action don't carry over.
+    actionPids->clear();
+    signalDispatcher->clear();
+
+    // Actions on a thread row apply to its process, signals can't be sent to a single thread anyway.
+    // Processes are pinned right away, so a signal sent once the user made up their mind can't reach
+    // another process under the same pid, nor one that took the pid before the row was picked.
+    QSet<int> pickedPids;
     for (ListItem *item : items) {
+        ThreadItem *threadItem = qobject_cast<ThreadItem*>(item);
+        if (threadItem != NULL) {
+            item = threadItem->getProcessItem();
+        }
+
+        // Service rows have no pid to act on.
+        if (qobject_cast<ServiceItem*>(item) != NULL) {
+            continue;
+        }
+
         ProcessItem *processItem = static_cast<ProcessItem*>(item);
-        actionPids->append(processItem->getPid());
+        int pid = processItem->getPid();
+        if (!pickedPids.contains(pid)) {
+            pickedPids.insert(pid);
+            actionPids->append(pid);
+            signalDispatcher->pin(pid, processItem->getStartTime());
+        }
+    }
+    if (actionPids->isEmpty()) {
+        return;
     }
+
     rightMenu->exec(this->mapToGlobal(pos));
+
+    // The action has run by now, only the kill dialog still needs the pinned processes until it's answered.
+    if (!killProcessDialog->isVisible()) {
+        signalDispatcher->clear();
+    }
 }
 
 void ProcessManager::resumeProcesses()
 {
-    for (int pid : *actionPids) {
-        if (kill(pid, SIGCONT) != 0) {
-            qDebug() << QString("Resume process %1 failed, permission denied.").arg(pid);
-        }
-    }
+    sendSignal(SIGCONT, false, "继续进程");
+}
 
-    actionPids->clear();
+void ProcessManager::resumeProcessTrees()
+{
+    sendSignal(SIGCONT, true, "继续进程树");
 }
 
 void ProcessManager::showAttributes()
@@ -198,16 +268,33 @@ void ProcessManager::showAttributes()
 
 void ProcessManager::showKillProcessDialog()
 {
+    killTree = false;
+    killProcessDialog->setTitle(QString("结束进程"));
+    killProcessDialog->setMessage(QString("结束进程会有丢失数据的风险\n您确定要结束选中的进程吗？"));
+    killProcessDialog->show();
+}
+
+void ProcessManager::showKillProcessTreeDialog()
+{
+    killTree = true;
+    killProcessDialog->setTitle(QString("结束进程树"));
+    killProcessDialog->setMessage(QString("选中进程的所有子进程也会被结束，会有丢失数据的风险\n您确定要结束选中的进程树吗？"));
     killProcessDialog->show();
 }
 
 void ProcessManager::stopProcesses()
 {
-    for (int pid : *actionPids) {
-        if (kill(pid, SIGSTOP) != 0) {
-            qDebug() << QString("Stop process %1 failed, permission denied.").arg(pid);
-        }
-    }
+    sendSignal(SIGSTOP, false, "暂停进程");
+}
+
+void ProcessManager::stopProcessTrees()
+{
+    sendSignal(SIGSTOP, true, "暂停进程树");
+}
+
+void ProcessManager::toggleProcessThreads()
+{
+    toggleThreads(*actionPids);
 
     actionPids->clear();
 }
@@ -217,7 +304,70 @@ void ProcessManager::updateProcessNumber(QString tabName, int guiProcessNumber,
     statusLabel->setText(QString("%1 (正在运行%2个应用进程和%3个系统进程)").arg(tabName).arg(guiProcessNumber).arg(systemProcessNumber));
 }
 
-void ProcessManager::updateStatus(QList<ListItem*> items)
+void ProcessManager::sendSignal(int signal, bool tree, QString actionName)
+{
+    std::vector<SignalDispatcher::Result> results;
+    signalDispatcher->send(signal, tree, results);
+    signalDispatcher->clear();
+    actionPids->clear();
+
+    QStringList failures;
+    for (const SignalDispatcher::Result &result : results) {
+        if (result.error == 0) {
+            continue;
+        }
+
+        qDebug() << QString("Signal %1 to process %2 failed, %3.").arg(signal).arg(result.pid).arg(strerror(result.error));
+
+        QString reason;
+        if (result.error == ESRCH) {
+            reason = "进程已退出";
+        } else if (result.error == EPERM) {
+            reason = "权限不足";
+        } else {
+            reason = QString::fromLocal8Bit(strerror(result.error));
+        }
+        failures << QString("进程 %1：%2").arg(result.pid).arg(reason);
+    }
+
+    // A long list is cut short, the log has all of it.
+    if (!failures.isEmpty()) {
+        int failureNumber = failures.size();
+        if (failureNumber > 10) {
+            failures = failures.mid(0, 10);
+            failures << QString("等 %1 个进程").arg(failureNumber);
+        }
+
+        signalFailedDialog->setTitle(QString("%1失败").arg(actionName));
+        signalFailedDialog->setMessage(failures.join("\n"));
+        signalFailedDialog->show();
+    }
+}
+
+void ProcessManager::updateStatus(QList<ListItem*> newItems, QList<ListItem*> removedItems)
 {
-    processView->refreshItems(items);
+    processView->updateItems(newItems, removedItems);
+}
+
+void ProcessManager::updateVisibleItems(QList<ListItem*> items, QList<ListItem*> selectedItems)
+{
+    // Thread rows stand for their process, service rows have no process of their own.
+    QSet<int> pidSet;
+    for (ListItem *item : items + selectedItems) {
+        ThreadItem *threadItem = qobject_cast<ThreadItem*>(item);
+        if (threadItem != NULL) {
+            item = threadItem->getProcessItem();
+        }
+
+        if (qobject_cast<ServiceItem*>(item) == NULL) {
+            pidSet.insert(static_cast<ProcessItem*>(item)->getPid());
+        }
+    }
+    QList<int> pids = pidSet.toList();
+    qSort(pids);
+
+    if (pids != visiblePids) {
+        visiblePids = pids;
+        visiblePidsChanged(visiblePids);
+    }
 }
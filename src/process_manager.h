@@ -27,6 +27,7 @@
 #include "ddialog.h"
 #include "process_switch_tab.h"
 #include "process_view.h"
+#include "signal_dispatcher.h"
 #include <QLabel>
 #include <QMap>
 #include <QMenu>
@@ -48,32 +49,53 @@ public:
 signals:
     void activeTab(int index);
     void pressSearchKey();
+    void toggleThreads(QList<int> pids);
+    void visiblePidsChanged(QList<int> pids);
     
 public slots:
     void dialogButtonClicked(int index, QString buttonText);
     void handleSearch(QString searchContent);
     void killProcesses();
+    void killProcessTrees();
     void openProcessDirectory();
     void popupMenu(QPoint pos, QList<ListItem*> items);
     void resumeProcesses();
+    void resumeProcessTrees();
     void showAttributes();
     void showKillProcessDialog();
+    void showKillProcessTreeDialog();
     void stopProcesses();
+    void stopProcessTrees();
+    void toggleProcessThreads();
     void updateProcessNumber(QString tabName, int guiProcessNumber, int systemProcessNumber);
-    void updateStatus(QList<ListItem*> items);
+    void updateStatus(QList<ListItem*> newItems, QList<ListItem*> removedItems);
+    void updateVisibleItems(QList<ListItem*> items, QList<ListItem*> selectedItems);
     
 private:
+    /*
+     * Signal the processes picked from the menu, failures are listed in a dialog.
+     */
+    void sendSignal(int signal, bool tree, QString actionName);
+
     DDialog *killProcessDialog;
+    DDialog *signalFailedDialog;
     ProcessSwitchTab *processSwitchTab;
     ProcessView *processView;
     QAction *attributesAction;
     QAction *killAction;
+    QAction *killTreeAction;
     QAction *openDirectoryAction;
     QAction *pauseAction;
     QAction *resumeAction;
+    QAction *resumeTreeAction;
+    QAction *stopTreeAction;
+    QAction *threadsAction;
     QLabel *statusLabel;
     QList<int> *actionPids;
+    QList<int> visiblePids;
     QMenu *rightMenu;
+    SignalDispatcher *signalDispatcher;
+    bool killTree;
 };
 
 #endif
@@ -0,0 +1,541 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "process_sampler.h"
+#include "proc_parsers.h"
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace ProcParsers;
+
+// Every cached PID holds its stat, statm and status descriptors.
+static const size_t HANDLE_FD_NUMBER = 3;
+
+// Cached descriptors live at or above this number, the ones below are left for X11, Qt and the rest of the process.
+// nethogs puts its pcap and pipe descriptors in select() sets, which can't hold anything past FD_SETSIZE.
+static const rlim_t HANDLE_FD_FLOOR = FD_SETSIZE;
+
+// Pids per shard, small enough to balance uneven tasks, large enough to keep the cursor cold.
+static const size_t SHARD_SIZE = 64;
+
+// procfs reads serialize on kernel locks past this point, more threads only add wakeups.
+static const unsigned int MAX_WORKER_NUMBER = 16;
+
+struct linux_dirent64
+{
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Open path relative to dirFd and move the descriptor to HANDLE_FD_FLOOR or above.
+static int openHigh(int dirFd, const char *path)
+{
+    int fd = openat(dirFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int highFd = fcntl(fd, F_DUPFD_CLOEXEC, static_cast<int>(HANDLE_FD_FLOOR));
+    int error = errno;
+    close(fd);
+    errno = error;
+    return highFd;
+}
+
+ProcessSampler::ProcessSampler(size_t threshold, unsigned int number)
+{
+    procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    generation = 0;
+    cachedHandleNumber = 0;
+    cachedHandleLimit = 0;
+
+    parallelThreshold = threshold;
+    workerNumber = number;
+    if (workerNumber == 0) {
+        workerNumber = std::thread::hardware_concurrency();
+    }
+    workerNumber = std::max(1u, std::min(workerNumber, MAX_WORKER_NUMBER));
+
+    // Listen to fork and exit events if we are allowed to, walk /proc on every sample otherwise.
+    procConnector = new ProcConnector();
+    if (!procConnector->start()) {
+        delete procConnector;
+        procConnector = nullptr;
+    }
+
+    nextShard = 0;
+    shardNumber = 0;
+    busyWorkerNumber = 0;
+    workerRound = 0;
+    stopping = false;
+
+    // Raise the soft descriptor limit as far as we are allowed, then size the cache to fit above the floor.
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        if (limit.rlim_cur < limit.rlim_max) {
+            struct rlimit raised = limit;
+            raised.rlim_cur = limit.rlim_max;
+            if (setrlimit(RLIMIT_NOFILE, &raised) == 0) {
+                limit = raised;
+            }
+        }
+
+        if (limit.rlim_cur == RLIM_INFINITY) {
+            cachedHandleLimit = SIZE_MAX;
+        } else if (limit.rlim_cur > HANDLE_FD_FLOOR) {
+            cachedHandleLimit = (limit.rlim_cur - HANDLE_FD_FLOOR) / HANDLE_FD_NUMBER;
+        }
+    }
+}
+
+ProcessSampler::~ProcessSampler()
+{
+    stopWorkers();
+
+    for (auto &i : handles) {
+        closeHandle(i.second);
+    }
+    handles.clear();
+
+    if (procFd >= 0) {
+        close(procFd);
+    }
+
+    delete procConnector;
+}
+
+bool ProcessSampler::sample(Snapshot &snapshot, unsigned int fields)
+{
+    snapshot.clear();
+
+    if (procFd < 0 || !scanPids()) {
+        return false;
+    }
+
+    generation++;
+
+    // An exec'd setuid binary or a credential change leaves the remembered owner behind, read status again.
+    if (procConnector != nullptr) {
+        procConnector->takeChangedPids(eventPids);
+        for (pid_t pid : eventPids) {
+            auto handle = handles.find(pid);
+            if (handle != handles.end()) {
+                handle->second.staleFields |= StatusField;
+            }
+        }
+        changedPids.insert(changedPids.end(), eventPids.begin(), eventPids.end());
+    }
+
+    // Open descriptors of new pids first, the cache is only ever changed from this thread.
+    tasks.clear();
+    tasks.reserve(pids.size());
+    for (pid_t pid : pids) {
+        // A new process has no previous values to fall back on, read everything.
+        unsigned int taskFields = fields;
+        auto handle = handles.find(pid);
+        if (handle == handles.end()) {
+            PidHandle newHandle;
+            if (!openHandle(pid, newHandle)) {
+                continue;
+            }
+
+            handle = handles.emplace(pid, newHandle).first;
+            taskFields = AllFields;
+        }
+        taskFields |= handle->second.staleFields;
+        handle->second.staleFields = 0;
+
+        // Elements of unordered_map never move, so the pointer stays valid while new pids are inserted.
+        handle->second.generation = generation;
+        tasks.push_back({pid, &handle->second, taskFields});
+    }
+
+    samples.resize(tasks.size());
+    readResults.assign(tasks.size(), 0);
+
+    if (tasks.size() >= parallelThreshold && workerNumber > 1) {
+        readParallel();
+    } else {
+        readRange(0, tasks.size());
+    }
+
+    // Merge in pid order.
+    snapshot.reserve(tasks.size());
+    size_t touchedNumber = tasks.size();
+    for (size_t i = 0; i < tasks.size(); i++) {
+        if (readResults[i]) {
+            snapshot.push_back(samples[i]);
+            continue;
+        }
+
+        // Cached descriptors die with the task they were opened for, so a failed read while
+        // the pid is still listed means the pid has been reused: reopen once and retry.
+        pid_t pid = tasks[i].pid;
+        PidHandle &handle = *tasks[i].handle;
+        ProcessSample sample;
+
+        closeHandle(handle);
+        if (!openHandle(pid, handle) || !readHandle(pid, handle, sample)) {
+            closeHandle(handle);
+            handles.erase(pid);
+            touchedNumber--;
+
+            // The process is gone, exit events don't tell when the last thread of a group left.
+            if (procConnector != nullptr) {
+                procConnector->forget(pid);
+            }
+
+            continue;
+        }
+        handle.generation = generation;
+
+        snapshot.push_back(sample);
+    }
+
+    // Close descriptors of processes that didn't show up in this scan.
+    if (handles.size() > touchedNumber) {
+        for (auto i = handles.begin(); i != handles.end();) {
+            if (i->second.generation != generation) {
+                closeHandle(i->second);
+                i = handles.erase(i);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool ProcessSampler::readProcess(pid_t pid, ProcessSample &sample, unsigned int fields)
+{
+    char path[32];
+    char buffer[4096];
+
+    memset(&sample, 0, sizeof(ProcessSample));
+    sample.tid = pid;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if (readFileAt(AT_FDCWD, path, buffer, sizeof(buffer)) <= 0 || !parseStat(buffer, sample)) {
+        return false;
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+    if ((fields & StatmField) && readFileAt(AT_FDCWD, path, buffer, sizeof(buffer)) > 0) {
+        parseStatm(buffer, sample);
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    if ((fields & StatusField) && readFileAt(AT_FDCWD, path, buffer, sizeof(buffer)) > 0) {
+        parseStatus(buffer, sample);
+    }
+
+    return true;
+}
+
+bool ProcessSampler::openHandle(pid_t pid, PidHandle &handle)
+{
+    handle.statFd = -1;
+    handle.statmFd = -1;
+    handle.statusFd = -1;
+    handle.generation = generation;
+    handle.resident = 0;
+    handle.share = 0;
+    handle.euid = 0;
+    handle.staleFields = 0;
+
+    // Out of descriptor budget, this pid will be read through transient opens instead.
+    if (cachedHandleNumber >= cachedHandleLimit) {
+        return true;
+    }
+
+    char path[32];
+
+    snprintf(path, sizeof(path), "%d/stat", pid);
+    handle.statFd = openHigh(procFd, path);
+    if (handle.statFd < 0) {
+        // Someone else took the descriptors above the floor, read this pid through transient opens.
+        return errno == EMFILE;
+    }
+    cachedHandleNumber++;
+
+    snprintf(path, sizeof(path), "%d/statm", pid);
+    handle.statmFd = openHigh(procFd, path);
+    snprintf(path, sizeof(path), "%d/status", pid);
+    handle.statusFd = openHigh(procFd, path);
+
+    if (handle.statmFd < 0 || handle.statusFd < 0) {
+        bool exhausted = errno == EMFILE;
+        closeHandle(handle);
+        return exhausted;
+    }
+
+    return true;
+}
+
+bool ProcessSampler::readHandle(pid_t pid, PidHandle &handle, ProcessSample &sample, unsigned int fields) const
+{
+    char buffer[4096];
+
+    memset(&sample, 0, sizeof(ProcessSample));
+    sample.tid = pid;
+
+    // Transient handles have nothing remembered, so they always read every file.
+    if (handle.statFd < 0) {
+        char path[32];
+
+        snprintf(path, sizeof(path), "%d/stat", pid);
+        if (readFileAt(procFd, path, buffer, sizeof(buffer)) <= 0 || !parseStat(buffer, sample)) {
+            return false;
+        }
+
+        snprintf(path, sizeof(path), "%d/statm", pid);
+        if (readFileAt(procFd, path, buffer, sizeof(buffer)) <= 0 || !parseStatm(buffer, sample)) {
+            return false;
+        }
+
+        snprintf(path, sizeof(path), "%d/status", pid);
+        if (readFileAt(procFd, path, buffer, sizeof(buffer)) <= 0 || !parseStatus(buffer, sample)) {
+            return false;
+        }
+    } else {
+        if (preadFile(handle.statFd, buffer, sizeof(buffer)) <= 0 || !parseStat(buffer, sample)) {
+            return false;
+        }
+
+        if (fields & StatmField) {
+            if (preadFile(handle.statmFd, buffer, sizeof(buffer)) <= 0 || !parseStatm(buffer, sample)) {
+                return false;
+            }
+            handle.resident = sample.resident;
+            handle.share = sample.share;
+        } else {
+            sample.resident = handle.resident;
+            sample.share = handle.share;
+        }
+
+        if (fields & StatusField) {
+            if (preadFile(handle.statusFd, buffer, sizeof(buffer)) <= 0 || !parseStatus(buffer, sample)) {
+                return false;
+            }
+            handle.euid = sample.euid;
+        } else {
+            sample.euid = handle.euid;
+        }
+    }
+
+    return true;
+}
+
+void ProcessSampler::setParallelThreshold(size_t threshold)
+{
+    parallelThreshold = threshold;
+}
+
+void ProcessSampler::readRange(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        readResults[i] = readHandle(tasks[i].pid, *tasks[i].handle, samples[i], tasks[i].fields);
+    }
+}
+
+void ProcessSampler::readShards()
+{
+    // Claim shards until none are left, a thread that finishes early just takes the next one.
+    while (true) {
+        size_t shard = nextShard.fetch_add(1);
+        if (shard >= shardNumber) {
+            break;
+        }
+
+        size_t begin = shard * SHARD_SIZE;
+        readRange(begin, std::min(begin + SHARD_SIZE, tasks.size()));
+    }
+}
+
+void ProcessSampler::readParallel()
+{
+    if (workers.empty()) {
+        startWorkers();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        nextShard = 0;
+        shardNumber = (tasks.size() + SHARD_SIZE - 1) / SHARD_SIZE;
+        busyWorkerNumber = workers.size();
+        workerRound++;
+    }
+    workerCondition.notify_all();
+
+    // The calling thread reads shards too instead of just waiting.
+    readShards();
+
+    std::unique_lock<std::mutex> lock(workerMutex);
+    doneCondition.wait(lock, [this] { return busyWorkerNumber == 0; });
+}
+
+void ProcessSampler::startWorkers()
+{
+    for (unsigned int i = 1; i < workerNumber; i++) {
+        workers.emplace_back(&ProcessSampler::workerLoop, this);
+    }
+}
+
+void ProcessSampler::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        stopping = true;
+    }
+    workerCondition.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void ProcessSampler::workerLoop()
+{
+    unsigned int round = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(workerMutex);
+            workerCondition.wait(lock, [this, round] { return stopping || workerRound != round; });
+            if (stopping) {
+                return;
+            }
+            round = workerRound;
+        }
+
+        readShards();
+
+        std::lock_guard<std::mutex> lock(workerMutex);
+        if (--busyWorkerNumber == 0) {
+            doneCondition.notify_one();
+        }
+    }
+}
+
+void ProcessSampler::takeChangedPids(std::vector<pid_t> &changed)
+{
+    changed.swap(changedPids);
+    changedPids.clear();
+}
+
+bool ProcessSampler::isEventDriven() const
+{
+    return procConnector != nullptr;
+}
+
+bool ProcessSampler::scanPids()
+{
+    // Births and exits since the last sample are already queued on the connector.
+    if (procConnector != nullptr) {
+        procConnector->poll();
+
+        if (!procConnector->needsResync()) {
+            procConnector->livePids(pids);
+            return true;
+        }
+    }
+
+    if (lseek(procFd, 0, SEEK_SET) < 0) {
+        return false;
+    }
+
+    pids.clear();
+
+    char buffer[32768];
+    while (true) {
+        long length = syscall(SYS_getdents64, procFd, buffer, sizeof(buffer));
+        if (length < 0) {
+            return false;
+        } else if (length == 0) {
+            break;
+        }
+
+        for (long offset = 0; offset < length;) {
+            struct linux_dirent64 *entry = reinterpret_cast<struct linux_dirent64*>(buffer + offset);
+            offset += entry->d_reclen;
+
+            if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) {
+                continue;
+            }
+
+            pid_t pid = 0;
+            const char *c = entry->d_name;
+            for (; *c >= '0' && *c <= '9'; c++) {
+                pid = pid * 10 + (*c - '0');
+            }
+
+            if (*c == '\0' && pid > 0) {
+                pids.push_back(pid);
+            }
+        }
+    }
+
+    // procfs lists pids in ascending order, keep the guarantee even if that ever changes.
+    if (!std::is_sorted(pids.begin(), pids.end())) {
+        std::sort(pids.begin(), pids.end());
+    }
+
+    if (procConnector != nullptr) {
+        procConnector->resync(pids);
+    }
+
+    return true;
+}
+
+void ProcessSampler::closeHandle(PidHandle &handle)
+{
+    if (handle.statFd >= 0) {
+        close(handle.statFd);
+        cachedHandleNumber--;
+    }
+    if (handle.statmFd >= 0) {
+        close(handle.statmFd);
+    }
+    if (handle.statusFd >= 0) {
+        close(handle.statusFd);
+    }
+
+    handle.statFd = -1;
+    handle.statmFd = -1;
+    handle.statusFd = -1;
+}
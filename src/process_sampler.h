@@ -0,0 +1,183 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROCESSSAMPLER_H
+#define PROCESSSAMPLER_H
+
+#include "proc_connector.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Per-process values read from /proc/pid/stat, /proc/pid/statm and /proc/pid/status.
+ * Field names follow procps' proc_t so the sampler can stand in for readproc().
+ */
+struct ProcessSample
+{
+    pid_t tid;
+    pid_t ppid;
+    char state;
+    char cmd[64];                       // basename of executable, from stat (limited to 16 chars by kernel)
+    unsigned long long utime;           // user mode clock ticks
+    unsigned long long stime;           // kernel mode clock ticks
+    unsigned long long start_time;      // clock ticks since boot when the process started
+    int nlwp;                           // number of threads
+    long resident;                      // resident set size in pages
+    long share;                         // shared pages
+    uid_t euid;
+    double pcpu;                        // filled in by the caller, not by the sampler
+};
+
+/**
+ * ProcessSampler walks /proc with getdents64 and keeps the stat/statm/status file descriptors
+ * of every live PID open between ticks, above FD_SETSIZE so select() users keep the low range,
+ * and each sample is a handful of pread() calls per process instead of openproc()/readproc()
+ * re-opening everything.
+ *
+ * Arrival and exit of PIDs are tracked incrementally by tagging cached handles with the
+ * generation of the scan that last saw them.
+ *
+ * Once a scan lists at least parallelThreshold tasks, reading is split into fixed-size shards
+ * that a small pool of worker threads claims from a shared cursor. Each shard writes into its
+ * own slice of a preallocated array indexed like the pid list, so the snapshot comes out in
+ * the same pid order no matter which thread read what. Opening and closing descriptors stays
+ * on the calling thread.
+ *
+ * When the proc connector can be subscribed to, births and exits come from its events and /proc
+ * is only listed again after events were lost, otherwise every sample lists /proc.
+ */
+class ProcessSampler final
+{
+public:
+    typedef std::vector<ProcessSample> Snapshot;
+
+    // Files read by sample(), stat is always read since it tells whether the process still exists.
+    enum SampleField {
+        StatField = 1,
+        StatmField = 2,
+        StatusField = 4,
+        AllFields = StatField | StatmField | StatusField
+    };
+
+    /*
+     * @parallelThreshold task count from which reads are spread over worker threads
+     * @workerNumber threads reading shards, calling thread included, 0 picks one per core
+     */
+    ProcessSampler(size_t parallelThreshold = 4096, unsigned int workerNumber = 0);
+    ~ProcessSampler();
+
+    void setParallelThreshold(size_t threshold);
+
+    /*
+     * @pids filled with processes that exec'd, were renamed or changed credentials since the last call,
+     *       always empty when births and exits aren't event driven
+     */
+    void takeChangedPids(std::vector<pid_t> &pids);
+
+    /*
+     * Whether births and exits come from the proc connector instead of listing /proc.
+     */
+    bool isEventDriven() const;
+
+    /*
+     * Sample all processes.
+     *
+     * @snapshot filled with one sample per live process, sorted by pid
+     * @fields files to read again, values of skipped files are the last ones read for that process
+     * @return false if /proc can't be read at all
+     */
+    bool sample(Snapshot &snapshot, unsigned int fields = AllFields);
+
+    /*
+     * Read a single process without touching the descriptor cache.
+     *
+     * @fields files to read, values of skipped files are left zero
+     */
+    static bool readProcess(pid_t pid, ProcessSample &sample, unsigned int fields = AllFields);
+
+private:
+    struct PidHandle
+    {
+        int statFd;
+        int statmFd;
+        int statusFd;
+        unsigned int generation;
+        long resident;                  // last statm values
+        long share;
+        uid_t euid;                     // last status value
+        unsigned int staleFields;       // files to read next time even if they aren't due
+    };
+
+    struct ReadTask
+    {
+        pid_t pid;
+        PidHandle *handle;
+        unsigned int fields;
+    };
+
+    bool openHandle(pid_t pid, PidHandle &handle);
+    bool readHandle(pid_t pid, PidHandle &handle, ProcessSample &sample, unsigned int fields = AllFields) const;
+    bool scanPids();
+    void closeHandle(PidHandle &handle);
+    void readParallel();
+    void readRange(size_t begin, size_t end);
+    void readShards();
+    void startWorkers();
+    void stopWorkers();
+    void workerLoop();
+
+    std::unordered_map<pid_t, PidHandle> handles;
+    std::vector<pid_t> pids;
+    std::vector<pid_t> changedPids;
+    std::vector<pid_t> eventPids;
+    ProcConnector *procConnector;
+    int procFd;
+    size_t cachedHandleLimit;
+    size_t cachedHandleNumber;
+    unsigned int generation;
+
+    // Per-tick read state, indexed like tasks.
+    std::vector<ReadTask> tasks;
+    std::vector<ProcessSample> samples;
+    std::vector<char> readResults;
+
+    // Shard pool, workers are only started the first time a scan crosses the threshold.
+    std::atomic<size_t> nextShard;
+    std::condition_variable doneCondition;
+    std::condition_variable workerCondition;
+    std::mutex workerMutex;
+    std::vector<std::thread> workers;
+    bool stopping;
+    size_t busyWorkerNumber;
+    size_t parallelThreshold;
+    size_t shardNumber;
+    unsigned int workerNumber;
+    unsigned int workerRound;
+};
+
+#endif
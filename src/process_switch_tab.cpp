@@ -29,7 +29,7 @@ ProcessSwitchTab::ProcessSwitchTab(QWidget *parent) : QWidget(parent)
     installEventFilter(this);   // add event filter
     setMouseTracking(true);    // make MouseMove can response
     
-    setFixedSize(width * 3, height);
+    setFixedSize(width * 4, height);
     
     onlyGuiNormalImage = QImage(Utils::getQrcPath("only_gui_normal.png"));
     onlyGuiHoverImage = QImage(Utils::getQrcPath("only_gui_hover.png"));
@@ -40,6 +40,9 @@ ProcessSwitchTab::ProcessSwitchTab(QWidget *parent) : QWidget(parent)
     allProcessNormalImage = QImage(Utils::getQrcPath("all_process_normal.png"));
     allProcessHoverImage = QImage(Utils::getQrcPath("all_process_hover.png"));
     allProcessActiveImage = QImage(Utils::getQrcPath("all_process_active.png"));
+    servicesNormalImage = QImage(Utils::getQrcPath("services_normal.png"));
+    servicesHoverImage = QImage(Utils::getQrcPath("services_hover.png"));
+    servicesActiveImage = QImage(Utils::getQrcPath("services_active.png"));
 }
 
 void ProcessSwitchTab::mouseMoveEvent(QMouseEvent *mouseEvent)
@@ -50,8 +53,10 @@ void ProcessSwitchTab::mouseMoveEvent(QMouseEvent *mouseEvent)
         hoverIndex = 0;
     } else if (mouseEvent->x() < width * 2) {
         hoverIndex = 1;
-    } else {
+    } else if (mouseEvent->x() < width * 3) {
         hoverIndex = 2;
+    } else {
+        hoverIndex = 3;
     }
     
     if (hoverIndex != prevHoverIndex) {
@@ -67,8 +72,10 @@ void ProcessSwitchTab::mousePressEvent(QMouseEvent *mouseEvent)
         activeIndex = 0;
     } else if (mouseEvent->x() < width * 2) {
         activeIndex = 1;
-    } else {
+    } else if (mouseEvent->x() < width * 3) {
         activeIndex = 2;
+    } else {
+        activeIndex = 3;
     }
     
     if (activeIndex != prevActiveIndex) {
@@ -96,32 +103,39 @@ void ProcessSwitchTab::paintEvent(QPaintEvent *)
     
     painter.drawLine(rect().x() + width, rect().y() + penSize + 1, rect().x() + width, rect().y() + rect().height() - penSize * 2 - 1);
     painter.drawLine(rect().x() + width * 2, rect().y() + penSize + 1, rect().x() + width * 2, rect().y() + rect().height() - penSize * 2 - 1);
+    painter.drawLine(rect().x() + width * 3, rect().y() + penSize + 1, rect().x() + width * 3, rect().y() + rect().height() - penSize * 2 - 1);
     
     painter.setOpacity(1);
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < 4; i++) {
         if (i == activeIndex) {
             if (i == 0) {
                 painter.drawImage(QPoint(rect().x() + width * i, rect().y()), onlyGuiActiveImage);
             } else if (i == 1) {
                 painter.drawImage(QPoint(rect().x() + width * i, rect().y()), onlyMeActiveImage);
-            } else {
+            } else if (i == 2) {
                 painter.drawImage(QPoint(rect().x() + width * i, rect().y()), allProcessActiveImage);
+            } else {
+                painter.drawImage(QPoint(rect().x() + width * i, rect().y()), servicesActiveImage);
             }
         } else if (i == hoverIndex) {
             if (i == 0) {
                 painter.drawImage(QPoint(rect().x() + width * i, rect().y()), onlyGuiHoverImage);
             } else if (i == 1) {
                 painter.drawImage(QPoint(rect().x() + width * i, rect().y()), onlyMeHoverImage);
-            } else {
+            } else if (i == 2) {
                 painter.drawImage(QPoint(rect().x() + width * i, rect().y()), allProcessHoverImage);
+            } else {
+                painter.drawImage(QPoint(rect().x() + width * i, rect().y()), servicesHoverImage);
             }
         } else {
             if (i == 0) {
                 painter.drawImage(QPoint(rect().x() + width * i, rect().y()), onlyGuiNormalImage);
             } else if (i == 1) {
                 painter.drawImage(QPoint(rect().x() + width * i, rect().y()), onlyMeNormalImage);
-            } else {
+            } else if (i == 2) {
                 painter.drawImage(QPoint(rect().x() + width * i, rect().y()), allProcessNormalImage);
+            } else {
+                painter.drawImage(QPoint(rect().x() + width * i, rect().y()), servicesNormalImage);
             }
         }
     }
@@ -54,6 +54,9 @@ private:
     QImage onlyMeActiveImage;
     QImage onlyMeHoverImage;
     QImage onlyMeNormalImage;
+    QImage servicesActiveImage;
+    QImage servicesHoverImage;
+    QImage servicesNormalImage;
     int activeIndex = 0;
     int height = 24;
     int hoverIndex = -1;
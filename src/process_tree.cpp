@@ -22,93 +22,163 @@
  */ 
 
 #include "process_tree.h"
-#include <QDebug>
+#include <algorithm>
 
-ProcessTree::ProcessTree()
+void ProcessTree::build(const ProcessSampler::Snapshot &processes)
 {
-    processMap = new QMap<int, Process>();
+    pids.resize(processes.size());
+    ppids.resize(processes.size());
+    for (size_t index = 0; index < processes.size(); index++) {
+        pids[index] = processes[index].tid;
+        ppids[index] = processes[index].ppid;
+    }
 
-    rootPid = INT_MAX;
+    link(ppids);
 }
 
-ProcessTree::~ProcessTree()
+void ProcessTree::build(const std::vector<pid_t> &processPids, const std::vector<pid_t> &parentPids)
 {
-    childrenPids.clear();
-    
-    for (auto v : processMap->values()) {
-        v.childProcesses.clear();
-    }
+    pids = processPids;
 
-    processMap->clear();
-    delete processMap;
+    link(parentPids);
 }
 
-void ProcessTree::scanProcesses(storedProcType processes)
+void ProcessTree::link(const std::vector<pid_t> &parentPids)
 {
-    for(auto &i:processes) {
-        int ppid = (&i.second)->ppid;
-        int pid = (&i.second)->tid;
-
-        if (!processMap->contains(pid)) {
-            Process process;
+    int number = static_cast<int>(pids.size());
+
+    // Count children first, then hand every parent its slice. Processes are visited in pid order,
+    // so every slice comes out sorted.
+    parents.assign(number, -1);
+    childOffsets.assign(number + 1, 0);
+    for (int index = 0; index < number; index++) {
+        int parent = indexOf(parentPids[index]);
+        if (parent >= 0 && parent != index) {
+            parents[index] = parent;
+            childOffsets[parent + 1]++;
+        }
+    }
+    for (int index = 0; index < number; index++) {
+        childOffsets[index + 1] += childOffsets[index];
+    }
+    childList.resize(childOffsets[number]);
+    stack.assign(childOffsets.begin(), childOffsets.end() - 1);
+    for (int index = 0; index < number; index++) {
+        if (parents[index] >= 0) {
+            childList[stack[parents[index]]++] = index;
+        }
+    }
 
-            process.parentPid = ppid;
+    // Number processes in preorder. Children go on the stack backwards to come off it in pid order.
+    // A sample isn't read atomically, a process that isn't reached from any root is made one.
+    order.clear();
+    order.reserve(number);
+    enters.assign(number, -1);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int root = 0; root < number; root++) {
+            if (enters[root] >= 0 || (pass == 0 && parents[root] >= 0)) {
+                continue;
+            }
+            parents[root] = -1;
+
+            stack.clear();
+            stack.push_back(root);
+            while (!stack.empty()) {
+                int index = stack.back();
+                stack.pop_back();
+                enters[index] = order.size();
+                order.push_back(index);
+
+                for (int child = childOffsets[index + 1] - 1; child >= childOffsets[index]; child--) {
+                    if (enters[childList[child]] < 0) {
+                        stack.push_back(childList[child]);
+                    }
+                }
+            }
+        }
+    }
 
-            (*processMap)[pid] = process;
+    // Subtree sizes, every process comes after its parent in preorder so one backward pass adds them up.
+    exits.assign(number, 1);
+    for (int position = number - 1; position >= 0; position--) {
+        int index = order[position];
+        if (parents[index] >= 0) {
+            exits[parents[index]] += exits[index];
         }
+    }
+    for (int index = 0; index < number; index++) {
+        exits[index] += enters[index];
+    }
+}
 
-        if (!processMap->contains(ppid)) {
-            Process process;
+int ProcessTree::size() const
+{
+    return pids.size();
+}
 
-            process.parentPid = -1;
-            process.childProcesses.append(pid);
+int ProcessTree::indexOf(pid_t pid) const
+{
+    // Pids are sorted, a binary search needs nothing rebuilt on every tick.
+    auto index = std::lower_bound(pids.begin(), pids.end(), pid);
 
-            (*processMap)[ppid] = process;
-        } else {
-            (*processMap)[ppid].childProcesses.append(pid);
-        }
+    return index != pids.end() && *index == pid ? static_cast<int>(index - pids.begin()) : -1;
+}
 
-        if (pid < rootPid) {
-            rootPid = pid;
-        }
-    }
+pid_t ProcessTree::pidAt(int index) const
+{
+    return pids[index];
 }
 
-QList<int> ProcessTree::getAllChildPids(int pid)
+int ProcessTree::parentOf(int index) const
 {
-    childrenPids.clear();
+    return parents[index];
+}
 
-    getChildPids(pid);
+int ProcessTree::childBegin(int index) const
+{
+    return childOffsets[index];
+}
 
-    return childrenPids;
+int ProcessTree::childEnd(int index) const
+{
+    return childOffsets[index + 1];
 }
 
-void ProcessTree::getChildPids(int pid)
+const std::vector<int>& ProcessTree::children() const
 {
-    if (processMap->contains(pid)) {
-        for (int childPid : ((*processMap)[pid].childProcesses)) {
-            childrenPids.append(childPid);
-            
-            getChildPids(childPid);
-        }
-    }
+    return childList;
 }
 
-void ProcessTree::printNode(int pid)
+const std::vector<int>& ProcessTree::preorder() const
 {
-    qDebug() << "* Node " << pid;
+    return order;
+}
 
-    if (processMap->contains(pid)) {
-        qDebug() << "### Child " << (*processMap)[pid].childProcesses;
+int ProcessTree::enterOf(int index) const
+{
+    return enters[index];
+}
 
-        for (int childPid : ((*processMap)[pid].childProcesses)) {
-            printNode(childPid);
-        }
-    }
+int ProcessTree::exitOf(int index) const
+{
+    return exits[index];
 }
 
-void ProcessTree::printTree()
+bool ProcessTree::isDescendant(int index, int ancestor) const
 {
-    printNode(rootPid);
+    return enters[ancestor] < enters[index] && enters[index] < exits[ancestor];
 }
 
+void ProcessTree::getDescendantPids(pid_t pid, std::vector<pid_t> &descendants) const
+{
+    descendants.clear();
+
+    int index = indexOf(pid);
+    if (index < 0) {
+        return;
+    }
+
+    for (int position = enters[index] + 1; position < exits[index]; position++) {
+        descendants.push_back(pids[order[position]]);
+    }
+}
@@ -24,37 +24,116 @@
 #ifndef PROCESSTREE_H
 #define PROCESSTREE_H
 
-#include <QMap>
-#include <QObject>
-#include <proc/readproc.h>
-#include <proc/sysinfo.h>
+#include "process_sampler.h"
+#include <sys/types.h>
+#include <vector>
 
-class ProcessTree : public QObject
+/**
+ * ProcessTree lays the parent/child relation of one sample out in flat arrays, built with one binary
+ * search per process and reused from tick to tick without allocating once it has grown to the process count.
+ *
+ * Processes are referred to by their index in the sample, which is sorted by pid. Children of a
+ * process are one slice of a shared array (compressed sparse rows), in pid order. The tree is walked
+ * once to number processes in preorder: the subtree of a process is the range from its own position
+ * up to its exit position, so "is x below y" is two comparisons and the sum of any subtree is one
+ * subtraction of prefix sums, with no recursion anywhere.
+ */
+class ProcessTree final
 {
-    Q_OBJECT
-    
-    typedef std::map<int, proc_t> storedProcType;
-    
-    struct Process
-    {
-        int parentPid;
-        QList<int> childProcesses;
-    };
-    
 public:
-    ProcessTree();
-    ~ProcessTree();
-    
-    QList<int> getAllChildPids(int pid);
-    void getChildPids(int pid);
-    void printNode(int pid);
-    void printTree();
-    void scanProcesses(storedProcType processes);
-    
+    /*
+     * Build the tree of a sample, processes whose parent isn't in the sample are roots.
+     *
+     * @processes sorted by pid, as returned by ProcessSampler::sample()
+     */
+    void build(const ProcessSampler::Snapshot &processes);
+
+    /*
+     * Build the tree of any set of processes, such as the rows of a snapshot.
+     *
+     * @processPids sorted by pid
+     * @parentPids parent of each process, indexed like processPids
+     */
+    void build(const std::vector<pid_t> &processPids, const std::vector<pid_t> &parentPids);
+
+    int size() const;
+
+    /*
+     * @return index of a process, -1 if it isn't in the sample
+     */
+    int indexOf(pid_t pid) const;
+    pid_t pidAt(int index) const;
+
+    /*
+     * @return index of the parent, -1 for roots
+     */
+    int parentOf(int index) const;
+
+    /*
+     * Children of a process are children()[childBegin(index)] up to children()[childEnd(index)].
+     */
+    int childBegin(int index) const;
+    int childEnd(int index) const;
+    const std::vector<int>& children() const;
+
+    /*
+     * Process indexes in preorder, every process comes after its parent and before its descendants.
+     */
+    const std::vector<int>& preorder() const;
+
+    /*
+     * The subtree of a process is preorder()[enterOf(index)] up to preorder()[exitOf(index)], itself first.
+     */
+    int enterOf(int index) const;
+    int exitOf(int index) const;
+
+    /*
+     * Whether a process is below another one, a process isn't its own descendant.
+     */
+    bool isDescendant(int index, int ancestor) const;
+
+    /*
+     * Pids of every process below one, in preorder.
+     */
+    void getDescendantPids(pid_t pid, std::vector<pid_t> &descendants) const;
+
+    /*
+     * Prepare sums over subtrees.
+     *
+     * @values one per process, indexed like the sample
+     * @prefix filled with prefix sums in preorder, for subtreeSum()
+     */
+    template <typename T>
+    void prefixSums(const std::vector<T> &values, std::vector<T> &prefix) const
+    {
+        prefix.resize(order.size() + 1);
+        prefix[0] = T();
+        for (size_t position = 0; position < order.size(); position++) {
+            prefix[position + 1] = prefix[position] + values[order[position]];
+        }
+    }
+
+    /*
+     * Value of a process plus those of all its descendants.
+     */
+    template <typename T>
+    T subtreeSum(const std::vector<T> &prefix, int index) const
+    {
+        return prefix[exits[index]] - prefix[enters[index]];
+    }
+
 private:
-    QList<int> childrenPids;
-    QMap<int, Process> *processMap;
-    int rootPid;
+    void link(const std::vector<pid_t> &parentPids);
+
+    std::vector<pid_t> pids;
+    std::vector<int> parents;
+    std::vector<pid_t> ppids;
+    std::vector<int> childOffsets;
+    std::vector<int> childList;
+    std::vector<int> order;
+    std::vector<int> enters;
+    std::vector<int> exits;
+    std::vector<int> stack;
 };
 
 #endif
@@ -0,0 +1,87 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "refresh_scheduler.h"
+
+RefreshScheduler::RefreshScheduler()
+{
+    currentTick = 0;
+    forced = false;
+    forcedTick = true;
+
+    setTier(ProcessStat, EveryTick);
+    setTier(ProcessMemory, EveryTick);
+    setTier(ProcessOwner, EveryNTicks, 10);
+    setTier(ProcessIdentity, OncePerExec);
+    setTier(ProcessIO, OnDemand);
+    setTier(WindowTitles, EveryTick);
+    setTier(DesktopEntries, EveryNTicks, 5);
+}
+
+void RefreshScheduler::setTier(Metric metric, RefreshTier tier, unsigned int interval)
+{
+    schedules[metric].tier = tier;
+    schedules[metric].interval = interval > 0 ? interval : 1;
+}
+
+RefreshTier RefreshScheduler::tier(Metric metric) const
+{
+    return schedules[metric].tier;
+}
+
+void RefreshScheduler::beginTick()
+{
+    currentTick++;
+
+    // The first tick has nothing to reuse, so it fetches everything as well.
+    forcedTick = forced || currentTick == 1;
+    forced = false;
+}
+
+void RefreshScheduler::requestAll()
+{
+    forced = true;
+}
+
+bool RefreshScheduler::isDue(Metric metric, bool execChanged, bool visible) const
+{
+    const Schedule &schedule = schedules[metric];
+
+    switch (schedule.tier) {
+    case EveryTick:
+        return true;
+    case EveryNTicks:
+        return forcedTick || currentTick % schedule.interval == 0;
+    case OncePerExec:
+        return execChanged;
+    case OnDemand:
+        return visible;
+    }
+
+    return true;
+}
+
+unsigned int RefreshScheduler::tick() const
+{
+    return currentTick;
+}
@@ -0,0 +1,93 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+/**
+ * How often a data source has to be fetched again.
+ */
+enum RefreshTier {
+    EveryTick,                          // volatile counters: cpu ticks, io
+    EveryNTicks,                        // slowly changing values, fetched every interval ticks
+    OncePerExec,                        // fixed for the lifetime of an executable image: cmdline, desktop match
+    OnDemand                            // only fetched for rows that are shown
+};
+
+/**
+ * RefreshScheduler holds the tier of every metric the sampler collects and tells it which ones are due.
+ * Tiers are declared in one table in the constructor, so moving a metric to another cadence is a one line change.
+ */
+class RefreshScheduler final
+{
+public:
+    enum Metric {
+        ProcessStat,                    // /proc/pid/stat: state, ppid, cpu ticks
+        ProcessMemory,                  // /proc/pid/statm
+        ProcessOwner,                   // /proc/pid/status: effective uid
+        ProcessIdentity,                // /proc/pid/cmdline, process name and desktop file
+        ProcessIO,                      // /proc/pid/io
+        WindowTitles,                   // X11 window list
+        DesktopEntries,                 // inotify events of application directories
+        MetricNumber
+    };
+
+    RefreshScheduler();
+
+    void setTier(Metric metric, RefreshTier tier, unsigned int interval = 1);
+    RefreshTier tier(Metric metric) const;
+
+    /*
+     * Advance to the next tick.
+     */
+    void beginTick();
+
+    /*
+     * Make every EveryNTicks metric due on the next tick, e.g. after the view changed.
+     */
+    void requestAll();
+
+    /*
+     * Whether a metric should be fetched now.
+     *
+     * @execChanged the process is new or exec'd since the metric was last fetched (OncePerExec)
+     * @visible the process is shown in the list (OnDemand)
+     */
+    bool isDue(Metric metric, bool execChanged = false, bool visible = false) const;
+
+    unsigned int tick() const;
+
+private:
+    struct Schedule
+    {
+        RefreshTier tier;
+        unsigned int interval;
+    };
+
+    Schedule schedules[MetricNumber];
+    bool forced;
+    bool forcedTick;
+    unsigned int currentTick;
+};
+
+#endif
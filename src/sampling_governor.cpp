@@ -0,0 +1,128 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sampling_governor.h"
+#include <time.h>
+
+// Ticks between two runs of every stage at each degrade level, 0 means the stage doesn't run.
+// Every level drops one more optional stage, the process list itself is only slowed down.
+static const unsigned int STAGE_INTERVALS[][SamplingGovernor::StageNumber] = {
+    // ProcessList  WindowTitles  ProcessIO  ThreadPrefetch
+    {  1,           1,            1,         1 },
+    {  1,           1,            1,         0 },
+    {  1,           1,            0,         0 },
+    {  1,           5,            0,         0 },
+    {  2,           5,            0,         0 },
+};
+static const int LEVEL_NUMBER = sizeof(STAGE_INTERVALS) / sizeof(STAGE_INTERVALS[0]);
+
+// Nothing but machine totals while the window can't be seen.
+static const unsigned int HIDDEN_INTERVALS[SamplingGovernor::StageNumber] = {0, 0, 0, 0};
+
+// Ticks under half the budget needed before a dropped stage comes back.
+static const int RECOVER_TICKS = 5;
+
+SamplingGovernor::SamplingGovernor()
+{
+    cpuBudget = 0;
+    level = 0;
+    quietTicks = 0;
+    tick = 0;
+    tickCpuTime = 0;
+    tickInterval = 1000;
+    visible = true;
+}
+
+void SamplingGovernor::setCpuBudget(double budget, int interval)
+{
+    cpuBudget = budget;
+    tickInterval = interval;
+
+    if (cpuBudget <= 0) {
+        level = 0;
+    }
+}
+
+void SamplingGovernor::setVisible(bool shown)
+{
+    visible = shown;
+}
+
+bool SamplingGovernor::isVisible() const
+{
+    return visible;
+}
+
+void SamplingGovernor::beginTick()
+{
+    tick++;
+    tickCpuTime = processCpuTime();
+}
+
+void SamplingGovernor::endTick()
+{
+    // Hidden ticks are cheap by design, they say nothing about what a full tick costs.
+    if (!visible || cpuBudget <= 0) {
+        return;
+    }
+
+    // Worker threads reading /proc count too, so measure the whole process rather than the sampler thread.
+    double percent = (processCpuTime() - tickCpuTime) / 1000.0 / tickInterval * 100;
+
+    if (percent > cpuBudget) {
+        quietTicks = 0;
+        if (level < LEVEL_NUMBER - 1) {
+            level++;
+        }
+    } else if (percent < cpuBudget / 2 && level > 0) {
+        if (++quietTicks >= RECOVER_TICKS) {
+            quietTicks = 0;
+            level--;
+        }
+    } else {
+        quietTicks = 0;
+    }
+}
+
+bool SamplingGovernor::isDue(Stage stage) const
+{
+    unsigned int interval = visible ? STAGE_INTERVALS[level][stage] : HIDDEN_INTERVALS[stage];
+
+    return interval != 0 && tick % interval == 0;
+}
+
+int SamplingGovernor::degradeLevel() const
+{
+    return level;
+}
+
+long long SamplingGovernor::processCpuTime()
+{
+    struct timespec time;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) != 0) {
+        return 0;
+    }
+
+    // Microseconds.
+    return static_cast<long long>(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+}
@@ -0,0 +1,84 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SAMPLINGGOVERNOR_H
+#define SAMPLINGGOVERNOR_H
+
+/**
+ * SamplingGovernor decides which optional stages of a tick run, so the monitor stays cheap.
+ *
+ * While the window can't be seen, the process list and everything built on it is paused and only
+ * machine totals keep being sampled. While it is shown, the cpu the process spends in every tick
+ * is measured against a budget: a tick over budget drops the next optional stage, and stages come
+ * back one by one once ticks have stayed well under budget for a while.
+ */
+class SamplingGovernor final
+{
+public:
+    enum Stage {
+        ProcessList,                    // /proc walk, rows, exit accounting
+        WindowTitles,                   // X11 window list
+        ProcessIO,                      // disk counters of listed processes
+        ThreadPrefetch,                 // threads of busy collapsed processes, expanded ones are always read
+        StageNumber
+    };
+
+    SamplingGovernor();
+
+    /*
+     * @budget share of one cpu the monitor may spend sampling, in percent, 0 turns degrading off
+     * @interval milliseconds between two ticks
+     */
+    void setCpuBudget(double budget, int interval);
+    void setVisible(bool visible);
+    bool isVisible() const;
+
+    /*
+     * Call around every tick, endTick() measures the tick and adjusts the degrade level.
+     */
+    void beginTick();
+    void endTick();
+
+    /*
+     * Whether a stage runs in the current tick.
+     */
+    bool isDue(Stage stage) const;
+
+    /*
+     * Number of optional stages currently degraded, 0 when within budget.
+     */
+    int degradeLevel() const;
+
+private:
+    static long long processCpuTime();
+
+    double cpuBudget;
+    long long tickCpuTime;
+    int level;
+    int quietTicks;
+    int tickInterval;
+    unsigned int tick;
+    bool visible;
+};
+
+#endif
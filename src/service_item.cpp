@@ -0,0 +1,69 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "service_item.h"
+
+ServiceItem::ServiceItem(QPixmap serviceIcon, QString serviceName, QString servicePath, double serviceCpu, long serviceMemory, int serviceProcessNumber)
+    : ProcessItem(serviceIcon, serviceName, serviceName, serviceCpu, serviceMemory, 0, "", 'S')
+{
+    path = servicePath;
+    processNumber = serviceProcessNumber;
+
+    padding = 14;
+}
+
+void ServiceItem::drawForeground(QRect rect, QPainter *painter, int column, int index, bool isSelect)
+{
+    if (column != 9) {
+        ProcessItem::drawForeground(rect, painter, column, index, isSelect);
+        return;
+    }
+
+    // Draw process number where processes have their pid.
+    if (isSelect) {
+        painter->setPen(QPen(QColor("#ffffff")));
+        painter->setOpacity(1);
+    } else {
+        painter->setPen(QPen(QColor("#666666")));
+        painter->setOpacity(0.5);
+    }
+
+    setFontSize(*painter, 9);
+    painter->drawText(QRect(rect.x(), rect.y(), rect.width() - padding, rect.height()), Qt::AlignRight | Qt::AlignVCenter, QString("%1个进程").arg(processNumber));
+}
+
+QString ServiceItem::getPath() const
+{
+    return path;
+}
+
+int ServiceItem::getProcessNumber() const
+{
+    return processNumber;
+}
+
+void ServiceItem::updateServiceStatus(double serviceCpu, long serviceMemory, int serviceProcessNumber)
+{
+    updateStatus(getName(), getDisplayName(), serviceCpu, serviceMemory, "", 'S');
+    processNumber = serviceProcessNumber;
+}
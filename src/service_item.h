@@ -0,0 +1,52 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERVICEITEM_H
+#define SERVICEITEM_H
+
+#include "process_item.h"
+
+/**
+ * A systemd unit row of the services tab.
+ * Services have no pid of their own, the last column shows how many processes they run instead.
+ */
+class ServiceItem : public ProcessItem
+{
+    Q_OBJECT
+    
+public:
+    ServiceItem(QPixmap serviceIcon, QString serviceName, QString servicePath, double serviceCpu, long serviceMemory, int serviceProcessNumber);
+    
+    void drawForeground(QRect rect, QPainter *painter, int column, int index, bool isSelect);
+    
+    QString getPath() const;
+    int getProcessNumber() const;
+    void updateServiceStatus(double serviceCpu, long serviceMemory, int serviceProcessNumber);
+    
+private:
+    QString path;
+    int padding;
+    int processNumber;
+};
+
+#endif
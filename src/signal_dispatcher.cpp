@@ -0,0 +1,267 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "signal_dispatcher.h"
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <unordered_set>
+
+// Older C libraries don't name the pidfd system calls yet, new calls share their number across architectures.
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+static int pidfdOpen(pid_t pid)
+{
+    return syscall(SYS_pidfd_open, pid, 0);
+}
+
+static int pidfdSendSignal(int pidfd, int signal)
+{
+    return syscall(SYS_pidfd_send_signal, pidfd, signal, nullptr, 0);
+}
+
+SignalDispatcher::SignalDispatcher()
+{
+    // Only ENOSYS tells an old kernel apart, opening ourselves can't fail otherwise.
+    int pidfd = pidfdOpen(getpid());
+    pidfdSupported = pidfd >= 0 || errno != ENOSYS;
+    if (pidfd >= 0) {
+        close(pidfd);
+    }
+}
+
+SignalDispatcher::~SignalDispatcher()
+{
+    clear();
+}
+
+void SignalDispatcher::pin(pid_t pid, unsigned long long startTime)
+{
+    Target target;
+    open(pid, startTime, target);
+    targets.push_back(target);
+}
+
+void SignalDispatcher::clear()
+{
+    closeTargets(targets);
+}
+
+bool SignalDispatcher::isEmpty() const
+{
+    return targets.empty();
+}
+
+void SignalDispatcher::send(int signal, bool tree, std::vector<Result> &results)
+{
+    results.clear();
+
+    // The monitor never stops itself or a process it runs under, a session or terminal picked by the user
+    // say: nobody would be left to continue them. The chain is read again, parents may have exited since.
+    listMonitorPids();
+
+    // Descendants are only pinned for this batch, the tree may look different next time.
+    if (tree) {
+        listProcesses();
+        processTree.build(processes);
+
+        // The monitor never signals itself as somebody's descendant.
+        std::unordered_set<pid_t> seen;
+        seen.insert(getpid());
+        for (const Target &target : targets) {
+            seen.insert(target.pid);
+        }
+
+        for (const Target &target : targets) {
+            // A pinned process that exited has no subtree any more, its pid may lead to somebody else's.
+            if (sendTo(target, 0) == ESRCH) {
+                continue;
+            }
+
+            processTree.getDescendantPids(target.pid, descendants);
+            for (pid_t pid : descendants) {
+                Target child;
+                if (seen.insert(pid).second && open(pid, processes[processTree.indexOf(pid)].start_time, child)) {
+                    batch.push_back(child);
+                }
+            }
+        }
+    }
+
+    bool frozen = tree && signal != SIGSTOP && signal != SIGCONT;
+    if (frozen) {
+        freeze(targets);
+        freeze(batch);
+    }
+
+    // Refused stops are reported like failed ones, so the user learns why those kept running.
+    results.reserve(targets.size() + batch.size());
+    for (const Target &target : targets) {
+        results.push_back({target.pid, signal == SIGSTOP && monitorPids.count(target.pid) != 0 ? EPERM : sendTo(target, signal)});
+    }
+    for (const Target &target : batch) {
+        results.push_back({target.pid, signal == SIGSTOP && monitorPids.count(target.pid) != 0 ? EPERM : sendTo(target, signal)});
+    }
+
+    if (frozen) {
+        thaw(targets);
+        thaw(batch);
+    }
+
+    closeTargets(batch);
+}
+
+bool SignalDispatcher::open(pid_t pid, unsigned long long startTime, Target &target) const
+{
+    target.pid = pid;
+    target.startTime = startTime;
+    target.pidfd = -1;
+    target.gone = true;
+    target.frozen = false;
+
+    if (pidfdSupported) {
+        target.pidfd = pidfdOpen(pid);
+        if (target.pidfd < 0) {
+            return false;
+        }
+    }
+
+    // The pidfd refers to whatever has the pid now, which has to be the process that was listed.
+    ProcessSample sample;
+    if (!ProcessSampler::readProcess(pid, sample, ProcessSampler::StatField) || (startTime != 0 && sample.start_time != startTime)) {
+        if (target.pidfd >= 0) {
+            close(target.pidfd);
+            target.pidfd = -1;
+        }
+        return false;
+    }
+    target.startTime = sample.start_time;
+    target.gone = false;
+
+    return true;
+}
+
+int SignalDispatcher::sendTo(const Target &target, int signal) const
+{
+    if (target.gone) {
+        return ESRCH;
+    }
+
+    if (target.pidfd >= 0) {
+        return pidfdSendSignal(target.pidfd, signal) == 0 ? 0 : errno;
+    }
+
+    // Without pidfds the pid is only trusted if it still started at the same time.
+    ProcessSample sample;
+    if (!ProcessSampler::readProcess(target.pid, sample, ProcessSampler::StatField) || sample.start_time != target.startTime) {
+        return ESRCH;
+    }
+
+    return kill(target.pid, signal) == 0 ? 0 : errno;
+}
+
+void SignalDispatcher::freeze(std::vector<Target> &frozen) const
+{
+    // Stopped and traced processes are left as they are, only the ones stopped here get continued.
+    for (Target &target : frozen) {
+        if (monitorPids.count(target.pid) != 0) {
+            target.frozen = false;
+            continue;
+        }
+
+        ProcessSample sample;
+        bool running = ProcessSampler::readProcess(target.pid, sample, ProcessSampler::StatField)
+            && sample.state != 'T' && sample.state != 't';
+        target.frozen = running && sendTo(target, SIGSTOP) == 0;
+    }
+}
+
+void SignalDispatcher::thaw(const std::vector<Target> &thawed) const
+{
+    for (const Target &target : thawed) {
+        if (target.frozen) {
+            sendTo(target, SIGCONT);
+        }
+    }
+}
+
+void SignalDispatcher::closeTargets(std::vector<Target> &closed)
+{
+    for (const Target &target : closed) {
+        if (target.pidfd >= 0) {
+            close(target.pidfd);
+        }
+    }
+    closed.clear();
+}
+
+void SignalDispatcher::listMonitorPids()
+{
+    monitorPids.clear();
+
+    // Parents are walked up from /proc directly, no listing of every process is needed for that.
+    ProcessSample sample;
+    pid_t pid = getpid();
+    while (pid > 0 && monitorPids.insert(pid).second && ProcessSampler::readProcess(pid, sample, ProcessSampler::StatField)) {
+        pid = sample.ppid;
+    }
+}
+
+void SignalDispatcher::listProcesses()
+{
+    processes.clear();
+
+    DIR *dir = opendir("/proc");
+    if (dir == nullptr) {
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        char *end;
+        long pid = strtol(entry->d_name, &end, 10);
+        if (*end != '\0' || pid <= 0) {
+            continue;
+        }
+
+        ProcessSample sample;
+        if (ProcessSampler::readProcess(pid, sample, ProcessSampler::StatField)) {
+            processes.push_back(sample);
+        }
+    }
+    closedir(dir);
+
+    // The tree numbers children in pid order, readdir() gives no order at all.
+    std::sort(processes.begin(), processes.end(), [](const ProcessSample &sample1, const ProcessSample &sample2) {
+            return sample1.tid < sample2.tid;
+        });
+}
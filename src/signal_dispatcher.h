@@ -0,0 +1,120 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIGNALDISPATCHER_H
+#define SIGNALDISPATCHER_H
+
+#include "process_sampler.h"
+#include "process_tree.h"
+#include <sys/types.h>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * SignalDispatcher sends signals to processes the user picked, without racing against pid reuse.
+ *
+ * Processes are pinned with pidfd_open() as soon as they're picked, and checked against the
+ * start time their row was sampled with, since the pid may have been reused before the pick.
+ * A pidfd keeps referring to the process it was opened for, once that has exited
+ * pidfd_send_signal() fails with ESRCH instead of hitting whatever took over the pid in the meantime.
+ *
+ * A signal can go to whole subtrees in one batch. Descendants are listed from /proc when the
+ * signal is sent, so children forked after the pick are included, and are pinned the same way.
+ * A descendant is checked against the start time it was listed with once its pidfd is open,
+ * since its pid may have been reused between listing and opening. Subtrees that are terminated
+ * are stopped first, so they fork no further while the batch goes out, and continued once every process has
+ * its signal pending. Processes that were stopped before are left stopped, the user may have stopped them
+ * on purpose, they act on the signal once they're continued. The monitor and the processes it runs under
+ * are never stopped, a stop sent to them fails with EPERM, and the monitor is left out of the subtrees it signals.
+ *
+ * Kernels without pidfds (before 5.3) get kill(), right after the start time was checked again.
+ */
+class SignalDispatcher final
+{
+public:
+    /*
+     * Outcome of one process, error is 0 or the errno of the failed delivery.
+     */
+    struct Result
+    {
+        pid_t pid;
+        int error;
+    };
+
+    SignalDispatcher();
+    ~SignalDispatcher();
+
+    /*
+     * Pin a process to signal later, next to those pinned before.
+     *
+     * @startTime start time the process was sampled with, 0 takes whatever runs under the pid now
+     */
+    void pin(pid_t pid, unsigned long long startTime);
+
+    /*
+     * Forget pinned processes, and close their pidfds.
+     */
+    void clear();
+
+    bool isEmpty() const;
+
+    /*
+     * Send a signal to every pinned process.
+     *
+     * @tree send it to every process below them too
+     * @results filled with one result per process, pinned ones first, descendants in preorder
+     */
+    void send(int signal, bool tree, std::vector<Result> &results);
+
+private:
+    struct Target
+    {
+        pid_t pid;
+        unsigned long long startTime;
+        int pidfd;                      // -1 without pidfd support or if the process was gone when pinned
+        bool gone;
+        bool frozen;                    // stopped by the batch being sent, continued once it's out
+    };
+
+    /*
+     * @startTime start time the process was listed with, 0 takes whatever runs under the pid now
+     * @return false if the process is gone, target is still filled in to report it
+     */
+    bool open(pid_t pid, unsigned long long startTime, Target &target) const;
+    int sendTo(const Target &target, int signal) const;
+    void freeze(std::vector<Target> &frozen) const;
+    void thaw(const std::vector<Target> &thawed) const;
+    void closeTargets(std::vector<Target> &closed);
+    void listMonitorPids();
+    void listProcesses();
+
+    ProcessSampler::Snapshot processes;
+    ProcessTree processTree;
+    std::vector<Target> targets;
+    std::vector<Target> batch;
+    std::vector<pid_t> descendants;
+    std::unordered_set<pid_t> monitorPids;  // the monitor and its ancestors when the last signal was sent
+    bool pidfdSupported;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot_player.h"
+#include <QDebug>
+
+// Longest wait between two frames at normal speed, in milliseconds, longer gaps are times the recorder wasn't running.
+static const long long MAX_FRAME_GAP = 10000;
+
+SnapshotPlayer::SnapshotPlayer(QString path, bool maxSpeed) : SnapshotSource()
+{
+    this->path = path;
+    this->maxSpeed = maxSpeed;
+
+    playTimer = nullptr;
+    reader = nullptr;
+    nextSnapshot = nullptr;
+    frameNumber = 0;
+    nextTime = 0;
+}
+
+SnapshotPlayer::~SnapshotPlayer()
+{
+    stop();
+}
+
+void SnapshotPlayer::start()
+{
+    reader = SnapshotReader::open(path);
+    if (reader == nullptr) {
+        qDebug() << "Can't replay" << path << ", it isn't a recording.";
+        return;
+    }
+
+    // At maximum speed the timer only polls whether the GUI took the last frame.
+    playTimer = new QTimer(this);
+    playTimer->setSingleShot(!maxSpeed);
+    connect(playTimer, &QTimer::timeout, this, &SnapshotPlayer::playFrame);
+
+    replayTimer.start();
+    frameNumber = 0;
+
+    if (!readFrame()) {
+        qDebug() << "Recording" << path << "holds no frames.";
+        return;
+    }
+    if (maxSpeed) {
+        playTimer->start(1);
+    }
+    playFrame();
+}
+
+void SnapshotPlayer::stop()
+{
+    if (playTimer != nullptr) {
+        playTimer->stop();
+        delete playTimer;
+        playTimer = nullptr;
+    }
+
+    delete reader;
+    delete nextSnapshot;
+
+    reader = nullptr;
+    nextSnapshot = nullptr;
+}
+
+bool SnapshotPlayer::readFrame()
+{
+    nextSnapshot = new StatusSnapshot();
+    if (!reader->next(*nextSnapshot, nextTime)) {
+        delete nextSnapshot;
+        nextSnapshot = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void SnapshotPlayer::playFrame()
+{
+    // A frame published before the GUI took the last one would replace it unseen.
+    if (nextSnapshot == nullptr || (maxSpeed && hasPendingSnapshot())) {
+        return;
+    }
+
+    // Recordings hold rows only, their tree is built as they're played.
+    if (isTreeMode()) {
+        buildRowTree(nextSnapshot);
+    }
+
+    long long frameTime = nextTime;
+    publish(StatusSnapshotPtr(nextSnapshot));
+    nextSnapshot = nullptr;
+    frameNumber++;
+
+    if (!readFrame()) {
+        qDebug() << "Replay finished," << frameNumber << "frames in" << replayTimer.elapsed() << "ms.";
+        playTimer->stop();
+        return;
+    }
+
+    if (!maxSpeed) {
+        playTimer->start(qBound(0LL, nextTime - frameTime, MAX_FRAME_GAP));
+    }
+}
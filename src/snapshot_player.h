@@ -0,0 +1,74 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SNAPSHOTPLAYER_H
+#define SNAPSHOTPLAYER_H
+
+#include "snapshot_recording.h"
+#include "snapshot_source.h"
+#include <QElapsedTimer>
+#include <QTimer>
+
+/**
+ * SnapshotPlayer feeds a recording to StatusMonitor in place of the live sampler.
+ *
+ * At normal speed frames are as far apart as they were recorded, gaps left by the recorder not
+ * running are cut short. At maximum speed the next frame is published as soon as the GUI took
+ * the previous one, which makes a recording a repeatable load for ListView and the monitors.
+ *
+ * Rows are shown as they were recorded, switching tabs or expanding processes has no effect.
+ * Tree mode still works, the tree is built from the parent pid of each recorded row.
+ */
+class SnapshotPlayer : public SnapshotSource
+{
+    Q_OBJECT
+
+public:
+    /*
+     * @path recording to play
+     * @maxSpeed wait for the GUI only, not for the recorded time between frames
+     */
+    SnapshotPlayer(QString path, bool maxSpeed);
+    ~SnapshotPlayer();
+
+public slots:
+    void start();
+    void stop();
+
+private slots:
+    void playFrame();
+
+private:
+    bool readFrame();
+
+    QElapsedTimer replayTimer;
+    QString path;
+    QTimer *playTimer;
+    SnapshotReader *reader;
+    StatusSnapshot *nextSnapshot;
+    bool maxSpeed;
+    int frameNumber;
+    long long nextTime;
+};
+
+#endif
@@ -0,0 +1,570 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot_recording.h"
+#include <QHash>
+#include <QVector>
+#include <array>
+#include <math.h>
+#include <stdint.h>
+
+static const char MAGIC[] = "DSMREC01";
+static const int MAGIC_SIZE = 8;
+
+// Frames between two key frames, about ten minutes at the usual interval.
+static const int KEY_FRAME_INTERVAL = 300;
+
+// A bigger frame length is taken for garbage rather than allocated.
+static const uint64_t FRAME_SIZE_LIMIT = 64 * 1024 * 1024;
+
+enum FrameFlag {
+    KeyFrame = 1
+};
+
+// Values of a row, the ones that change on most ticks first so their bits fit in the first byte of the mask.
+enum RowField {
+    Cpu, Memory, ReadKbs, WriteKbs, SentKbs, RecvKbs, ProcessState,
+    Pss, Uss, SentBytes, RecvBytes, Ppid, Name, DisplayName, User, DesktopFile,
+    RowFieldNumber
+};
+
+enum TotalField {
+    CpuPercent, UsedMemory, UsedSwap, TotalRecvKbs, TotalSentKbs, TotalRecvBytes, TotalSentBytes,
+    TotalMemory, TotalSwap, GuiProcessNumber, SystemProcessNumber, HasProcesses, TabName,
+    TotalFieldNumber
+};
+
+typedef std::array<int64_t, RowFieldNumber> RowValues;
+typedef std::array<int64_t, TotalFieldNumber> TotalValues;
+
+static const RowValues EMPTY_ROW = RowValues();
+
+static void writeVarint(QByteArray &buffer, uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer.append(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.append(static_cast<char>(value));
+}
+
+static void writeSigned(QByteArray &buffer, int64_t value)
+{
+    // Zigzag, small differences either way take a single byte.
+    writeVarint(buffer, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+// Bytes are counted in pages or KiB by the kernel, nothing is lost in KiB. -1 stands for unknown.
+static int64_t fromBytes(long bytes)
+{
+    return bytes < 0 ? -1 : bytes / 1024;
+}
+
+static long toBytes(int64_t kib)
+{
+    return kib < 0 ? -1 : kib * 1024;
+}
+
+static int64_t fromRate(double rate)
+{
+    return llround(rate * 100);
+}
+
+static double toRate(int64_t rate)
+{
+    return rate / 100.0;
+}
+
+template <size_t N>
+static uint64_t changeMask(const std::array<int64_t, N> &values, const std::array<int64_t, N> &previous)
+{
+    uint64_t mask = 0;
+    for (size_t field = 0; field < N; field++) {
+        if (values[field] != previous[field]) {
+            mask |= static_cast<uint64_t>(1) << field;
+        }
+    }
+
+    return mask;
+}
+
+/*
+ * Reads a frame, reading past its end only sets failed.
+ */
+struct FrameCursor
+{
+    const char *data;
+    size_t size;
+    size_t offset;
+    bool failed;
+
+    uint64_t readVarint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64 && offset < size; shift += 7) {
+            uint8_t byte = data[offset++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+
+        failed = true;
+        return 0;
+    }
+
+    int64_t readSigned()
+    {
+        uint64_t value = readVarint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    size_t remaining() const
+    {
+        return size - offset;
+    }
+
+    template <size_t N>
+    void readChanges(std::array<int64_t, N> &values, const std::array<int64_t, N> &previous)
+    {
+        uint64_t mask = readVarint();
+        for (size_t field = 0; field < N; field++) {
+            values[field] = previous[field];
+            if (mask & (static_cast<uint64_t>(1) << field)) {
+                values[field] += readSigned();
+            }
+        }
+    }
+};
+
+/*
+ * Read the length in front of a frame, byte by byte since the frame size isn't known yet.
+ *
+ * @return false at the end of the file, or if the length can't be the one of a frame
+ */
+static bool readFrameSize(QFile *file, uint64_t &frameSize)
+{
+    frameSize = 0;
+    for (int shift = 0;; shift += 7) {
+        char byte;
+        if (shift >= 64 || !file->getChar(&byte)) {
+            return false;
+        }
+        frameSize |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+
+    return frameSize <= FRAME_SIZE_LIMIT;
+}
+
+/*
+ * Offset right behind the last frame that was written completely, whatever follows was torn by a crash.
+ */
+static qint64 completeFramesEnd(QFile *file)
+{
+    qint64 end = file->pos();
+    uint64_t frameSize;
+    while (readFrameSize(file, frameSize) && file->size() - file->pos() >= static_cast<qint64>(frameSize)) {
+        if (!file->seek(file->pos() + frameSize)) {
+            break;
+        }
+        end = file->pos();
+    }
+
+    return end;
+}
+
+struct SnapshotRecorder::State
+{
+    QHash<int, RowValues> previousRows;
+    QHash<int, RowValues> rows;
+    QHash<QString, int64_t> stringIndexes;
+    QVector<QString> newStrings;
+    QVector<int> pids;
+    QVector<const RowValues*> bases;
+    QVector<uint64_t> masks;
+    TotalValues previousTotals;
+    long long previousTime;
+    int frameNumber;                    // frames written since the last key frame
+
+    int64_t stringIndex(const QString &string)
+    {
+        auto index = stringIndexes.find(string);
+        if (index == stringIndexes.end()) {
+            index = stringIndexes.insert(string, stringIndexes.size());
+            newStrings << string;
+        }
+
+        return index.value();
+    }
+};
+
+struct SnapshotReader::State
+{
+    QHash<int, RowValues> previousRows;
+    QHash<int, RowValues> rows;
+    QVector<QString> strings;
+    QVector<int> pids;
+    QVector<const RowValues*> bases;
+    QVector<uint64_t> masks;
+    TotalValues previousTotals;
+    long long previousTime;
+    bool started;                       // a key frame was read, frames after it can be decoded
+
+    bool stringAt(int64_t index, QString &string) const
+    {
+        if (index < 0 || index >= strings.size()) {
+            return false;
+        }
+        string = strings[index];
+
+        return true;
+    }
+};
+
+SnapshotRecorder::SnapshotRecorder(QFile *file) : file(file)
+{
+    state = new State();
+    state->previousTotals.fill(0);
+    state->previousTime = 0;
+    state->frameNumber = 0;
+}
+
+SnapshotRecorder::~SnapshotRecorder()
+{
+    delete file;
+    delete state;
+}
+
+SnapshotRecorder* SnapshotRecorder::open(QString path)
+{
+    QFile *file = new QFile(path);
+
+    // Appending to a recording made by another run is fine, it starts over with a key frame.
+    // A frame torn by a crash of that run is cut off first, new frames would be read as its rest otherwise.
+    bool created = !file->exists() || file->size() == 0;
+    qint64 end = 0;
+    if (!created) {
+        bool recording = file->open(QIODevice::ReadOnly) && file->read(MAGIC_SIZE) == QByteArray(MAGIC, MAGIC_SIZE);
+        if (recording) {
+            end = completeFramesEnd(file);
+        }
+        file->close();
+        if (!recording) {
+            delete file;
+            return nullptr;
+        }
+    }
+
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Append) ||
+        (created && file->write(MAGIC, MAGIC_SIZE) != MAGIC_SIZE) ||
+        (!created && end < file->size() && !file->resize(end))) {
+        delete file;
+        return nullptr;
+    }
+
+    return new SnapshotRecorder(file);
+}
+
+bool SnapshotRecorder::append(const StatusSnapshot &snapshot, long long time)
+{
+    bool keyFrame = state->frameNumber % KEY_FRAME_INTERVAL == 0;
+    if (keyFrame) {
+        state->previousRows.clear();
+        state->previousTotals.fill(0);
+        state->previousTime = 0;
+        state->stringIndexes.clear();
+        state->frameNumber = 0;
+    }
+    state->newStrings.clear();
+
+    TotalValues totals;
+    totals[CpuPercent] = fromRate(snapshot.cpuPercent);
+    totals[UsedMemory] = fromBytes(snapshot.usedMemory);
+    totals[UsedSwap] = fromBytes(snapshot.usedSwap);
+    totals[TotalRecvKbs] = fromRate(snapshot.totalRecvKbs);
+    totals[TotalSentKbs] = fromRate(snapshot.totalSentKbs);
+    totals[TotalRecvBytes] = snapshot.totalRecvBytes;
+    totals[TotalSentBytes] = snapshot.totalSentBytes;
+    totals[TotalMemory] = fromBytes(snapshot.totalMemory);
+    totals[TotalSwap] = fromBytes(snapshot.totalSwap);
+    totals[GuiProcessNumber] = snapshot.guiProcessNumber;
+    totals[SystemProcessNumber] = snapshot.systemProcessNumber;
+    totals[HasProcesses] = snapshot.hasProcesses;
+    totals[TabName] = state->stringIndex(snapshot.tabName);
+
+    // Values of every row, against the same process in the previous frame or against zeros if it's new.
+    int rowNumber = snapshot.processes.size();
+    state->rows.clear();
+    state->rows.reserve(rowNumber);
+    state->pids.resize(rowNumber);
+    state->bases.resize(rowNumber);
+    state->masks.resize(rowNumber);
+    for (int index = 0; index < rowNumber; index++) {
+        const ProcessEntry &entry = snapshot.processes[index];
+
+        RowValues &row = state->rows[entry.pid];
+        row[Cpu] = fromRate(entry.cpu);
+        row[Memory] = fromBytes(entry.memory);
+        row[ReadKbs] = fromRate(entry.diskStatus.readKbs);
+        row[WriteKbs] = fromRate(entry.diskStatus.writeKbs);
+        row[SentKbs] = fromRate(entry.networkStatus.sentKbs);
+        row[RecvKbs] = fromRate(entry.networkStatus.recvKbs);
+        row[ProcessState] = entry.state;
+        row[Pss] = fromBytes(entry.pss);
+        row[Uss] = fromBytes(entry.uss);
+        row[SentBytes] = entry.networkStatus.sentBytes;
+        row[RecvBytes] = entry.networkStatus.recvBytes;
+        row[Ppid] = entry.ppid;
+        row[Name] = state->stringIndex(entry.name);
+        row[DisplayName] = state->stringIndex(entry.displayName);
+        row[User] = state->stringIndex(entry.user);
+        row[DesktopFile] = state->stringIndex(QString::fromStdString(entry.desktopFile));
+
+        auto previous = state->previousRows.constFind(entry.pid);
+        const RowValues *base = previous != state->previousRows.constEnd() ? &previous.value() : &EMPTY_ROW;
+        state->pids[index] = entry.pid;
+        state->bases[index] = base;
+        state->masks[index] = changeMask(row, *base);
+    }
+
+    frame.clear();
+    writeVarint(frame, keyFrame ? KeyFrame : 0);
+    writeSigned(frame, time - state->previousTime);
+
+    // Strings first, columns below may refer to them.
+    writeVarint(frame, state->newStrings.size());
+    for (const QString &string : state->newStrings) {
+        QByteArray bytes = string.toUtf8();
+        writeVarint(frame, bytes.size());
+        frame.append(bytes);
+    }
+
+    writeVarint(frame, changeMask(totals, state->previousTotals));
+    for (int field = 0; field < TotalFieldNumber; field++) {
+        if (totals[field] != state->previousTotals[field]) {
+            writeSigned(frame, totals[field] - state->previousTotals[field]);
+        }
+    }
+
+    // Rows column by column, pids mostly ascend so their differences are small.
+    writeVarint(frame, rowNumber);
+    int previousPid = 0;
+    for (int pid : state->pids) {
+        writeSigned(frame, pid - previousPid);
+        previousPid = pid;
+    }
+    for (uint64_t mask : state->masks) {
+        writeVarint(frame, mask);
+    }
+    for (int field = 0; field < RowFieldNumber; field++) {
+        uint64_t bit = static_cast<uint64_t>(1) << field;
+        for (int index = 0; index < rowNumber; index++) {
+            if (state->masks[index] & bit) {
+                const RowValues &row = state->rows[state->pids[index]];
+                writeSigned(frame, row[field] - (*state->bases[index])[field]);
+            }
+        }
+    }
+
+    state->previousRows.swap(state->rows);
+    state->previousTotals = totals;
+    state->previousTime = time;
+    state->frameNumber++;
+
+    // The length goes in front, a frame cut short by a crash is recognised and dropped when read,
+    // and cut off when the recording is appended to again.
+    QByteArray length;
+    writeVarint(length, frame.size());
+    qint64 end = file->size();
+    if (file->write(length) != length.size() || file->write(frame) != frame.size() || !file->flush()) {
+        // Drop what made it into the file and start over with a key frame in case the file recovers.
+        // If even that fails, frames after the broken one are lost until the next open cuts it off.
+        file->resize(end);
+        state->frameNumber = 0;
+        return false;
+    }
+
+    return true;
+}
+
+SnapshotReader::SnapshotReader(QFile *file) : file(file)
+{
+    state = new State();
+    state->previousTotals.fill(0);
+    state->previousTime = 0;
+    state->started = false;
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    delete file;
+    delete state;
+}
+
+SnapshotReader* SnapshotReader::open(QString path)
+{
+    QFile *file = new QFile(path);
+    if (!file->open(QIODevice::ReadOnly) || file->read(MAGIC_SIZE) != QByteArray(MAGIC, MAGIC_SIZE)) {
+        delete file;
+        return nullptr;
+    }
+
+    return new SnapshotReader(file);
+}
+
+bool SnapshotReader::next(StatusSnapshot &snapshot, long long &time)
+{
+    uint64_t frameSize;
+    if (!readFrameSize(file, frameSize)) {
+        return false;
+    }
+    frame = file->read(frameSize);
+    if (static_cast<uint64_t>(frame.size()) != frameSize) {
+        return false;
+    }
+
+    FrameCursor cursor = {frame.constData(), static_cast<size_t>(frame.size()), 0, false};
+
+    if (cursor.readVarint() & KeyFrame) {
+        state->previousRows.clear();
+        state->previousTotals.fill(0);
+        state->previousTime = 0;
+        state->strings.clear();
+        state->started = true;
+    } else if (!state->started) {
+        return false;
+    }
+
+    time = state->previousTime + cursor.readSigned();
+
+    uint64_t stringNumber = cursor.readVarint();
+    if (stringNumber > cursor.remaining()) {
+        return false;
+    }
+    for (uint64_t index = 0; index < stringNumber && !cursor.failed; index++) {
+        uint64_t length = cursor.readVarint();
+        if (length > cursor.remaining()) {
+            return false;
+        }
+        state->strings << QString::fromUtf8(cursor.data + cursor.offset, length);
+        cursor.offset += length;
+    }
+
+    TotalValues totals;
+    cursor.readChanges(totals, state->previousTotals);
+
+    // Every row takes at least a byte for its pid and one for its mask.
+    uint64_t rowNumber = cursor.readVarint();
+    if (rowNumber > cursor.remaining() / 2) {
+        return false;
+    }
+
+    state->rows.clear();
+    state->rows.reserve(rowNumber);
+    state->pids.resize(rowNumber);
+    state->bases.resize(rowNumber);
+    state->masks.resize(rowNumber);
+
+    int pid = 0;
+    for (uint64_t index = 0; index < rowNumber; index++) {
+        pid += cursor.readSigned();
+        state->pids[index] = pid;
+
+        auto previous = state->previousRows.constFind(pid);
+        state->bases[index] = previous != state->previousRows.constEnd() ? &previous.value() : &EMPTY_ROW;
+        state->rows.insert(pid, *state->bases[index]);
+    }
+    for (uint64_t index = 0; index < rowNumber; index++) {
+        state->masks[index] = cursor.readVarint();
+    }
+    for (int field = 0; field < RowFieldNumber; field++) {
+        uint64_t bit = static_cast<uint64_t>(1) << field;
+        for (uint64_t index = 0; index < rowNumber; index++) {
+            if (state->masks[index] & bit) {
+                state->rows[state->pids[index]][field] += cursor.readSigned();
+            }
+        }
+    }
+
+    if (cursor.failed) {
+        return false;
+    }
+
+    snapshot.hasProcesses = totals[HasProcesses] != 0;
+    snapshot.cpuPercent = toRate(totals[CpuPercent]);
+    snapshot.usedMemory = toBytes(totals[UsedMemory]);
+    snapshot.totalMemory = toBytes(totals[TotalMemory]);
+    snapshot.usedSwap = toBytes(totals[UsedSwap]);
+    snapshot.totalSwap = toBytes(totals[TotalSwap]);
+    snapshot.totalRecvBytes = totals[TotalRecvBytes];
+    snapshot.totalSentBytes = totals[TotalSentBytes];
+    snapshot.totalRecvKbs = toRate(totals[TotalRecvKbs]);
+    snapshot.totalSentKbs = toRate(totals[TotalSentKbs]);
+    snapshot.guiProcessNumber = totals[GuiProcessNumber];
+    snapshot.systemProcessNumber = totals[SystemProcessNumber];
+    snapshot.services.clear();
+    if (!state->stringAt(totals[TabName], snapshot.tabName)) {
+        return false;
+    }
+
+    snapshot.processes.resize(rowNumber);
+    for (uint64_t index = 0; index < rowNumber; index++) {
+        const RowValues &row = state->rows[state->pids[index]];
+        ProcessEntry &entry = snapshot.processes[index];
+        QString desktopFile;
+
+        if (!state->stringAt(row[Name], entry.name) ||
+            !state->stringAt(row[DisplayName], entry.displayName) ||
+            !state->stringAt(row[User], entry.user) ||
+            !state->stringAt(row[DesktopFile], desktopFile)) {
+            return false;
+        }
+
+        entry.pid = state->pids[index];
+        entry.ppid = row[Ppid];
+        entry.startTime = 0;
+        entry.desktopFile = desktopFile.toStdString();
+        entry.state = row[ProcessState];
+        entry.cpu = toRate(row[Cpu]);
+        entry.memory = toBytes(row[Memory]);
+        entry.pss = toBytes(row[Pss]);
+        entry.uss = toBytes(row[Uss]);
+        entry.diskStatus = {static_cast<float>(toRate(row[ReadKbs])), static_cast<float>(toRate(row[WriteKbs]))};
+        entry.networkStatus = {
+            static_cast<uint32_t>(row[SentBytes]),
+            static_cast<uint32_t>(row[RecvBytes]),
+            static_cast<float>(toRate(row[SentKbs])),
+            static_cast<float>(toRate(row[RecvKbs]))
+        };
+        entry.threads.clear();
+    }
+
+    state->previousRows.swap(state->rows);
+    state->previousTotals = totals;
+    state->previousTime = time;
+
+    return true;
+}
@@ -0,0 +1,105 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SNAPSHOTRECORDING_H
+#define SNAPSHOTRECORDING_H
+
+#include "status_snapshot.h"
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+/**
+ * Snapshots written to and read back from a recording file.
+ *
+ * A recording is a short header followed by one frame per snapshot. Each frame is length prefixed
+ * and stores its rows column by column: all pids, then a mask per row telling which values changed
+ * since the previous frame, then every changed value of one field after the other. Values are
+ * varints holding the difference to the same process in the previous frame, strings go into a
+ * table the first time they are seen and are referred to by index afterwards. A process whose
+ * cpu alone changed costs a few bytes.
+ *
+ * Memory is kept in KiB, cpu and rates with two decimals. Threads of expanded rows and services
+ * aren't recorded.
+ *
+ * Key frames are encoded against nothing and start a new string table. One is written whenever
+ * recording starts and every few minutes, so a file appended to by several runs stays readable.
+ * A frame torn by a crash is cut off before the next run appends, so it only loses itself.
+ */
+class SnapshotRecorder final
+{
+public:
+    ~SnapshotRecorder();
+
+    /*
+     * Open a recording for appending, it is created if it doesn't exist. A frame left torn at its end is cut off.
+     *
+     * @return null if the file can't be written or holds something else than a recording
+     */
+    static SnapshotRecorder* open(QString path);
+
+    /*
+     * @time milliseconds since the epoch
+     * @return false if the frame couldn't be written
+     */
+    bool append(const StatusSnapshot &snapshot, long long time);
+
+private:
+    struct State;
+
+    SnapshotRecorder(QFile *file);
+
+    QByteArray frame;
+    QFile *file;
+    State *state;
+};
+
+class SnapshotReader final
+{
+public:
+    ~SnapshotReader();
+
+    /*
+     * @return null if the file can't be read or isn't a recording
+     */
+    static SnapshotReader* open(QString path);
+
+    /*
+     * Read the next frame.
+     *
+     * @time filled with milliseconds since the epoch the snapshot was taken at
+     * @return false at the end of the recording, or at the first frame that can't be decoded
+     */
+    bool next(StatusSnapshot &snapshot, long long &time);
+
+private:
+    struct State;
+
+    SnapshotReader(QFile *file);
+
+    QByteArray frame;
+    QFile *file;
+    State *state;
+};
+
+#endif
@@ -0,0 +1,276 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot_ring.h"
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
+#include <new>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *SEGMENT_NAME = "/deepin-system-monitor";
+static const uint32_t MAGIC = 0x44534d52;
+static const uint32_t VERSION = 1;
+
+// Slots are written round robin, a reader only collides with the writer if its copy takes longer than two intervals.
+static const uint32_t SLOT_NUMBER = 3;
+static const int READ_ATTEMPTS = 4;
+
+// Intervals without a sample after which viewers consider the collector gone.
+static const int MISSED_SAMPLES = 3;
+
+struct SnapshotRing::Header
+{
+    std::atomic<uint32_t> magic;        // written last, a segment still being set up doesn't match
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t slotNumber;
+    uint64_t capacity;
+    uint64_t slotSize;
+    int32_t interval;
+    pid_t writerPid;
+    std::atomic<uint64_t> latest;       // serial of the last complete sample, 0 before the first
+    std::atomic<int64_t> publishTime;   // CLOCK_MONOTONIC milliseconds of the last sample
+};
+
+// Records follow the slot header.
+struct SnapshotRing::Slot
+{
+    std::atomic<uint32_t> sequence;     // odd while the writer fills the slot
+    uint32_t padding;
+    uint64_t serial;
+    uint64_t recordNumber;
+    Totals totals;
+};
+
+static size_t alignSize(size_t size)
+{
+    return (size + 63) & ~static_cast<size_t>(63);
+}
+
+// Anybody may create files in /dev/shm, only a segment root owns and alone can write is a collector's.
+static bool isTrusted(int fd)
+{
+    struct stat status;
+    return fstat(fd, &status) == 0 && status.st_uid == 0 && (status.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+static int64_t monotonicTime()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    // Milliseconds, the same clock for every process on the machine.
+    return static_cast<int64_t>(time.tv_sec) * 1000 + time.tv_nsec / 1000000;
+}
+
+SnapshotRing::SnapshotRing(int fd, void *memory, size_t size, bool writer)
+    : header(static_cast<Header*>(memory)), memory(memory), size(size), fd(fd), writer(writer)
+{
+}
+
+SnapshotRing::~SnapshotRing()
+{
+    munmap(memory, size);
+
+    // Viewers still mapping the segment keep it until they notice it went stale.
+    if (writer) {
+        shm_unlink(SEGMENT_NAME);
+    }
+    close(fd);
+}
+
+SnapshotRing* SnapshotRing::create(int interval, size_t capacity)
+{
+    // Viewers only trust segments of root, publishing as anybody else would be for nothing.
+    if (geteuid() != 0) {
+        return nullptr;
+    }
+
+    // The running collector holds a lock on its segment, one left by a collector that is gone can be replaced.
+    // A segment root doesn't own was put there by some user, its lock doesn't keep the collector out.
+    int oldFd = shm_open(SEGMENT_NAME, O_RDONLY | O_CLOEXEC, 0);
+    if (oldFd >= 0) {
+        bool locked = isTrusted(oldFd) && flock(oldFd, LOCK_EX | LOCK_NB) != 0;
+        close(oldFd);
+        if (locked) {
+            return nullptr;
+        }
+    }
+
+    // A new segment rather than resizing the old one, viewers that still map it would fault on truncated pages.
+    shm_unlink(SEGMENT_NAME);
+    int fd = shm_open(SEGMENT_NAME, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    // Viewers run as other users, whatever the umask of the collector is.
+    size_t slotSize = alignSize(sizeof(Slot) + capacity * sizeof(Record));
+    size_t size = alignSize(sizeof(Header)) + SLOT_NUMBER * slotSize;
+    void *memory = MAP_FAILED;
+    if (fchmod(fd, 0644) == 0 && flock(fd, LOCK_EX | LOCK_NB) == 0 && ftruncate(fd, size) == 0) {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (memory == MAP_FAILED) {
+        shm_unlink(SEGMENT_NAME);
+        close(fd);
+        return nullptr;
+    }
+
+    // The segment comes zero-filled, slots start with an even sequence and nothing published.
+    Header *header = new (memory) Header();
+    header->version = VERSION;
+    header->recordSize = sizeof(Record);
+    header->slotNumber = SLOT_NUMBER;
+    header->capacity = capacity;
+    header->slotSize = slotSize;
+    header->interval = interval;
+    header->writerPid = getpid();
+    header->latest.store(0);
+    header->publishTime.store(0);
+    header->magic.store(MAGIC, std::memory_order_release);
+
+    return new SnapshotRing(fd, memory, size, true);
+}
+
+SnapshotRing* SnapshotRing::attach()
+{
+    int fd = shm_open(SEGMENT_NAME, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    // Any user could have put a segment with a valid header there to show viewers a made up process list.
+    struct stat status;
+    if (!isTrusted(fd) || fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(Header)) {
+        close(fd);
+        return nullptr;
+    }
+
+    size_t size = status.st_size;
+    void *memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+
+    // A collector built from other sources lays records out differently.
+    const Header *header = static_cast<const Header*>(memory);
+    if (header->magic.load(std::memory_order_acquire) != MAGIC ||
+        header->version != VERSION ||
+        header->recordSize != sizeof(Record) ||
+        header->slotSize < alignSize(sizeof(Slot) + header->capacity * sizeof(Record)) ||
+        alignSize(sizeof(Header)) + header->slotNumber * header->slotSize != size) {
+        munmap(memory, size);
+        close(fd);
+        return nullptr;
+    }
+
+    return new SnapshotRing(fd, memory, size, false);
+}
+
+bool SnapshotRing::isCollectorRunning()
+{
+    SnapshotRing *ring = attach();
+    bool running = ring != nullptr && ring->isAlive();
+    delete ring;
+
+    return running;
+}
+
+SnapshotRing::Record* SnapshotRing::beginWrite()
+{
+    Slot *slot = slotAt(header->latest.load(std::memory_order_relaxed) + 1);
+
+    // Odd sequence first, readers that see it or see it change throw their copy away.
+    slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    return reinterpret_cast<Record*>(slot + 1);
+}
+
+void SnapshotRing::endWrite(const Totals &totals, size_t recordNumber)
+{
+    uint64_t serial = header->latest.load(std::memory_order_relaxed) + 1;
+    Slot *slot = slotAt(serial);
+
+    slot->serial = serial;
+    slot->recordNumber = std::min(recordNumber, capacity());
+    slot->totals = totals;
+    slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    header->publishTime.store(monotonicTime(), std::memory_order_relaxed);
+    header->latest.store(serial, std::memory_order_release);
+}
+
+size_t SnapshotRing::capacity() const
+{
+    return header->capacity;
+}
+
+bool SnapshotRing::read(Totals &totals, std::vector<Record> &records) const
+{
+    for (int attempt = 0; attempt < READ_ATTEMPTS; attempt++) {
+        uint64_t serial = header->latest.load(std::memory_order_acquire);
+        if (serial == 0 || !isAlive()) {
+            return false;
+        }
+
+        const Slot *slot = slotAt(serial);
+        uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+
+        // The copy may be torn, it's only kept if the sequence didn't move meanwhile.
+        size_t recordNumber = std::min(static_cast<size_t>(slot->recordNumber), capacity());
+        records.resize(recordNumber);
+        std::copy_n(reinterpret_cast<const Record*>(slot + 1), recordNumber, records.begin());
+        totals = slot->totals;
+        uint64_t copiedSerial = slot->serial;
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) == sequence && copiedSerial == serial) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SnapshotRing::isAlive() const
+{
+    int64_t publishTime = header->publishTime.load(std::memory_order_relaxed);
+    return publishTime != 0 && monotonicTime() - publishTime < static_cast<int64_t>(MISSED_SAMPLES + 1) * header->interval;
+}
+
+SnapshotRing::Slot* SnapshotRing::slotAt(uint64_t serial) const
+{
+    char *slots = static_cast<char*>(memory) + alignSize(sizeof(Header));
+    return reinterpret_cast<Slot*>(slots + (serial % header->slotNumber) * header->slotSize);
+}
@@ -0,0 +1,145 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SNAPSHOTRING_H
+#define SNAPSHOTRING_H
+
+#include "process_sampler.h"
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * SnapshotRing publishes the samples of a privileged collector through POSIX shared memory,
+ * so any number of unprivileged viewers can show what only root may read (other users' disk
+ * counters, per-process network traffic) without running a sampler of their own.
+ *
+ * The segment holds a few slots, each guarded by a sequence lock: the writer makes the sequence
+ * odd, fills the slot and makes it even again, then points the header at it. Readers map the
+ * segment read-only, copy the latest slot and retry if its sequence moved while they copied.
+ * The writer never waits for readers and readers never write, so a stuck viewer can't hold the
+ * collector up.
+ *
+ * A collector that starts again unlinks the old segment and publishes into a new one, viewers
+ * notice the old one going stale and attach again.
+ */
+class SnapshotRing final
+{
+public:
+    /**
+     * Machine totals of one sample.
+     */
+    struct Totals
+    {
+        double cpuPercent;
+        long usedMemory;
+        long totalMemory;
+        long usedSwap;
+        long totalSwap;
+        uint32_t totalRecvBytes;
+        uint32_t totalSentBytes;
+        float totalRecvKbs;
+        float totalSentKbs;
+    };
+
+    /**
+     * One process of a sample, in pid order.
+     */
+    struct Record
+    {
+        ProcessSample sample;           // pcpu includes children that exited during the interval
+        float readKbs;
+        float writeKbs;
+        uint32_t sentBytes;
+        uint32_t recvBytes;
+        float sentKbs;
+        float recvKbs;
+    };
+
+    ~SnapshotRing();
+
+    /*
+     * Create the segment for a collector, replacing one left behind by a collector that is gone.
+     *
+     * @interval milliseconds between two samples, readers consider the collector gone after a few missed ones
+     * @capacity most processes a sample can hold, the rest of a bigger sample is left out
+     * @return null if another collector is running, the caller isn't root or the segment can't be created
+     */
+    static SnapshotRing* create(int interval, size_t capacity = 16384);
+
+    /*
+     * Map the segment of a running collector read-only.
+     *
+     * @return null if there's no collector, the segment isn't owned by root and writable by root alone,
+     *         or it was built with another record layout
+     */
+    static SnapshotRing* attach();
+
+    /*
+     * Whether a collector publishes right now.
+     */
+    static bool isCollectorRunning();
+
+    /*
+     * Start writing the next sample, records are written in place.
+     *
+     * @return room for capacity() records
+     */
+    Record* beginWrite();
+
+    /*
+     * Publish the sample started with beginWrite().
+     */
+    void endWrite(const Totals &totals, size_t recordNumber);
+
+    size_t capacity() const;
+
+    /*
+     * Copy the latest sample.
+     *
+     * @return false if nothing was published yet, the collector stopped publishing or
+     *         the sample kept changing while it was copied
+     */
+    bool read(Totals &totals, std::vector<Record> &records) const;
+
+    /*
+     * Whether the collector published within the last few intervals.
+     */
+    bool isAlive() const;
+
+private:
+    struct Header;
+    struct Slot;
+
+    SnapshotRing(int fd, void *memory, size_t size, bool writer);
+
+    Slot* slotAt(uint64_t serial) const;
+
+    Header *header;
+    void *memory;
+    size_t size;
+    int fd;
+    bool writer;
+};
+
+#endif
@@ -0,0 +1,154 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot_source.h"
+#include <QMutexLocker>
+#include <algorithm>
+
+SnapshotSource::SnapshotSource() : QObject()
+{
+    treeMode = false;
+}
+
+SnapshotSource::~SnapshotSource()
+{
+}
+
+StatusSnapshotPtr SnapshotSource::takeSnapshot()
+{
+    QMutexLocker locker(&pendingMutex);
+
+    StatusSnapshotPtr snapshot;
+    snapshot.swap(pendingSnapshot);
+
+    return snapshot;
+}
+
+void SnapshotSource::setExpandedPids(QList<int>)
+{
+}
+
+void SnapshotSource::setFilterType(int, QString)
+{
+}
+
+void SnapshotSource::setMemoryDetailPids(QList<int>)
+{
+}
+
+void SnapshotSource::setTreeMode(bool enabled)
+{
+    treeMode = enabled;
+}
+
+void SnapshotSource::setVisible(bool)
+{
+}
+
+bool SnapshotSource::hasPendingSnapshot()
+{
+    QMutexLocker locker(&pendingMutex);
+
+    return !pendingSnapshot.isNull();
+}
+
+bool SnapshotSource::isTreeMode() const
+{
+    return treeMode;
+}
+
+void SnapshotSource::publish(const StatusSnapshotPtr &snapshot)
+{
+    bool wasEmpty;
+    {
+        QMutexLocker locker(&pendingMutex);
+        wasEmpty = pendingSnapshot.isNull();
+        pendingSnapshot = snapshot;
+    }
+
+    // If the GUI hasn't taken the previous snapshot yet, it's already notified and will pick up this newer one instead.
+    if (wasEmpty) {
+        snapshotReady();
+    }
+}
+
+void SnapshotSource::buildRowTree(StatusSnapshot *snapshot)
+{
+    QVector<ProcessEntry> &entries = snapshot->processes;
+    snapshot->treeMode = true;
+
+    rowPids.resize(entries.size());
+    rowParentPids.resize(entries.size());
+    rowTotals.resize(entries.size());
+    for (int row = 0; row < entries.size(); row++) {
+        const ProcessEntry &entry = entries[row];
+        rowPids[row] = entry.pid;
+        rowParentPids[row] = entry.ppid;
+        rowTotals[row] = {
+            entry.cpu, entry.memory,
+            entry.diskStatus.readKbs, entry.diskStatus.writeKbs,
+            entry.networkStatus.sentBytes, entry.networkStatus.recvBytes,
+            entry.networkStatus.sentKbs, entry.networkStatus.recvKbs
+        };
+    }
+
+    rowTree.build(rowPids, rowParentPids);
+    rowTree.prefixSums(rowTotals, rowPrefixes);
+
+    // Rates are summed as doubles, differences of prefixes may come out a hair below zero.
+    for (int row = 0; row < entries.size(); row++) {
+        ProcessEntry &entry = entries[row];
+        int parent = rowTree.parentOf(row);
+        SubtreeTotals totals = rowTree.subtreeSum(rowPrefixes, row);
+
+        entry.parentPid = parent >= 0 ? rowTree.pidAt(parent) : 0;
+        entry.subtreeCpu = std::max(0.0, totals.cpu);
+        entry.subtreeMemory = totals.memory;
+        entry.subtreeDiskStatus.readKbs = std::max(0.0, totals.readKbs);
+        entry.subtreeDiskStatus.writeKbs = std::max(0.0, totals.writeKbs);
+        entry.subtreeNetworkStatus.sentBytes = static_cast<uint32_t>(totals.sentBytes);
+        entry.subtreeNetworkStatus.recvBytes = static_cast<uint32_t>(totals.recvBytes);
+        entry.subtreeNetworkStatus.sentKbs = std::max(0.0, totals.sentKbs);
+        entry.subtreeNetworkStatus.recvKbs = std::max(0.0, totals.recvKbs);
+    }
+}
+
+SnapshotSource::SubtreeTotals SnapshotSource::SubtreeTotals::operator+(const SubtreeTotals &other) const
+{
+    return {
+        cpu + other.cpu, memory + other.memory,
+        readKbs + other.readKbs, writeKbs + other.writeKbs,
+        sentBytes + other.sentBytes, recvBytes + other.recvBytes,
+        sentKbs + other.sentKbs, recvKbs + other.recvKbs
+    };
+}
+
+SnapshotSource::SubtreeTotals SnapshotSource::SubtreeTotals::operator-(const SubtreeTotals &other) const
+{
+    return {
+        cpu - other.cpu, memory - other.memory,
+        readKbs - other.readKbs, writeKbs - other.writeKbs,
+        sentBytes - other.sentBytes, recvBytes - other.recvBytes,
+        sentKbs - other.sentKbs, recvKbs - other.recvKbs
+    };
+}
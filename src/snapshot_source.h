@@ -0,0 +1,127 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SNAPSHOTSOURCE_H
+#define SNAPSHOTSOURCE_H
+
+#include "process_tree.h"
+#include "status_snapshot.h"
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+/**
+ * Where StatusMonitor takes its snapshots from: the live sampler, or a recording played back.
+ *
+ * Snapshots are published into a single slot. snapshotReady() is only emitted when the slot was
+ * empty, so if the GUI thread is busy the pending snapshot is simply replaced by a newer one and
+ * stale ticks never queue up.
+ *
+ * Requests from the GUI are slots so they can be queued to the thread the source runs on,
+ * a source that can't follow one simply ignores it.
+ *
+ * In tree mode rows are hung under the row of their parent process before they are published,
+ * with the totals of every subtree added up in one pass over the preorder.
+ */
+class SnapshotSource : public QObject
+{
+    Q_OBJECT
+
+public:
+    SnapshotSource();
+    virtual ~SnapshotSource();
+
+    /*
+     * Take the latest published snapshot, safe to call from any thread.
+     *
+     * @return null if nothing was published since the last call
+     */
+    StatusSnapshotPtr takeSnapshot();
+
+signals:
+    void snapshotReady();
+
+public slots:
+    virtual void setExpandedPids(QList<int> pids);
+    virtual void setFilterType(int type, QString name);
+
+    /*
+     * Processes whose rows are on screen or selected, only those get PSS and USS.
+     */
+    virtual void setMemoryDetailPids(QList<int> pids);
+
+    /*
+     * Show rows under their parent process, collapsed rows then stand for their whole subtree.
+     */
+    void setTreeMode(bool enabled);
+    virtual void setVisible(bool shown);
+    virtual void start() = 0;
+    virtual void stop() = 0;
+
+protected:
+    /*
+     * Whether the GUI hasn't taken the last published snapshot yet.
+     */
+    bool hasPendingSnapshot();
+    bool isTreeMode() const;
+    void publish(const StatusSnapshotPtr &snapshot);
+
+    /*
+     * Fill in parent rows and subtree totals of the rows of a snapshot.
+     * A row whose parent process has no row of its own, or is folded into another row, is top level.
+     */
+    void buildRowTree(StatusSnapshot *snapshot);
+
+private:
+    /*
+     * What a subtree adds up to, summed in preorder so any subtree is the difference of two prefixes.
+     */
+    struct SubtreeTotals
+    {
+        double cpu;
+        long long memory;
+        double readKbs;
+        double writeKbs;
+        long long sentBytes;
+        long long recvBytes;
+        double sentKbs;
+        double recvKbs;
+
+        SubtreeTotals operator+(const SubtreeTotals &other) const;
+        SubtreeTotals operator-(const SubtreeTotals &other) const;
+    };
+
+    QMutex pendingMutex;
+    StatusSnapshotPtr pendingSnapshot;
+    bool treeMode;
+
+    // Scratch arrays of the row tree, reused between ticks.
+    ProcessTree rowTree;
+    std::vector<pid_t> rowPids;
+    std::vector<pid_t> rowParentPids;
+    std::vector<SubtreeTotals> rowTotals;
+    std::vector<SubtreeTotals> rowPrefixes;
+};
+
+#endif
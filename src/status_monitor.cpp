@@ -23,24 +23,18 @@
 
 #include "status_monitor.h"
 #include <QPainter>
+#include <QSettings>
 
-#include <unistd.h>
 #include "process_item.h"
+#include "snapshot_player.h"
 #include "utils.h"
-#include <proc/sysinfo.h>
-#include "process_tree.h"
-#include <thread>
-#include <QDebug>
 
 using namespace Utils;
 
-StatusMonitor::StatusMonitor(QWidget *parent) : QWidget(parent)
+StatusMonitor::StatusMonitor(QString replayFile, bool replayMaxSpeed, QWidget *parent) : QWidget(parent)
 {
     setFixedWidth(300);
 
-    filterType = OnlyGUI;
-    tabName = "应用程序";
-
     layout = new QVBoxLayout(this);
 
     cpuMonitor = new CpuMonitor();
@@ -51,46 +45,64 @@ StatusMonitor::StatusMonitor(QWidget *parent) : QWidget(parent)
     layout->addWidget(memoryMonitor, 0, Qt::AlignHCenter);
     layout->addWidget(networkMonitor, 0, Qt::AlignHCenter);
 
-    totalSentBytes = 0;
-    totalRecvBytes = 0;
-    totalSentKbs = 0;
-    totalRecvKbs = 0;
-
-    findWindowTitle = new FindWindowTitle();
-
     // Init process icon cache.
     processIconCache = new QMap<QString, QPixmap>();
 
-    processSentBytes = new QMap<int, uint32_t>();
-    processRecvBytes = new QMap<int, uint32_t>();
-
-    processWriteKbs = new QMap<int, unsigned long>();
-    processReadKbs = new QMap<int, unsigned long>();
-
     connect(this, &StatusMonitor::updateMemoryStatus, memoryMonitor, &MemoryMonitor::updateStatus, Qt::QueuedConnection);
     connect(this, &StatusMonitor::updateCpuStatus, cpuMonitor, &CpuMonitor::updateStatus, Qt::QueuedConnection);
     connect(this, &StatusMonitor::updateNetworkStatus, networkMonitor, &NetworkMonitor::updateStatus, Qt::QueuedConnection);
 
-    updateStatusTimer = new QTimer();
-    connect(updateStatusTimer, SIGNAL(timeout()), this, SLOT(updateStatus()));
-    updateStatusTimer->start(updateDuration);
+    qRegisterMetaType<QList<int>>("QList<int>");
+
+    // Share of one cpu the sampler may use before it drops optional work, 0 turns the limit off.
+    QSettings settings("deepin", "deepin-system-monitor");
+    cpuBudget = settings.value("sampling/cpuBudget", cpuBudget).toDouble();
+    treeMode = settings.value("view/treeMode", treeMode).toBool();
+
+    // Task count from which /proc is read by several threads, machines with slow cores may want it lower.
+    parallelThreshold = settings.value("sampling/parallelThreshold", parallelThreshold).toInt();
+
+    // Ticks between two log lines with durations of every sampling stage, 0 keeps them quiet.
+    int profileReportTicks = settings.value("debug/profileReportTicks", 0).toInt();
+
+    // Sample on a worker thread, the GUI thread only picks up finished snapshots.
+    // A recording goes through the same path, so what's replayed looks and costs the same as live.
+    samplerThread = new QThread();
+    if (replayFile.isEmpty()) {
+        snapshotSource = new StatusSampler(updateDuration, cpuBudget, profileReportTicks, parallelThreshold);
+    } else {
+        snapshotSource = new SnapshotPlayer(replayFile, replayMaxSpeed);
+    }
+    snapshotSource->setTreeMode(treeMode);
+    snapshotSource->moveToThread(samplerThread);
+
+    connect(samplerThread, &QThread::started, snapshotSource, &SnapshotSource::start);
+    connect(snapshotSource, &SnapshotSource::snapshotReady, this, &StatusMonitor::applySnapshot, Qt::QueuedConnection);
+
+    samplerThread->start();
 }
 
 StatusMonitor::~StatusMonitor()
 {
+    // Stop the timer and release sampler resources on the thread that owns them.
+    QMetaObject::invokeMethod(snapshotSource, "stop", Qt::BlockingQueuedConnection);
+    samplerThread->quit();
+    samplerThread->wait();
+
+    delete snapshotSource;
+    delete samplerThread;
     delete cpuMonitor;
-    delete findWindowTitle;
     delete memoryMonitor;
     delete networkMonitor;
     delete processIconCache;
-    delete processRecvBytes;
-    delete processSentBytes;
-    delete processReadKbs;
-    delete processWriteKbs;
-    delete updateStatusTimer;
     delete layout;
 }
 
+bool StatusMonitor::isTreeMode() const
+{
+    return treeMode;
+}
+
 void StatusMonitor::paintEvent(QPaintEvent *)
 {
     QPainter painter(this);
@@ -99,288 +111,219 @@ void StatusMonitor::paintEvent(QPaintEvent *)
 
 void StatusMonitor::switchToAllProcess()
 {
-    filterType = AllProcess;
-    tabName = "所有进程";
-
-    updateStatus();
+    switchFilterType(StatusSampler::AllProcess, "所有进程");
 }
 
 void StatusMonitor::switchToOnlyGui()
 {
-    filterType = OnlyGUI;
-    tabName = "应用程序";
-
-    updateStatus();
+    switchFilterType(StatusSampler::OnlyGUI, "应用程序");
 }
 
 void StatusMonitor::switchToOnlyMe()
 {
-    filterType = OnlyMe;
-    tabName = "我的进程";
+    switchFilterType(StatusSampler::OnlyMe, "我的进程");
+}
 
-    updateStatus();
+void StatusMonitor::switchToServices()
+{
+    switchFilterType(StatusSampler::Services, "服务");
 }
 
-void StatusMonitor::updateStatus()
+void StatusMonitor::toggleThreads(QList<int> pids)
 {
-    // Read the list of open processes information.
-    PROCTAB* proc = openproc(PROC_FILLMEM | PROC_FILLSTAT | PROC_FILLSTATUS | PROC_FILLUSR | PROC_FILLCOM);
-    static proc_t proc_info;
-    memset(&proc_info, 0, sizeof(proc_t));
-
-    storedProcType processes;
-    while (readproc(proc, &proc_info) != NULL) {
-        processes[proc_info.tid]=proc_info;
+    bool expanded = !pids.isEmpty();
+    for (int pid : pids) {
+        expanded = expanded && expandedPids.contains(pid);
     }
-    closeproc(proc);
-
-    // Fill in CPU.
-    if (prevProcesses.size()>0) {
-        // we have previous proc info
-        for(auto &newItr:processes) {
-            for(auto &prevItr:prevProcesses) {
-                if (newItr.first == prevItr.first) {
-                    // PID matches, calculate the cpu
-                    newItr.second.pcpu = (unsigned int) calculateCPUPercentage(&prevItr.second, &newItr.second, totalCpuTime);
-                    break;
-                }
-            }
+
+    for (int pid : pids) {
+        if (expanded) {
+            expandedPids.remove(pid);
+        } else {
+            expandedPids.insert(pid);
         }
     }
 
-    // Update the cpu time for next loop.
-    totalCpuTime = getTotalCpuTime();
+    updateExpandedPids();
+}
 
-    // Read processes information.
-    QString username = qgetenv("USER");
+void StatusMonitor::setWindowVisible(bool visible)
+{
+    if (visible == windowVisible) {
+        return;
+    }
+    windowVisible = visible;
 
-    QList<ListItem*> items;
-    int cpuNumber = sysconf(_SC_NPROCESSORS_ONLN);
-    double totalCpuPercent = 0;
+    // Monitors keep their history but don't animate towards values nobody sees.
+    setUpdatesEnabled(visible);
 
-    findWindowTitle->updateWindowInfos();
+    QMetaObject::invokeMethod(snapshotSource, "setVisible", Qt::QueuedConnection, Q_ARG(bool, visible));
+}
 
-    int guiProcessNumber = 0;
-    int systemProcessNumber = 0;
+void StatusMonitor::setVisiblePids(QList<int> pids)
+{
+    QMetaObject::invokeMethod(snapshotSource, "setMemoryDetailPids", Qt::QueuedConnection, Q_ARG(QList<int>, pids));
+}
 
-    ProcessTree *processTree = new ProcessTree();
-    processTree->scanProcesses(processes);
+void StatusMonitor::setTreeMode(bool enabled)
+{
+    if (enabled == treeMode) {
+        return;
+    }
+    treeMode = enabled;
 
-    for(auto &i:processes) {
-        QString user = (&i.second)->euser;
+    QSettings settings("deepin", "deepin-system-monitor");
+    settings.setValue("view/treeMode", treeMode);
 
-        double cpu = (&i.second)->pcpu;
-        QString name = getProcessName(&i.second);
+    QMetaObject::invokeMethod(snapshotSource, "setTreeMode", Qt::QueuedConnection, Q_ARG(bool, treeMode));
+}
 
-        std::string desktopFile = getDesktopFileFromName(name);
-        bool isGui = desktopFile.size() != 0;
+void StatusMonitor::switchFilterType(StatusSampler::FilterType type, QString name)
+{
+    QMetaObject::invokeMethod(snapshotSource, "setFilterType", Qt::QueuedConnection, Q_ARG(int, type), Q_ARG(QString, name));
+}
 
-        if (isGui) {
-            guiProcessNumber++;
-        } else {
-            systemProcessNumber++;
-        }
+void StatusMonitor::updateExpandedPids()
+{
+    QMetaObject::invokeMethod(snapshotSource, "setExpandedPids", Qt::QueuedConnection, Q_ARG(QList<int>, expandedPids.toList()));
+}
 
-        bool appendItem = false;
-        if (filterType == OnlyGUI) {
-            appendItem = (user == username && isGui);
-        } else if (filterType == OnlyMe) {
-            appendItem = (user == username);
-        } else if (filterType == AllProcess) {
-            appendItem = true;
-        }
+void StatusMonitor::applySnapshot()
+{
+    StatusSnapshotPtr snapshot = snapshotSource->takeSnapshot();
+    if (snapshot.isNull()) {
+        return;
+    }
+    currentSnapshot = snapshot;
 
-        if (appendItem) {
-            int pid = (&i.second)->tid;
-            QString displayName;
-
-            QString title = findWindowTitle->findWindowTitle(pid);
-            if (title != "") {
-                if (filterType == AllProcess) {
-                    displayName = QString("[%1] %2").arg(user).arg(title);
-                } else {
-                    displayName = title;
-                }
-            } else {
-                if (filterType == AllProcess) {
-                    displayName = QString("[%1] %2").arg(user).arg(getDisplayNameFromName(name, desktopFile));
-                } else {
-                    displayName = getDisplayNameFromName(name, desktopFile);
-                }
-            }
-            long memory = ((&i.second)->resident - (&i.second)->share) * sysconf(_SC_PAGESIZE);
-            QPixmap icon = getProcessIconFromName(name, desktopFile, processIconCache);
-            ProcessItem *item = new ProcessItem(icon, name, displayName, cpu / cpuNumber, memory, pid, user, (&i.second)->state);
-            items << item;
-        }
+    // Update memory status.
+    updateMemoryStatus(snapshot->usedMemory, snapshot->totalMemory, snapshot->usedSwap, snapshot->totalSwap);
 
-        totalCpuPercent += cpu;
-    }
+    // Update cpu status.
+    updateCpuStatus(snapshot->cpuPercent);
 
-    // Remove dead process from network status maps.
-    for (auto pid : processSentBytes->keys()) {
-        bool foundProcess = false;
-        for (ListItem *item : items) {
-            if ((static_cast<ProcessItem*>(item))->getPid() == pid) {
-                foundProcess = true;
-                break;
-            }
-        }
+    // Update network status.
+    updateNetworkStatus(snapshot->totalRecvBytes, snapshot->totalSentBytes, snapshot->totalRecvKbs, snapshot->totalSentKbs);
 
-        if (!foundProcess) {
-            processSentBytes->remove(pid);
+    // Rows are kept as they are while the process list is paused.
+    if (!snapshot->hasProcesses) {
+        return;
+    }
 
-            qDebug() << QString("Remove %1 from sent bytes map.").arg(pid);
+    // Items live as long as their process is in the list, only births and deaths create or delete objects.
+    // Icons have to be loaded on GUI thread.
+    QList<ListItem*> newItems;
+    QList<ListItem*> removedItems;
+    QHash<int, ProcessItem*> liveItems;
+    QHash<int, ThreadItem*> liveThreadItems;
+    QHash<QString, ServiceItem*> liveServiceItems;
+    liveItems.reserve(snapshot->processes.size());
+
+    for (const ProcessEntry &entry : snapshot->processes) {
+        ProcessItem *item = processItems.take(entry.pid);
+        // A reused pid is another process, it gets its own row instead of the old one's state.
+        if (item != nullptr && item->getStartTime() != entry.startTime) {
+            removedItems << item;
+            item = nullptr;
         }
-    }
-    for (auto pid : processRecvBytes->keys()) {
-        bool foundProcess = false;
-        for (ListItem *item : items) {
-            if ((static_cast<ProcessItem*>(item))->getPid() == pid) {
-                foundProcess = true;
-                break;
+
+        if (item == nullptr) {
+            QPixmap icon = getProcessIconFromName(entry.name, entry.desktopFile, processIconCache);
+            item = new ProcessItem(icon, entry.name, entry.displayName, entry.cpu, entry.memory, entry.pid, entry.user, entry.state);
+            newItems << item;
+        } else {
+            // Process has exec'd another program.
+            if (item->getName() != entry.name) {
+                item->setIcon(getProcessIconFromName(entry.name, entry.desktopFile, processIconCache));
             }
+            item->updateStatus(entry.name, entry.displayName, entry.cpu, entry.memory, entry.user, entry.state);
         }
-
-        if (!foundProcess) {
-            processRecvBytes->remove(pid);
-
-            qDebug() << QString("Remove %1 from recv bytes map.").arg(pid);
+        item->setDiskStatus(entry.diskStatus);
+        item->setMemoryDetail(entry.pss, entry.uss);
+        item->setNetworkStatus(entry.networkStatus);
+        item->setStartTime(entry.startTime);
+
+        // Parents are linked once every row has its item, see below.
+        if (snapshot->treeMode) {
+            item->setSubtreeStatus(entry.subtreeCpu, entry.subtreeMemory, entry.subtreeDiskStatus, entry.subtreeNetworkStatus);
+        } else {
+            item->setSubtreeStatus(entry.cpu, entry.memory, entry.diskStatus, entry.networkStatus);
+            item->setParentItem(nullptr);
         }
-    }
-
-    // Have procps read the memory。
-    meminfo();
 
-    // Update memory status.
-    if (kb_swap_total > 0.0)  {
-        updateMemoryStatus(kb_main_used * 1024, kb_main_total * 1024, kb_swap_used * 1024, kb_swap_total * 1024);
-    } else {
-        updateMemoryStatus(kb_main_used * 1024, kb_main_total * 1024, 0, 0);
-    }
+        liveItems.insert(entry.pid, item);
 
-    if (NetworkTrafficFilter::getNetHogsMonitorStatus() != NETHOGS_STATUS_OK) {
-        qDebug() << "Failed to access network device(s).";
-    }
-
-    // Update network status.
-    NetworkTrafficFilter::Update update;
-
-    QMap<int, NetworkStatus> networkStatusSnapshot;
-    totalSentKbs = 0;
-    totalRecvKbs = 0;
-    while (NetworkTrafficFilter::getRowUpdate(update)) {
-        if (update.action != NETHOGS_APP_ACTION_REMOVE) {
-            uint32_t prevSentBytes = 0;
-            uint32_t prevRecvBytes = 0;
-
-            if (processSentBytes->contains(update.record.pid)) {
-                prevSentBytes = processSentBytes->value(update.record.pid);
-            }
-            if (processRecvBytes->contains(update.record.pid)) {
-                prevRecvBytes = processRecvBytes->value(update.record.pid);
+        // Thread rows of expanded processes, the sampler leaves threads empty for collapsed ones.
+        for (const ThreadEntry &thread : entry.threads) {
+            ThreadItem *threadItem = threadItems.take(thread.tid);
+            if (threadItem != nullptr && threadItem->getProcessItem() != item) {
+                removedItems << threadItem;
+                threadItem = nullptr;
             }
 
-            totalSentKbs += update.record.sent_kbs;
-            totalRecvKbs += update.record.recv_kbs;
-
-            totalSentBytes += (update.record.sent_bytes - prevSentBytes);
-            totalRecvBytes += (update.record.recv_bytes - prevRecvBytes);
-
-            (*processSentBytes)[update.record.pid] = update.record.sent_bytes;
-            (*processRecvBytes)[update.record.pid] = update.record.recv_bytes;
-
-            NetworkStatus status = {
-                update.record.sent_bytes,
-                update.record.recv_bytes,
-                update.record.sent_kbs,
-                update.record.recv_kbs
-            };
+            if (threadItem == nullptr) {
+                threadItem = new ThreadItem(item, thread.name, thread.cpu, thread.tid, thread.state);
+                newItems << threadItem;
+            } else {
+                threadItem->updateThreadStatus(thread.name, thread.cpu, thread.state);
+            }
 
-            (networkStatusSnapshot)[update.record.pid] = status;
+            liveThreadItems.insert(thread.tid, threadItem);
         }
     }
 
-    // Update ProcessItem's network status.
-    for (ListItem *item : items) {
-        ProcessItem *processItem = static_cast<ProcessItem*>(item);
-        if (networkStatusSnapshot.contains(processItem->getPid())) {
-            processItem->setNetworkStatus(networkStatusSnapshot.value(processItem->getPid()));
-        }
-
-        ProcPidIO pidIO;
-        getProcPidIO(processItem->getPid(), pidIO);
-
-        DiskStatus status = {0, 0};
-
-        if (processWriteKbs->contains(processItem->getPid())) {
-            status.writeKbs = (pidIO.wchar - processWriteKbs->value(processItem->getPid())) / (updateDuration / 1000.0);
+    // A parent may come after its child in pid order, so rows are only linked once all items exist.
+    if (snapshot->treeMode) {
+        for (const ProcessEntry &entry : snapshot->processes) {
+            liveItems.value(entry.pid)->setParentItem(liveItems.value(entry.parentPid, nullptr));
         }
-        (*processWriteKbs)[processItem->getPid()] = pidIO.wchar;
+    }
 
-        if (processReadKbs->contains(processItem->getPid())) {
-            status.readKbs = (pidIO.rchar - processReadKbs->value(processItem->getPid())) / (updateDuration / 1000.0);
+    // Units are keyed by their cgroup, a unit started again under the same name keeps its row.
+    for (const ServiceEntry &entry : snapshot->services) {
+        ServiceItem *item = serviceItems.take(entry.path);
+        if (item == nullptr) {
+            item = new ServiceItem(getProcessIconFromName(entry.name, "", processIconCache), entry.name, entry.path, entry.cpu, entry.memory, entry.processNumber);
+            newItems << item;
+        } else {
+            item->updateServiceStatus(entry.cpu, entry.memory, entry.processNumber);
         }
-        (*processReadKbs)[processItem->getPid()] = pidIO.rchar;
+        item->setDiskStatus(entry.diskStatus);
+        item->setNetworkStatus(entry.networkStatus);
 
-        processItem->setDiskStatus(status);
+        liveServiceItems.insert(entry.path, item);
     }
 
-    // Update cpu status.
-    updateCpuStatus(totalCpuPercent / cpuNumber);
-
-    QList<ListItem*> mergeItems;
-
-    if (filterType == OnlyGUI) {
-        // Merge chrome processes.
-        ListItem *chromeRootItem = nullptr;
-        QList<int> chromeChildPids;
-        for (ListItem *item : items) {
-            ProcessItem *processItem = static_cast<ProcessItem*>(item);
-            QString cmdline = Utils::getProcessCmdline(processItem->getPid());
-            QStringList cmdArgs = cmdline.split(QRegExp("\\s"));
-            cmdArgs.removeAll("");
-
-            if (cmdArgs.size() == 1 && cmdArgs.at(0) == "/opt/google/chrome/chrome") {
-                chromeRootItem = item;
-                chromeChildPids = processTree->getAllChildPids(processItem->getPid());
-
-                // Because chrome root process always have one whatever how manay chrome *window* or *tab* opened.
-                // So we break loop once found chrome processes.
-                break;
-            }
-        }
-
-        if (chromeRootItem != nullptr) {
-            ProcessItem *chromeRootProcessItem = static_cast<ProcessItem*>(chromeRootItem);
-            for (ListItem *item : items) {
-                ProcessItem *processItem = static_cast<ProcessItem*>(item);
-                if (chromeChildPids.contains(processItem->getPid())) {
-                    chromeRootProcessItem->mergeItem(processItem);
-                } else if (processItem->getPid() != chromeRootProcessItem->getPid()) {
-                    mergeItems.append(item);
-                }
-            }
-            mergeItems.append(chromeRootItem);
+    // Whatever is left has exited or isn't shown in current tab any more.
+    for (ProcessItem *item : processItems) {
+        removedItems << item;
+    }
+    for (ThreadItem *item : threadItems) {
+        removedItems << item;
+    }
+    for (ServiceItem *item : serviceItems) {
+        removedItems << item;
+    }
+    processItems.swap(liveItems);
+    threadItems.swap(liveThreadItems);
+    serviceItems.swap(liveServiceItems);
+
+    // Don't expand a process that reuses the pid of one that was expanded.
+    int expandedNumber = expandedPids.size();
+    for (auto pid = expandedPids.begin(); pid != expandedPids.end();) {
+        if (!processItems.contains(*pid)) {
+            pid = expandedPids.erase(pid);
         } else {
-            mergeItems = items;
+            ++pid;
         }
-    } else {
-        mergeItems = items;
+    }
+    if (expandedPids.size() != expandedNumber) {
+        updateExpandedPids();
     }
 
     // Update process status.
-    updateProcessStatus(mergeItems);
-
-    // Update network status.
-    updateNetworkStatus(totalRecvBytes, totalSentBytes, totalRecvKbs, totalSentKbs);
+    updateProcessStatus(newItems, removedItems);
 
     // Update process number.
-    updateProcessNumber(tabName, guiProcessNumber, systemProcessNumber);
-
-    // Keep processes we've read for cpu calculations next cycle.
-    prevProcesses = processes;
-    
-    delete processTree;
+    updateProcessNumber(snapshot->tabName, snapshot->guiProcessNumber, snapshot->systemProcessNumber);
 }
-
@@ -25,32 +25,35 @@
 #define STATUSMONITOR_H
 
 #include "cpu_monitor.h"
-#include "find_window_title.h"
 #include "memory_monitor.h"
 #include "network_monitor.h"
-#include "network_traffic_filter.h"
 #include "process_item.h"
+#include "service_item.h"
+#include "snapshot_source.h"
+#include "status_sampler.h"
+#include "thread_item.h"
+#include <QHash>
 #include <QMap>
 #include <QPointF>
-#include <QTimer>
+#include <QSet>
+#include <QThread>
 #include <QVBoxLayout>
 #include <QWidget>
-#include <deque>
-#include <proc/readproc.h>
-#include <proc/sysinfo.h>
 
 class StatusMonitor : public QWidget
 {
     Q_OBJECT
 
-    typedef std::map<int, proc_t> storedProcType;
-    
-    enum FilterType {OnlyGUI, OnlyMe, AllProcess};
-
 public:
-    StatusMonitor(QWidget *parent = 0);
+    /*
+     * @replayFile recording to play instead of sampling the system, empty to sample
+     * @replayMaxSpeed play without waiting the recorded time between frames
+     */
+    StatusMonitor(QString replayFile = QString(), bool replayMaxSpeed = false, QWidget *parent = 0);
     ~StatusMonitor();
 
+    bool isTreeMode() const;
+
 protected:
     void paintEvent(QPaintEvent *event);
 
@@ -59,36 +62,58 @@ signals:
     void updateMemoryStatus(long usedMemory, long totalMemory, long usedSwap, long totalSwap);
     void updateNetworkStatus(uint32_t totalRecvBytes, uint32_t totalSentBytes, float totalRecvKbs, float totalSentKbs);
     void updateProcessNumber(QString tabName, int guiProcessNumber, int systemProcessNumber);
-    void updateProcessStatus(QList<ListItem*> items);
+    void updateProcessStatus(QList<ListItem*> newItems, QList<ListItem*> removedItems);
 
 public slots:
+    void applySnapshot();
     void switchToAllProcess();
     void switchToOnlyGui();
     void switchToOnlyMe();
-    void updateStatus();
+    void switchToServices();
+    
+    /*
+     * Expand processes to show their threads, or collapse them if they are all expanded already.
+     */
+    void toggleThreads(QList<int> pids);
+    
+    /*
+     * Tell whether the window can be seen, expensive sampling is paused and animations are skipped while it can't.
+     */
+    void setWindowVisible(bool visible);
+    
+    /*
+     * Processes shown on screen or selected, shared memory is only worked out for those.
+     */
+    void setVisiblePids(QList<int> pids);
+    
+    /*
+     * Show processes under their parent, collapsed ones with the totals of their subtree.
+     * The choice is kept for the next start.
+     */
+    void setTreeMode(bool enabled);
                                        
 private:
+    void switchFilterType(StatusSampler::FilterType type, QString name);
+    void updateExpandedPids();
+
     CpuMonitor *cpuMonitor;
-    FilterType filterType;
-    FindWindowTitle *findWindowTitle;
+    QHash<int, ProcessItem*> processItems;
     MemoryMonitor *memoryMonitor;
     NetworkMonitor *networkMonitor;
+    QHash<QString, ServiceItem*> serviceItems;
+    QHash<int, ThreadItem*> threadItems;
     QMap<QString, QPixmap> *processIconCache;
-    QMap<int, uint32_t> *processRecvBytes;
-    QMap<int, uint32_t> *processSentBytes;
-    QMap<int, unsigned long> *processReadKbs;
-    QMap<int, unsigned long> *processWriteKbs;
-    QString tabName;
-    QTimer *updateStatusTimer;
+    QSet<int> expandedPids;
+    QThread *samplerThread;
     QVBoxLayout *layout;
-    float totalRecvKbs;
-    float totalSentKbs;
+    SnapshotSource *snapshotSource;
+    StatusSnapshotPtr currentSnapshot;
+    bool treeMode = false;
+    bool windowVisible = true;
+    double cpuBudget = 5;
+    int parallelThreshold = 4096;
     // int updateDuration = 200;
     int updateDuration = 2000;
-    storedProcType prevProcesses;
-    uint32_t totalRecvBytes;
-    uint32_t totalSentBytes;
-    unsigned long long totalCpuTime;
 };
 
 #endif
@@ -0,0 +1,1051 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "status_sampler.h"
+#include "desktop_entry_index.h"
+#include "network_traffic_filter.h"
+#include "process_grouper.h"
+#include "utils.h"
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+#include <proc/sysinfo.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace Utils;
+
+// Busy share of one cpu from which threads of a listed process are read even when it is collapsed.
+static const double THREAD_CPU_THRESHOLD = 50;
+
+// Ticks between two attempts to attach to a collector that wasn't running.
+static const int COLLECTOR_ATTACH_TICKS = 16;
+
+StatusSampler::StatusSampler(int duration, double budget, int reportTicks, int threshold) : SnapshotSource()
+{
+    cpuBudget = budget;
+    parallelThreshold = std::max(threshold, 0);
+    profileReportTicks = reportTicks;
+    profiledTicks = 0;
+    visible = true;
+
+    filterType = OnlyGUI;
+    tabName = "应用程序";
+    updateDuration = duration;
+
+    totalSentBytes = 0;
+    totalRecvBytes = 0;
+
+    cgroupSampler = nullptr;
+    collectorRing = nullptr;
+    cpuAccounting = nullptr;
+    findWindowTitle = nullptr;
+    memoryDetails = nullptr;
+    pidStates = nullptr;
+    processGrouper = nullptr;
+    processSampler = nullptr;
+    publishRing = nullptr;
+    recorder = nullptr;
+    refreshScheduler = nullptr;
+    governor = nullptr;
+    profiler = nullptr;
+    taskstatsClient = nullptr;
+    threadSampler = nullptr;
+    totalCpuAccounting = nullptr;
+    updateStatusTimer = nullptr;
+
+    lastSampleTime = 0;
+    attachTicks = 0;
+    execEvents = false;
+    fromCollector = false;
+    headless = false;
+    taskstatsIO = false;
+    exitsDropWarned = false;
+    ioQueryWarned = false;
+}
+
+StatusSampler::~StatusSampler()
+{
+    stop();
+}
+
+void StatusSampler::start()
+{
+    // Every run logs its first taskstats failures again.
+    exitsDropWarned = false;
+    ioQueryWarned = false;
+
+    // Everything is created here so it belongs to the sampler thread, FindWindowTitle keeps its own xcb connection.
+    // Without a display there's nothing to connect to, and nobody to show titles to.
+    cgroupSampler = new CgroupSampler();
+    cpuAccounting = new CpuAccounting();
+    if (!headless) {
+        findWindowTitle = new FindWindowTitle();
+    }
+    governor = new SamplingGovernor();
+    memoryDetails = new MemoryDetailSampler();
+    pidStates = new PidStateTable();
+    processGrouper = new ProcessGrouper();
+    processSampler = new ProcessSampler(parallelThreshold);
+    profiler = new PipelineProfiler();
+    refreshScheduler = new RefreshScheduler();
+    threadSampler = new ThreadSampler();
+    totalCpuAccounting = new CpuAccounting();
+
+    governor->setCpuBudget(cpuBudget, updateDuration);
+    governor->setVisible(visible);
+
+    // Taskstats needs CAP_NET_ADMIN, without it disk rates come from /proc/pid/io and short-lived processes stay invisible.
+    taskstatsClient = new TaskstatsClient();
+    taskstatsIO = false;
+    if (taskstatsClient->start()) {
+        taskstatsClient->listenExits();
+
+        std::vector<pid_t> self(1, getpid());
+        taskstatsIO = taskstatsClient->query(self, ioRecords) && ioRecords.size() == 1;
+    }
+    if (!taskstatsIO && !taskstatsClient->isListeningExits()) {
+        delete taskstatsClient;
+        taskstatsClient = nullptr;
+    }
+
+    // Viewers started after the collector use it right away, otherwise they look for it now and then.
+    if (publishRing == nullptr) {
+        collectorRing = SnapshotRing::attach();
+        attachTicks = COLLECTOR_ATTACH_TICKS;
+    }
+
+    sampleTimer.start();
+
+    // A tick that overruns the interval doesn't pile up timeouts, the timer just fires once more after it returns.
+    updateStatusTimer = new QTimer(this);
+    connect(updateStatusTimer, &QTimer::timeout, this, &StatusSampler::sample);
+    updateStatusTimer->start(updateDuration);
+
+    sample();
+}
+
+void StatusSampler::stop()
+{
+    if (updateStatusTimer != nullptr) {
+        updateStatusTimer->stop();
+        delete updateStatusTimer;
+        updateStatusTimer = nullptr;
+    }
+
+    delete cgroupSampler;
+    delete collectorRing;
+    delete cpuAccounting;
+    delete findWindowTitle;
+    delete governor;
+    delete memoryDetails;
+    delete pidStates;
+    delete processGrouper;
+    delete processSampler;
+    delete profiler;
+    delete refreshScheduler;
+    delete taskstatsClient;
+    delete threadSampler;
+    delete totalCpuAccounting;
+
+    cgroupSampler = nullptr;
+    collectorRing = nullptr;
+    cpuAccounting = nullptr;
+    findWindowTitle = nullptr;
+    governor = nullptr;
+    memoryDetails = nullptr;
+    pidStates = nullptr;
+    processGrouper = nullptr;
+    processSampler = nullptr;
+    profiler = nullptr;
+    refreshScheduler = nullptr;
+    taskstatsClient = nullptr;
+    taskstatsIO = false;
+    threadSampler = nullptr;
+    totalCpuAccounting = nullptr;
+
+    collectorRecords.clear();
+    deferredExits.clear();
+    foldedRoots.clear();
+    processIdentities.clear();
+    fromCollector = false;
+}
+
+void StatusSampler::setHeadless()
+{
+    // Viewers and replays filter for themselves, everything is published.
+    headless = true;
+    filterType = AllProcess;
+    tabName = "所有进程";
+}
+
+void StatusSampler::setPublishRing(SnapshotRing *ring)
+{
+    publishRing = ring;
+}
+
+void StatusSampler::setRecorder(SnapshotRecorder *recorder)
+{
+    this->recorder = recorder;
+}
+
+void StatusSampler::setExpandedPids(QList<int> pids)
+{
+    expandedPids = pids.toSet();
+
+    // Show threads of a newly expanded process straight away.
+    if (threadSampler != nullptr) {
+        sample();
+    }
+}
+
+void StatusSampler::setMemoryDetailPids(QList<int> pids)
+{
+    memoryDetailPids = pids.toSet();
+
+    // Start reading rows that just scrolled into view, values show up from the next tick on.
+    if (memoryDetails != nullptr && visible) {
+        requestMemoryDetails();
+    }
+}
+
+void StatusSampler::setVisible(bool shown)
+{
+    visible = shown;
+    if (governor == nullptr || governor->isVisible() == visible) {
+        return;
+    }
+    governor->setVisible(visible);
+
+    // Catch up on what was paused as soon as the window shows up again, nobody sees detailed memory meanwhile.
+    if (visible) {
+        sample();
+    } else {
+        memoryDetails->request(std::vector<MemoryDetailSampler::Request>());
+    }
+}
+
+void StatusSampler::setFilterType(int type, QString name)
+{
+    filterType = static_cast<FilterType>(type);
+    tabName = name;
+
+    // Show the new tab straight away instead of waiting for the next tick, with nothing left stale.
+    if (refreshScheduler != nullptr) {
+        refreshScheduler->requestAll();
+    }
+    sample();
+}
+
+StatusSampler::CachedIdentity& StatusSampler::updateIdentity(const ProcessSample &sample, unsigned int desktopGeneration)
+{
+    auto identity = processIdentities.find(sample.tid);
+
+    // A reused pid has another start time. An exec keeps the pid and start time, the proc connector
+    // reports it when we have one, otherwise a change of the stat name is the best hint we get.
+    bool execChanged = (identity == processIdentities.end() ||
+                        identity->startTime != sample.start_time ||
+                        identity->execed ||
+                        (!execEvents && strcmp(identity->cmd, sample.cmd) != 0));
+
+    if (identity == processIdentities.end()) {
+        identity = processIdentities.insert(sample.tid, CachedIdentity());
+    }
+
+    if (refreshScheduler->isDue(RefreshScheduler::ProcessIdentity, execChanged)) {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::ProcessIdentity);
+        timer.setItemNumber(1);
+
+        identity->startTime = sample.start_time;
+        memcpy(identity->cmd, sample.cmd, sizeof(identity->cmd));
+        identity->cmdline = getProcessCmdline(sample.tid);
+        identity->name = getProcessName(&sample, identity->cmdline);
+        identity->desktopFile = getDesktopFileFromName(identity->name);
+        identity->desktopGeneration = desktopGeneration;
+        identity->execed = false;
+        identity->helper = ProcessGrouper::isHelper(identity->cmdline);
+        identity->cgroupId = 0;
+    } else if (identity->desktopGeneration != desktopGeneration) {
+        // Applications were installed or removed, match the name again.
+        identity->desktopFile = getDesktopFileFromName(identity->name);
+        identity->desktopGeneration = desktopGeneration;
+    }
+    identity->tick = refreshScheduler->tick();
+
+    return *identity;
+}
+
+static const ProcessSample* findProcess(const ProcessSampler::Snapshot &processes, pid_t pid)
+{
+    auto process = std::lower_bound(processes.begin(), processes.end(), pid,
+                                    [](const ProcessSample &sample, pid_t value) { return sample.tid < value; });
+    if (process != processes.end() && process->tid == pid) {
+        return &(*process);
+    }
+
+    return nullptr;
+}
+
+double StatusSampler::foldExitedProcesses(const ProcessSampler::Snapshot &processes, QVector<ProcessEntry> &entries, long long now)
+{
+    if (!taskstatsClient->pollExits(exitRecords) && !exitsDropWarned) {
+        qDebug() << "Exit records were dropped, short-lived processes are under-counted.";
+        exitsDropWarned = true;
+    }
+
+    // Processes listed last tick that exited before its records were drained, their rest belongs to this interval.
+    size_t polledNumber = exitRecords.size();
+    exitRecords.insert(exitRecords.end(), deferredExits.begin(), deferredExits.end());
+    deferredExits.clear();
+
+    if (exitRecords.empty()) {
+        return 0;
+    }
+
+    QHash<int, int> rowIndexes;
+    rowIndexes.reserve(entries.size());
+    for (int index = 0; index < entries.size(); index++) {
+        rowIndexes.insert(entries[index].pid, index);
+    }
+
+    // Parents may have exited in the same interval (make -> sh -> cc), they are only known from their records.
+    QHash<int, int> exitedParents;
+    for (const TaskStatsRecord &record : exitRecords) {
+        exitedParents.insert(record.pid, record.ppid);
+    }
+
+    double clockTicks = sysconf(_SC_CLK_TCK);
+    int cpuNumber = cpuAccounting->cpuNumber();
+    double totalPercent = 0;
+
+    for (size_t index = 0; index < exitRecords.size(); index++) {
+        const TaskStatsRecord &record = exitRecords[index];
+        const ProcessSample *process = index < polledNumber ? findProcess(processes, record.pid) : nullptr;
+
+        // The process was read from /proc this tick and exited since, what it used after that is only
+        // known next tick, when this tick's counters are the previous ones. A main thread that leaves while
+        // other threads run doesn't end the process, only the group record or a lone thread's record does.
+        if (process != nullptr && (record.exited || process->nlwp == 1)) {
+            deferredExits.push_back(record);
+            continue;
+        }
+
+        // Only some threads exited, the process itself is still sampled from /proc. Its counters there keep
+        // what the dead threads used, remember their records to set against those counters when it exits.
+        if (process != nullptr) {
+            PidState *state = pidStates->find(record.pid, process->start_time);
+            if (state != nullptr) {
+                state->exitedCpuTime += record.cpuTime;
+                state->exitedReadBytes += record.readBytes;
+                state->exitedWriteBytes += record.writeBytes;
+            }
+            continue;
+        }
+
+        unsigned long long cpuTime = record.cpuTime * clockTicks / 1000000;
+        unsigned long long readBytes = record.readBytes;
+        unsigned long long writeBytes = record.writeBytes;
+        double ioSeconds = (now - lastSampleTime) / 1000.0;
+
+        // A process sampled last tick had everything up to then counted already, only the rest belongs here.
+        // Records of this poll only cover the threads that lived to the end, the sampled counters cover all of them.
+        // Threads that ended before the process was first seen are unknown, such a process is under-counted.
+        const ProcessSample *previous = findProcess(previousProcesses, record.pid);
+        PidState *state = previous != nullptr ? pidStates->find(record.pid, previous->start_time) : nullptr;
+        if (state != nullptr) {
+            cpuTime = (record.cpuTime + state->exitedCpuTime) * clockTicks / 1000000;
+            cpuTime = cpuTime > state->cpuTime ? cpuTime - state->cpuTime : 0;
+
+            if (state->hasIO) {
+                // Taskstats counters of a main thread never held the other threads, /proc ones did.
+                if (!state->taskstatsIO) {
+                    readBytes += state->exitedReadBytes;
+                    writeBytes += state->exitedWriteBytes;
+                }
+                readBytes = readBytes > state->readBytes ? readBytes - state->readBytes : 0;
+                writeBytes = writeBytes > state->writeBytes ? writeBytes - state->writeBytes : 0;
+                ioSeconds = (now - state->ioTime) / 1000.0;
+            }
+        }
+
+        double cpu = cpuAccounting->processPercent(cpuTime);
+        totalPercent += cpu;
+
+        // Charge the closest ancestor shown in the list.
+        pid_t ancestor = record.ppid;
+        for (int depth = 0; depth < 64 && ancestor > 0; depth++) {
+            auto row = rowIndexes.find(ancestor);
+            if (row != rowIndexes.end()) {
+                ProcessEntry &entry = entries[row.value()];
+                entry.cpu += cpu / cpuNumber;
+                if (ioSeconds > 0) {
+                    entry.diskStatus.readKbs += readBytes / ioSeconds;
+                    entry.diskStatus.writeKbs += writeBytes / ioSeconds;
+                }
+                break;
+            }
+
+            const ProcessSample *parent = findProcess(processes, ancestor);
+            ancestor = parent != nullptr ? parent->ppid : exitedParents.value(ancestor, 0);
+        }
+    }
+
+    return totalPercent;
+}
+
+void StatusSampler::updateDiskStatus(QVector<ProcessEntry> &entries, long long now)
+{
+    // Ask taskstats about every single-threaded row in one batch, it only knows the main thread of the others.
+    ioPids.clear();
+    for (const IORequest &request : ioRequests) {
+        if (request.batched) {
+            ioPids.push_back(request.pid);
+        }
+    }
+
+    ioRecords.clear();
+    if (!ioPids.empty() && !taskstatsClient->query(ioPids, ioRecords)) {
+        if (!ioQueryWarned) {
+            qDebug() << "Taskstats query failed, reading disk counters from /proc instead.";
+            ioQueryWarned = true;
+        }
+        ioRecords.clear();
+    }
+
+    // Records are in request order with exited processes left out, so one cursor walks both lists.
+    auto record = ioRecords.begin();
+    for (const IORequest &request : ioRequests) {
+        PidState *state = pidStates->find(request.pid, request.startTime);
+        if (state == nullptr) {
+            continue;
+        }
+
+        unsigned long long readBytes;
+        unsigned long long writeBytes;
+        bool fromTaskstats = false;
+
+        if (request.batched && record != ioRecords.end() && record->pid == request.pid) {
+            readBytes = record->readBytes;
+            writeBytes = record->writeBytes;
+            fromTaskstats = true;
+            ++record;
+        } else {
+            ProcPidIO pidIO;
+            if (!getProcPidIO(request.pid, pidIO)) {
+                continue;
+            }
+            readBytes = pidIO.rchar;
+            writeBytes = pidIO.wchar;
+        }
+
+        // Counters of the main thread and of the whole process can't be subtracted, start over when the source changes.
+        bool comparable = state->hasIO && state->taskstatsIO == fromTaskstats
+            && readBytes >= state->readBytes && writeBytes >= state->writeBytes;
+        DiskStatus &status = entries[request.row].diskStatus;
+        if (comparable && now > state->ioTime) {
+            status.readKbs = (readBytes - state->readBytes) / ((now - state->ioTime) / 1000.0);
+            status.writeKbs = (writeBytes - state->writeBytes) / ((now - state->ioTime) / 1000.0);
+        }
+        state->readKbs = status.readKbs;
+        state->writeKbs = status.writeKbs;
+
+        state->readBytes = readBytes;
+        state->writeBytes = writeBytes;
+        state->ioTime = now;
+        state->hasIO = true;
+        state->taskstatsIO = fromTaskstats;
+    }
+
+    ioRequests.clear();
+}
+
+void StatusSampler::requestMemoryDetails()
+{
+    // A row of an application stands for every process folded into it.
+    detailRequests.clear();
+    for (const ProcessSample &process : currentProcesses) {
+        auto root = foldedRoots.find(process.tid);
+        pid_t rowPid = root != foldedRoots.end() ? root->second : process.tid;
+        if (memoryDetailPids.contains(rowPid)) {
+            MemoryDetailSampler::Request request = {process.tid, process.start_time};
+            detailRequests.push_back(request);
+        }
+    }
+
+    memoryDetails->request(detailRequests);
+}
+
+bool StatusSampler::readCollector()
+{
+    if (publishRing != nullptr) {
+        return false;
+    }
+
+    // A collector may be started after the viewer.
+    if (collectorRing == nullptr) {
+        if (--attachTicks > 0) {
+            return false;
+        }
+        attachTicks = COLLECTOR_ATTACH_TICKS;
+
+        collectorRing = SnapshotRing::attach();
+        if (collectorRing == nullptr) {
+            return false;
+        }
+    }
+
+    if (!collectorRing->read(collectorTotals, collectorRecords)) {
+        // A collector that stopped publishing is let go, one started again publishes into a new segment.
+        if (!collectorRing->isAlive()) {
+            qDebug() << "Collector stopped publishing, sampling locally.";
+            delete collectorRing;
+            collectorRing = nullptr;
+
+            // Nothing captures traffic for us any more, unless this viewer did from the start.
+            NetworkTrafficFilter::startNethogsMonitor();
+        }
+        return false;
+    }
+
+    return true;
+}
+
+void StatusSampler::publishToRing(const StatusSnapshot *snapshot)
+{
+    SnapshotRing::Record *records = publishRing->beginWrite();
+    size_t recordNumber = std::min(currentProcesses.size(), publishRing->capacity());
+    const QVector<ProcessEntry> &entries = snapshot->processes;
+    int cpuNumber = cpuAccounting->cpuNumber();
+
+    // Rows were built in process order, one cursor walks both.
+    int row = 0;
+    for (size_t index = 0; index < recordNumber; index++) {
+        SnapshotRing::Record &record = records[index];
+        record.sample = currentProcesses[index];
+        record.readKbs = 0;
+        record.writeKbs = 0;
+        record.sentBytes = 0;
+        record.recvBytes = 0;
+        record.sentKbs = 0;
+        record.recvKbs = 0;
+
+        while (row < entries.size() && entries[row].pid < record.sample.tid) {
+            row++;
+        }
+        if (row < entries.size() && entries[row].pid == record.sample.tid) {
+            const ProcessEntry &entry = entries[row];
+
+            // Cpu of children that exited during the interval is charged to the row already.
+            record.sample.pcpu = entry.cpu * cpuNumber;
+            record.readKbs = entry.diskStatus.readKbs;
+            record.writeKbs = entry.diskStatus.writeKbs;
+            record.sentBytes = entry.networkStatus.sentBytes;
+            record.recvBytes = entry.networkStatus.recvBytes;
+            record.sentKbs = entry.networkStatus.sentKbs;
+            record.recvKbs = entry.networkStatus.recvKbs;
+        }
+    }
+
+    SnapshotRing::Totals totals;
+    totals.cpuPercent = snapshot->cpuPercent;
+    totals.usedMemory = snapshot->usedMemory;
+    totals.totalMemory = snapshot->totalMemory;
+    totals.usedSwap = snapshot->usedSwap;
+    totals.totalSwap = snapshot->totalSwap;
+    totals.totalRecvBytes = snapshot->totalRecvBytes;
+    totals.totalSentBytes = snapshot->totalSentBytes;
+    totals.totalRecvKbs = snapshot->totalRecvKbs;
+    totals.totalSentKbs = snapshot->totalSentKbs;
+
+    publishRing->endWrite(totals, recordNumber);
+}
+
+double StatusSampler::sampleProcesses(StatusSnapshot *snapshot)
+{
+    refreshScheduler->beginTick();
+
+    // Read the list of open processes information, slow changing files only when they are due.
+    unsigned int fields = ProcessSampler::StatField;
+    if (refreshScheduler->isDue(RefreshScheduler::ProcessMemory)) {
+        fields |= ProcessSampler::StatmField;
+    }
+    if (refreshScheduler->isDue(RefreshScheduler::ProcessOwner)) {
+        fields |= ProcessSampler::StatusField;
+    }
+
+    // Keep last tick's list to find the start time of processes that exited since.
+    previousProcesses.swap(currentProcesses);
+    ProcessSampler::Snapshot &processes = currentProcesses;
+    {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::ProcessRead);
+        if (fromCollector) {
+            processes.resize(collectorRecords.size());
+            for (size_t index = 0; index < collectorRecords.size(); index++) {
+                processes[index] = collectorRecords[index].sample;
+            }
+        } else {
+            processSampler->sample(processes, fields);
+        }
+        timer.setItemNumber(processes.size());
+    }
+
+    // Identities of processes that exec'd are read again below, the collector's events don't reach viewers.
+    execEvents = !fromCollector && processSampler->isEventDriven();
+    if (!fromCollector) {
+        processSampler->takeChangedPids(changedPids);
+        for (pid_t pid : changedPids) {
+            auto identity = processIdentities.find(pid);
+            if (identity != processIdentities.end()) {
+                identity->execed = true;
+            }
+        }
+    }
+
+    // Read /proc/stat once, every process of this sample is measured against the same cpu time.
+    cpuAccounting->sample();
+
+    // Rates are measured against the real time between two reads, ticks aren't evenly spaced once sampling overruns.
+    long long now = sampleTimer.elapsed();
+
+    // Fill in CPU, processes seen for the first time (or with a reused pid) have no previous ticks yet.
+    // The collector's values are kept, states still follow so local sampling can take over without a gap.
+    pidStates->beginGeneration();
+    for (auto &i : processes) {
+        bool created;
+        PidState *state = pidStates->touch(i.tid, i.start_time, &created);
+        unsigned long long cpuTime = i.utime + i.stime;
+
+        if (!created && !fromCollector) {
+            i.pcpu = cpuAccounting->processPercent(cpuTime - state->cpuTime);
+        }
+        state->cpuTime = cpuTime;
+    }
+
+    // Read processes information.
+    QString username = qgetenv("USER");
+
+    // Pick up installed or removed applications before matching processes against desktop files.
+    if (refreshScheduler->isDue(RefreshScheduler::DesktopEntries)) {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::DesktopEntries);
+        DesktopEntryIndex::instance()->refresh();
+    }
+    unsigned int desktopGeneration = DesktopEntryIndex::instance()->generation();
+
+    QVector<ProcessEntry> &entries = snapshot->processes;
+    int cpuNumber = cpuAccounting->cpuNumber();
+    double totalCpuPercent = 0;
+
+    // Titles of the last update are kept while the governor skips the window list.
+    if (findWindowTitle != nullptr && refreshScheduler->isDue(RefreshScheduler::WindowTitles) && governor->isDue(SamplingGovernor::WindowTitles)) {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::WindowTitles);
+        findWindowTitle->updateWindowInfos();
+    }
+
+    int guiProcessNumber = 0;
+    int systemProcessNumber = 0;
+
+    groupInfos.resize(processes.size());
+
+    // Services only need the cgroup of each process, their totals come from the cgroups themselves.
+    bool services = filterType == Services;
+    if (services) {
+        serviceGroups.resize(processes.size());
+        cgroupSampler->beginTick();
+    }
+
+    threadSampler->beginTick();
+
+    PipelineProfiler::Timer rowsTimer(profiler, PipelineProfiler::Rows);
+    for(auto &i:processes) {
+        QString user = getUserName(i.euid);
+
+        double cpu = i.pcpu;
+        CachedIdentity &identity = updateIdentity(i, desktopGeneration);
+        QString name = identity.name;
+        long memory = (i.resident - i.share) * sysconf(_SC_PAGESIZE);
+
+        if (services) {
+            serviceGroups[&i - processes.data()] = cgroupSampler->add(i.tid, identity.cgroupId, cpu, memory);
+        }
+
+        GroupInfo &groupInfo = groupInfos[&i - processes.data()];
+        groupInfo.helper = identity.helper;
+        groupInfo.nameHash = qHash(name);
+        std::string desktopFile = identity.desktopFile;
+        bool isGui = desktopFile.size() != 0;
+
+        if (isGui) {
+            guiProcessNumber++;
+        } else {
+            systemProcessNumber++;
+        }
+
+        bool appendItem = false;
+        if (filterType == OnlyGUI) {
+            appendItem = (user == username && isGui);
+        } else if (filterType == OnlyMe) {
+            appendItem = (user == username);
+        } else if (filterType == AllProcess) {
+            appendItem = true;
+        }
+
+        if (appendItem) {
+            int pid = i.tid;
+            QString displayName;
+
+            QString title = findWindowTitle != nullptr ? findWindowTitle->findWindowTitle(pid) : QString();
+            if (title != "") {
+                if (filterType == AllProcess) {
+                    displayName = QString("[%1] %2").arg(user).arg(title);
+                } else {
+                    displayName = title;
+                }
+            } else {
+                if (filterType == AllProcess) {
+                    displayName = QString("[%1] %2").arg(user).arg(getDisplayNameFromName(name, desktopFile));
+                } else {
+                    displayName = getDisplayNameFromName(name, desktopFile);
+                }
+            }
+
+            ProcessEntry entry;
+            entry.pid = pid;
+            entry.ppid = i.ppid;
+            entry.startTime = i.start_time;
+            entry.name = name;
+            entry.displayName = displayName;
+            entry.user = user;
+            entry.desktopFile = desktopFile;
+            entry.state = i.state;
+            entry.cpu = cpu / cpuNumber;
+            entry.memory = memory;
+            entry.pss = -1;
+            entry.uss = -1;
+            entry.parentPid = 0;
+            entry.diskStatus = {0, 0};
+            entry.networkStatus = {0, 0, 0, 0};
+
+            // Disk rates are read for rows on screen or selected, all at once below. Other rows and rows the
+            // governor skips keep their last rates, rows that were busy are read anyway so their rates can drop.
+            // Headless sampling has no screen, viewers and recordings need every row.
+            if (fromCollector) {
+                const SnapshotRing::Record &record = collectorRecords[&i - processes.data()];
+                entry.diskStatus = {record.readKbs, record.writeKbs};
+            } else {
+                PidState *state = pidStates->find(pid, i.start_time);
+                auto root = foldedRoots.find(pid);
+                bool shown = headless || memoryDetailPids.contains(root != foldedRoots.end() ? root->second : pid) ||
+                    (state != nullptr && (state->readKbs > 0 || state->writeKbs > 0));
+
+                if (refreshScheduler->isDue(RefreshScheduler::ProcessIO, false, shown) && governor->isDue(SamplingGovernor::ProcessIO)) {
+                    IORequest request = {entries.size(), pid, i.start_time, taskstatsIO && i.nlwp == 1};
+                    ioRequests.push_back(request);
+                } else if (state != nullptr && state->hasIO) {
+                    entry.diskStatus = {state->readKbs, state->writeKbs};
+                }
+            }
+
+            // Threads are only read for expanded rows, and for busy ones so their rates are ready once expanded.
+            bool expanded = expandedPids.contains(pid);
+            bool prefetch = !headless && cpu >= THREAD_CPU_THRESHOLD && governor->isDue(SamplingGovernor::ThreadPrefetch);
+            if (expanded || prefetch) {
+                PipelineProfiler::Timer timer(profiler, PipelineProfiler::Threads);
+                if (threadSampler->sample(pid, threadSamples) && expanded) {
+                    entry.threads.reserve(threadSamples.size());
+                    for (const ThreadSample &thread : threadSamples) {
+                        ThreadEntry threadEntry;
+                        threadEntry.tid = thread.tid;
+                        threadEntry.name = QString::fromUtf8(thread.name);
+                        threadEntry.state = thread.state;
+                        threadEntry.cpu = cpuAccounting->processPercent(thread.cpuTicks) / cpuNumber;
+                        entry.threads << threadEntry;
+                    }
+                }
+                timer.setItemNumber(threadSamples.size());
+            }
+
+            // Values read by the memory detail worker, whatever it has by now.
+            MemoryDetail detail;
+            if (memoryDetails->find(pid, i.start_time, detail)) {
+                entry.pss = detail.pss;
+                entry.uss = detail.uss;
+            }
+
+            entries << entry;
+        }
+
+        totalCpuPercent += cpu;
+    }
+    rowsTimer.setItemNumber(entries.size());
+
+    if (services) {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::Services);
+        cgroupSampler->sample(now, serviceSamples);
+        timer.setItemNumber(serviceSamples.size());
+
+        QVector<ServiceEntry> &rows = snapshot->services;
+        rows.reserve(serviceSamples.size());
+        for (const CgroupSampler::Group *group : serviceSamples) {
+            ServiceEntry entry;
+            entry.path = QString::fromStdString(group->path);
+            entry.name = QString::fromStdString(group->name);
+            entry.processNumber = group->processNumber;
+            entry.cpu = group->cpuPercent / cpuNumber;
+            entry.memory = group->memory;
+            entry.diskStatus = {group->readKbs, group->writeKbs};
+            entry.networkStatus = {0, 0, 0, 0};
+            rows << entry;
+        }
+    }
+
+    {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::DiskIO);
+        timer.setItemNumber(ioRequests.size());
+        updateDiskStatus(entries, now);
+    }
+
+    // Processes that exited since the last tick still used cpu and disk in this interval, the collector folded them already.
+    if (!fromCollector && taskstatsClient != nullptr && taskstatsClient->isListeningExits()) {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::ExitAccounting);
+        totalCpuPercent += foldExitedProcesses(processes, entries, now);
+        timer.setItemNumber(exitRecords.size());
+    }
+    lastSampleTime = now;
+
+    // Forget identities of processes that have exited.
+    if (processIdentities.size() > static_cast<int>(processes.size())) {
+        for (auto identity = processIdentities.begin(); identity != processIdentities.end();) {
+            if (identity->tick != refreshScheduler->tick()) {
+                identity = processIdentities.erase(identity);
+            } else {
+                ++identity;
+            }
+        }
+    }
+
+    snapshot->guiProcessNumber = guiProcessNumber;
+    snapshot->systemProcessNumber = systemProcessNumber;
+
+    return totalCpuPercent / cpuNumber;
+}
+
+void StatusSampler::sample()
+{
+    if (processSampler == nullptr) {
+        return;
+    }
+
+    governor->beginTick();
+    long long tickStartTime = PipelineProfiler::now();
+
+    StatusSnapshot *snapshot = new StatusSnapshot();
+    snapshot->tabName = tabName;
+
+    // Machine totals are cheap, they keep the monitors going while the process list is paused.
+    totalCpuAccounting->sample();
+
+    // Take whatever the collector published last, even the totals alone need privileges to be complete.
+    fromCollector = readCollector();
+
+    // Everything built on the process list, skipped as a whole when the governor pauses it.
+    bool processListDue = governor->isDue(SamplingGovernor::ProcessList);
+    snapshot->hasProcesses = processListDue;
+
+    double cpuPercent = 0;
+    if (processListDue) {
+        cpuPercent = sampleProcesses(snapshot);
+    }
+
+    QVector<ProcessEntry> &entries = snapshot->processes;
+    const ProcessSampler::Snapshot &processes = currentProcesses;
+
+    // Have procps read the memory, unless the collector did already.
+    if (fromCollector) {
+        snapshot->usedMemory = collectorTotals.usedMemory;
+        snapshot->totalMemory = collectorTotals.totalMemory;
+        snapshot->usedSwap = collectorTotals.usedSwap;
+        snapshot->totalSwap = collectorTotals.totalSwap;
+    } else {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::Memory);
+        meminfo();
+
+        snapshot->usedMemory = kb_main_used * 1024;
+        snapshot->totalMemory = kb_main_total * 1024;
+        if (kb_swap_total > 0.0)  {
+            snapshot->usedSwap = kb_swap_used * 1024;
+            snapshot->totalSwap = kb_swap_total * 1024;
+        } else {
+            snapshot->usedSwap = 0;
+            snapshot->totalSwap = 0;
+        }
+    }
+
+    if (NetworkTrafficFilter::getNetHogsMonitorStatus() != NETHOGS_STATUS_OK) {
+        qDebug() << "Failed to access network device(s).";
+    }
+
+    // Update network status.
+    NetworkTrafficFilter::Update update;
+
+    QMap<int, NetworkStatus> networkStatusSnapshot;
+    float totalSentKbs = 0;
+    float totalRecvKbs = 0;
+    long long networkStartTime = PipelineProfiler::now();
+    while (NetworkTrafficFilter::getRowUpdate(update)) {
+        // A viewer that still captures on its own only drains what it captured while the collector runs.
+        if (update.action != NETHOGS_APP_ACTION_REMOVE && !fromCollector) {
+            // Find the state entry of the process by its start time. Bytes of a pid that wasn't sampled this
+            // tick are left out: counters are cumulative, so a process started after the listing counts them
+            // in full once it has an entry, and traffic nethogs couldn't map to a live process isn't counted.
+            PidState *state = nullptr;
+            auto process = std::lower_bound(processes.begin(), processes.end(), update.record.pid,
+                                            [](const ProcessSample &sample, int pid) { return sample.tid < pid; });
+            if (process != processes.end() && process->tid == update.record.pid) {
+                state = pidStates->find(update.record.pid, process->start_time);
+            }
+
+            totalSentKbs += update.record.sent_kbs;
+            totalRecvKbs += update.record.recv_kbs;
+
+            if (state != nullptr) {
+                totalSentBytes += (update.record.sent_bytes - state->sentBytes);
+                totalRecvBytes += (update.record.recv_bytes - state->recvBytes);
+
+                state->sentBytes = update.record.sent_bytes;
+                state->recvBytes = update.record.recv_bytes;
+            }
+
+            NetworkStatus status = {
+                update.record.sent_bytes,
+                update.record.recv_bytes,
+                update.record.sent_kbs,
+                update.record.recv_kbs
+            };
+
+            (networkStatusSnapshot)[update.record.pid] = status;
+        }
+    }
+
+    // The collector matched traffic to processes with privileges a viewer doesn't have.
+    if (fromCollector) {
+        for (const SnapshotRing::Record &record : collectorRecords) {
+            if (record.sentBytes != 0 || record.recvBytes != 0) {
+                NetworkStatus status = {record.sentBytes, record.recvBytes, record.sentKbs, record.recvKbs};
+                networkStatusSnapshot[record.sample.tid] = status;
+            }
+        }
+        totalSentKbs = collectorTotals.totalSentKbs;
+        totalRecvKbs = collectorTotals.totalRecvKbs;
+    }
+
+    // Update entry's network status.
+    for (ProcessEntry &entry : entries) {
+        if (networkStatusSnapshot.contains(entry.pid)) {
+            entry.networkStatus = networkStatusSnapshot.value(entry.pid);
+        }
+    }
+
+    // Services add up the traffic of their processes.
+    if (processListDue && filterType == Services) {
+        QHash<unsigned int, int> serviceRows;
+        for (int row = 0; row < snapshot->services.size(); row++) {
+            serviceRows.insert(serviceSamples[row]->id, row);
+        }
+
+        for (auto status = networkStatusSnapshot.begin(); status != networkStatusSnapshot.end(); ++status) {
+            const ProcessSample *process = findProcess(processes, status.key());
+            if (process == nullptr) {
+                continue;
+            }
+
+            auto row = serviceRows.find(serviceGroups[process - processes.data()]);
+            if (row != serviceRows.end()) {
+                NetworkStatus &networkStatus = snapshot->services[row.value()].networkStatus;
+                networkStatus.sentBytes += status->sentBytes;
+                networkStatus.recvBytes += status->recvBytes;
+                networkStatus.sentKbs += status->sentKbs;
+                networkStatus.recvKbs += status->recvKbs;
+            }
+        }
+    }
+    profiler->add(PipelineProfiler::Network, PipelineProfiler::now() - networkStartTime, networkStatusSnapshot.size());
+
+    snapshot->totalRecvBytes = fromCollector ? collectorTotals.totalRecvBytes : totalRecvBytes;
+    snapshot->totalSentBytes = fromCollector ? collectorTotals.totalSentBytes : totalSentBytes;
+    snapshot->totalRecvKbs = totalRecvKbs;
+    snapshot->totalSentKbs = totalSentKbs;
+
+    // Update cpu status, from the machine totals while processes aren't sampled.
+    if (fromCollector) {
+        snapshot->cpuPercent = collectorTotals.cpuPercent;
+    } else {
+        snapshot->cpuPercent = processListDue ? cpuPercent : totalCpuAccounting->busyPercent();
+    }
+
+    if (processListDue && filterType == OnlyGUI) {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::Merge);
+        timer.setItemNumber(entries.size());
+
+        // Show every multi-process application as one row.
+        processGrouper->group(processes, groupInfos, entries, &foldedRoots);
+    } else if (processListDue) {
+        foldedRoots.clear();
+    }
+
+    // Rows of applications are hung under their parents as they are shown, helpers already folded.
+    if (processListDue && isTreeMode() && filterType != Services) {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::Tree);
+        timer.setItemNumber(entries.size());
+        buildRowTree(snapshot);
+    }
+
+    // Processes the memory detail worker should keep up to date, helpers of visible applications included.
+    if (processListDue && !memoryDetailPids.isEmpty()) {
+        requestMemoryDetails();
+    }
+
+    // Viewers only see complete ticks, the collector never pauses the process list.
+    if (publishRing != nullptr && processListDue) {
+        PipelineProfiler::Timer timer(profiler, PipelineProfiler::Publish);
+        timer.setItemNumber(currentProcesses.size());
+        publishToRing(snapshot);
+    }
+
+    // Recordings keep wall clock times, what happened at 3 a.m. should read as 3 a.m.
+    if (recorder != nullptr && !recorder->append(*snapshot, QDateTime::currentMSecsSinceEpoch())) {
+        qDebug() << "Failed to append to the recording.";
+    }
+
+    publish(StatusSnapshotPtr(snapshot));
+
+    governor->endTick();
+
+    profiler->add(PipelineProfiler::Tick, PipelineProfiler::now() - tickStartTime, 0);
+    profiler->endTick();
+
+    // Log stage durations now and then when asked to, so a slow tick can be pinned down without a profiler.
+    if (profileReportTicks > 0 && ++profiledTicks >= profileReportTicks) {
+        profiledTicks = 0;
+        qDebug().noquote() << "Sampler stages p50/p99/max us (items):" << QString::fromStdString(profiler->takeReport());
+    }
+}
@@ -0,0 +1,192 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATUSSAMPLER_H
+#define STATUSSAMPLER_H
+
+#include "cgroup_sampler.h"
+#include "cpu_accounting.h"
+#include "find_window_title.h"
+#include "memory_detail_sampler.h"
+#include "pid_state_table.h"
+#include "pipeline_profiler.h"
+#include "process_grouper.h"
+#include "process_sampler.h"
+#include "refresh_scheduler.h"
+#include "sampling_governor.h"
+#include "snapshot_recording.h"
+#include "snapshot_ring.h"
+#include "snapshot_source.h"
+#include "taskstats_client.h"
+#include "thread_sampler.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+
+/**
+ * StatusSampler runs the whole /proc, meminfo and nethogs pipeline on its own thread.
+ *
+ * Every tick builds a new immutable StatusSnapshot and publishes it to the GUI thread.
+ *
+ * While a collector publishes into a SnapshotRing, processes, their cpu, disk and network rates
+ * and the machine totals are taken from it instead of being sampled again. Names, titles,
+ * threads, detailed memory and services are still resolved locally, they only need what any
+ * user may read.
+ */
+class StatusSampler : public SnapshotSource
+{
+    Q_OBJECT
+
+public:
+    enum FilterType {OnlyGUI, OnlyMe, AllProcess, Services};
+
+    /*
+     * @duration milliseconds between two ticks
+     * @budget share of one cpu sampling may use, in percent, 0 for no limit
+     * @reportTicks log stage durations every that many ticks, 0 never logs
+     * @threshold task count from which /proc is read by several threads
+     */
+    StatusSampler(int duration, double budget = 0, int reportTicks = 0, int threshold = 4096);
+    ~StatusSampler();
+
+    /*
+     * Sample every process without a display, for the collector and for recordings. Has to be called before start().
+     */
+    void setHeadless();
+
+    /*
+     * Run as the collector and publish each tick into the ring.
+     * Has to be called before start(), the ring stays owned by the caller.
+     */
+    void setPublishRing(SnapshotRing *ring);
+
+    /*
+     * Append every tick to a recording, has to be called before start(). The recorder stays owned by the caller.
+     */
+    void setRecorder(SnapshotRecorder *recorder);
+
+public slots:
+    void sample();
+    void setExpandedPids(QList<int> pids);
+    void setFilterType(int type, QString name);
+    void setMemoryDetailPids(QList<int> pids);
+    void setVisible(bool shown);
+    void start();
+    void stop();
+
+private:
+    /*
+     * Values that only change when a process execs, read once and reused on every later tick.
+     */
+    struct CachedIdentity
+    {
+        unsigned long long startTime;
+        char cmd[64];                   // stat name when the identity was read, a new one means the process exec'd
+        QString cmdline;
+        QString name;
+        std::string desktopFile;
+        unsigned int desktopGeneration; // DesktopEntryIndex generation desktopFile was matched against
+        unsigned int tick;              // last tick the process was seen
+        bool execed;                    // the proc connector reported an exec or rename since it was read
+        bool helper;                    // helper process of a multi-process application
+        unsigned int cgroupId;          // CgroupSampler group, 0 until the services tab needs it
+    };
+
+    /*
+     * A listed process whose disk rates are read after the rows are built.
+     */
+    struct IORequest
+    {
+        int row;
+        pid_t pid;
+        unsigned long long startTime;
+        bool batched;                   // single-threaded, taskstats counters cover the whole process
+    };
+
+    CachedIdentity& updateIdentity(const ProcessSample &sample, unsigned int desktopGeneration);
+    double foldExitedProcesses(const ProcessSampler::Snapshot &processes, QVector<ProcessEntry> &entries, long long now);
+    void publishToRing(const StatusSnapshot *snapshot);
+    bool readCollector();
+    void requestMemoryDetails();
+    double sampleProcesses(StatusSnapshot *snapshot);
+    void updateDiskStatus(QVector<ProcessEntry> &entries, long long now);
+
+    CgroupSampler *cgroupSampler;
+    CpuAccounting *cpuAccounting;
+    FilterType filterType;
+    FindWindowTitle *findWindowTitle;
+    MemoryDetailSampler *memoryDetails;
+    SnapshotRing *collectorRing;
+    SnapshotRing *publishRing;
+    SnapshotRecorder *recorder;
+    SnapshotRing::Totals collectorTotals;
+    std::vector<SnapshotRing::Record> collectorRecords;
+    SamplingGovernor *governor;
+    PidStateTable *pidStates;
+    PipelineProfiler *profiler;
+    ProcessGrouper *processGrouper;
+    ProcessSampler *processSampler;
+    ProcessSampler::Snapshot currentProcesses;
+    ProcessSampler::Snapshot previousProcesses;
+    std::vector<pid_t> changedPids;
+    QElapsedTimer sampleTimer;
+    QHash<int, CachedIdentity> processIdentities;
+    QSet<int> expandedPids;
+    QSet<int> memoryDetailPids;         // rows on screen or selected, also the ones disk rates are read for
+    QString tabName;
+    QTimer *updateStatusTimer;
+    RefreshScheduler *refreshScheduler;
+    TaskstatsClient *taskstatsClient;
+    ThreadSampler *threadSampler;
+    CpuAccounting *totalCpuAccounting;
+    bool execEvents;                    // exec and rename of this tick's processes are reported by the proc connector
+    bool fromCollector;                 // this tick's processes were published by the collector
+    bool headless;
+    bool taskstatsIO;
+    bool exitsDropWarned;               // dropped exit records were logged, later drops aren't
+    bool ioQueryWarned;                 // a failed disk query was logged, later ones fall back to /proc silently
+    bool visible;
+    double cpuBudget;
+    int parallelThreshold;
+    int profileReportTicks;
+    int profiledTicks;
+    int attachTicks;
+    int updateDuration;
+    long long lastSampleTime;
+    std::vector<TaskStatsRecord> exitRecords;
+    std::vector<TaskStatsRecord> deferredExits;   // processes that exited after they were listed, charged next tick
+    std::vector<IORequest> ioRequests;
+    std::vector<TaskStatsRecord> ioRecords;
+    std::vector<pid_t> ioPids;
+    std::vector<ThreadSample> threadSamples;
+    std::vector<GroupInfo> groupInfos;
+    std::unordered_map<pid_t, pid_t> foldedRoots;
+    std::vector<MemoryDetailSampler::Request> detailRequests;
+    std::vector<unsigned int> serviceGroups;
+    std::vector<const CgroupSampler::Group*> serviceSamples;
+    uint32_t totalRecvBytes;
+    uint32_t totalSentBytes;
+};
+
+#endif
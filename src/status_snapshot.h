@@ -0,0 +1,116 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATUSSNAPSHOT_H
+#define STATUSSNAPSHOT_H
+
+#include "utils.h"
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include <string>
+
+using namespace Utils;
+
+/**
+ * One thread of an expanded process.
+ */
+struct ThreadEntry
+{
+    int tid;
+    QString name;
+    char state;
+    double cpu;
+};
+
+/**
+ * One row of the process list, as produced by the sampler thread.
+ * Only plain values live here, icons are resolved on the GUI thread because QPixmap can't be built anywhere else.
+ */
+struct ProcessEntry
+{
+    int pid;
+    int ppid;
+    unsigned long long startTime;       // clock ticks since boot, 0 in rows replayed from a recording
+    QString name;
+    QString displayName;
+    QString user;
+    std::string desktopFile;
+    char state;
+    double cpu;
+    long memory;
+    long pss;                           // bytes, -1 until the row was seen and its smaps were read
+    long uss;
+    DiskStatus diskStatus;
+    NetworkStatus networkStatus;
+    QVector<ThreadEntry> threads;       // only filled for rows the user has expanded
+
+    // Only filled in tree mode, a collapsed row shows the values of its whole subtree.
+    int parentPid;                      // row this one is shown under, 0 for top level rows
+    double subtreeCpu;                  // the row itself and every row below it
+    long subtreeMemory;
+    DiskStatus subtreeDiskStatus;
+    NetworkStatus subtreeNetworkStatus;
+};
+
+/**
+ * One row of the services tab, a systemd unit with the totals of its cgroup.
+ */
+struct ServiceEntry
+{
+    QString path;                       // cgroup path, stays the same for as long as the unit runs
+    QString name;
+    int processNumber;
+    double cpu;
+    long memory;
+    DiskStatus diskStatus;
+    NetworkStatus networkStatus;        // summed over its processes, cgroups don't count traffic
+};
+
+/**
+ * Everything the GUI shows for one tick.
+ * A snapshot is never modified after it is published, so the sampler thread and the GUI thread can share it without locking.
+ */
+struct StatusSnapshot
+{
+    bool hasProcesses;                  // false while the process list is paused, rows and process numbers are left out then
+    bool treeMode;                      // rows carry their parent and subtree totals
+    QVector<ProcessEntry> processes;    // rows of the current tab, after merging
+    QVector<ServiceEntry> services;     // rows of the services tab, processes is empty then
+    QString tabName;
+    double cpuPercent;
+    long usedMemory;
+    long totalMemory;
+    long usedSwap;
+    long totalSwap;
+    uint32_t totalRecvBytes;
+    uint32_t totalSentBytes;
+    float totalRecvKbs;
+    float totalSentKbs;
+    int guiProcessNumber;
+    int systemProcessNumber;
+};
+
+typedef QSharedPointer<const StatusSnapshot> StatusSnapshotPtr;
+
+#endif
@@ -0,0 +1,523 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "taskstats_client.h"
+#include <algorithm>
+#include <errno.h>
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/taskstats.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <unordered_map>
+
+// ac_tgid was added to struct taskstats in version 12, older kernels only tell the task id.
+#define TASKSTATS_TGID_VERSION 12
+
+// The struct layout is kernel ABI, so ac_tgid is read at its offset even from headers that don't declare it.
+static const size_t TASKSTATS_TGID_OFFSET = 368;
+#if TASKSTATS_VERSION >= TASKSTATS_TGID_VERSION
+static_assert(offsetof(struct taskstats, ac_tgid) == TASKSTATS_TGID_OFFSET, "ac_tgid moved in struct taskstats");
+#endif
+
+// Requests per send(), replies are ~450 bytes each so a batch fits well in the receive buffer.
+static const size_t QUERY_BATCH_SIZE = 256;
+
+static inline const struct nlattr* firstAttribute(const void *data)
+{
+    return static_cast<const struct nlattr*>(data);
+}
+
+static inline bool attributeOk(const struct nlattr *attribute, int remaining)
+{
+    return remaining >= static_cast<int>(sizeof(struct nlattr)) &&
+        attribute->nla_len >= sizeof(struct nlattr) &&
+        attribute->nla_len <= remaining;
+}
+
+static inline const struct nlattr* nextAttribute(const struct nlattr *attribute, int &remaining)
+{
+    int length = NLA_ALIGN(attribute->nla_len);
+    remaining -= length;
+
+    return reinterpret_cast<const struct nlattr*>(reinterpret_cast<const char*>(attribute) + length);
+}
+
+static inline const void* attributeData(const struct nlattr *attribute)
+{
+    return reinterpret_cast<const char*>(attribute) + NLA_HDRLEN;
+}
+
+static inline int attributeLength(const struct nlattr *attribute)
+{
+    return attribute->nla_len - NLA_HDRLEN;
+}
+
+/*
+ * Copy a struct taskstats out of an attribute, older kernels send a shorter struct.
+ *
+ * @tgid thread group of the task, 0 if the kernel doesn't tell
+ */
+static bool readTaskstats(const struct nlattr *attribute, struct taskstats &stats, pid_t &tgid)
+{
+    int length = std::min(attributeLength(attribute), static_cast<int>(sizeof(stats)));
+    if (length < static_cast<int>(offsetof(struct taskstats, write_char) + sizeof(stats.write_char))) {
+        return false;
+    }
+    // Fields past the end of a shorter payload from an older kernel read as zero.
+    memset(&stats, 0, sizeof(stats));
+    memcpy(&stats, attributeData(attribute), length);
+
+    tgid = 0;
+    if (stats.version >= TASKSTATS_TGID_VERSION &&
+        attributeLength(attribute) >= static_cast<int>(TASKSTATS_TGID_OFFSET + sizeof(uint32_t))) {
+        uint32_t value;
+        memcpy(&value, static_cast<const char*>(attributeData(attribute)) + TASKSTATS_TGID_OFFSET, sizeof(value));
+        tgid = value;
+    }
+
+    return true;
+}
+
+/*
+ * Find pid and stats in an AGGR_PID attribute.
+ */
+static bool readAggregate(const struct nlattr *attribute, pid_t &pid, pid_t &tgid, struct taskstats &stats)
+{
+    bool hasStats = false;
+    pid = 0;
+    tgid = 0;
+
+    int remaining = attributeLength(attribute);
+    const struct nlattr *nested = firstAttribute(attributeData(attribute));
+    for (; attributeOk(nested, remaining); nested = nextAttribute(nested, remaining)) {
+        if (nested->nla_type == TASKSTATS_TYPE_PID && attributeLength(nested) >= static_cast<int>(sizeof(uint32_t))) {
+            pid = *static_cast<const uint32_t*>(attributeData(nested));
+        } else if (nested->nla_type == TASKSTATS_TYPE_STATS) {
+            hasStats = readTaskstats(nested, stats, tgid);
+        }
+    }
+
+    return pid != 0 && hasStats;
+}
+
+/*
+ * Find the thread group id in an AGGR_TGID attribute, 0 if it has none.
+ */
+static pid_t readGroupAggregate(const struct nlattr *attribute)
+{
+    int remaining = attributeLength(attribute);
+    const struct nlattr *nested = firstAttribute(attributeData(attribute));
+    for (; attributeOk(nested, remaining); nested = nextAttribute(nested, remaining)) {
+        if (nested->nla_type == TASKSTATS_TYPE_TGID && attributeLength(nested) >= static_cast<int>(sizeof(uint32_t))) {
+            return *static_cast<const uint32_t*>(attributeData(nested));
+        }
+    }
+
+    return 0;
+}
+
+static void fillRecord(pid_t pid, const struct taskstats &stats, TaskStatsRecord &record)
+{
+    memset(&record, 0, sizeof(record));
+    record.pid = pid;
+    record.ppid = stats.ac_ppid;
+    strncpy(record.comm, stats.ac_comm, std::min(sizeof(record.comm), sizeof(stats.ac_comm)));
+    record.comm[sizeof(record.comm) - 1] = '\0';
+    record.cpuTime = stats.ac_utime + stats.ac_stime;
+    record.readBytes = stats.read_char;
+    record.writeBytes = stats.write_char;
+}
+
+TaskstatsClient::TaskstatsClient()
+{
+    commandFd = -1;
+    exitFd = -1;
+    familyId = 0;
+
+    long cpuNumber = sysconf(_SC_NPROCESSORS_CONF);
+    char mask[32];
+    snprintf(mask, sizeof(mask), "0-%ld", std::max(cpuNumber, 1L) - 1);
+    cpuMask = mask;
+}
+
+TaskstatsClient::~TaskstatsClient()
+{
+    if (exitFd >= 0) {
+        sendMessage(exitFd, familyId, TASKSTATS_CMD_GET, TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK, cpuMask.c_str(), cpuMask.size() + 1);
+        close(exitFd);
+    }
+
+    if (commandFd >= 0) {
+        close(commandFd);
+    }
+}
+
+bool TaskstatsClient::start()
+{
+    commandFd = openSocket();
+    if (commandFd < 0) {
+        return false;
+    }
+
+    // Replies to our own requests are never far away, don't let a broken kernel hang the sampler.
+    struct timeval timeout = {1, 0};
+    setsockopt(commandFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    int bufferSize = 1024 * 1024;
+    setsockopt(commandFd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    if (!resolveFamily()) {
+        close(commandFd);
+        commandFd = -1;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool TaskstatsClient::listenExits()
+{
+    if (familyId == 0) {
+        return false;
+    }
+
+    exitFd = openSocket();
+    if (exitFd < 0) {
+        return false;
+    }
+
+    // Builds spawn thousands of tasks between two ticks, give them room.
+    int bufferSize = 4 * 1024 * 1024;
+    setsockopt(exitFd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    if (!sendMessage(exitFd, familyId, TASKSTATS_CMD_GET, TASKSTATS_CMD_ATTR_REGISTER_CPUMASK, cpuMask.c_str(), cpuMask.size() + 1)) {
+        close(exitFd);
+        exitFd = -1;
+
+        return false;
+    }
+
+    // Registration errors (EPERM without CAP_NET_ADMIN) come back as an ack.
+    char buffer[1024] __attribute__((aligned(NLMSG_ALIGNTO)));
+    ssize_t length = recv(exitFd, buffer, sizeof(buffer), MSG_DONTWAIT | MSG_PEEK);
+    if (length > 0) {
+        struct nlmsghdr *header = reinterpret_cast<struct nlmsghdr*>(buffer);
+        if (NLMSG_OK(header, static_cast<unsigned int>(length)) && header->nlmsg_type == NLMSG_ERROR) {
+            struct nlmsgerr *error = static_cast<struct nlmsgerr*>(NLMSG_DATA(header));
+            recv(exitFd, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+            if (error->error != 0) {
+                close(exitFd);
+                exitFd = -1;
+
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool TaskstatsClient::isListeningExits() const
+{
+    return exitFd >= 0;
+}
+
+bool TaskstatsClient::pollExits(std::vector<TaskStatsRecord> &records)
+{
+    records.clear();
+    if (exitFd < 0) {
+        return true;
+    }
+
+    bool complete = true;
+    std::unordered_map<pid_t, size_t> groups;
+    char buffer[65536] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+    while (true) {
+        ssize_t length = recv(exitFd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == ENOBUFS) {
+                complete = false;
+                continue;
+            }
+            break;
+        }
+
+        for (struct nlmsghdr *header = reinterpret_cast<struct nlmsghdr*>(buffer);
+             NLMSG_OK(header, static_cast<unsigned int>(length));
+             header = NLMSG_NEXT(header, length)) {
+            if (header->nlmsg_type != familyId) {
+                continue;
+            }
+
+            struct genlmsghdr *genlHeader = static_cast<struct genlmsghdr*>(NLMSG_DATA(header));
+            int remaining = header->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+            const struct nlattr *attribute = firstAttribute(reinterpret_cast<char*>(genlHeader) + GENL_HDRLEN);
+
+            // Every task exit carries an AGGR_PID with the task's own counters. The AGGR_TGID sent with the
+            // last thread of a group only has delay accounting, so groups are summed from the tasks instead,
+            // it only tells that the group is gone. It follows the AGGR_PID of the same task.
+            for (; attributeOk(attribute, remaining); attribute = nextAttribute(attribute, remaining)) {
+                if ((attribute->nla_type & NLA_TYPE_MASK) == TASKSTATS_TYPE_AGGR_TGID) {
+                    auto group = groups.find(readGroupAggregate(attribute));
+                    if (group != groups.end()) {
+                        records[group->second].exited = true;
+                    }
+                    continue;
+                } else if ((attribute->nla_type & NLA_TYPE_MASK) != TASKSTATS_TYPE_AGGR_PID) {
+                    continue;
+                }
+
+                pid_t pid;
+                pid_t tgid;
+                struct taskstats stats;
+                if (!readAggregate(attribute, pid, tgid, stats)) {
+                    continue;
+                }
+
+                // Kernels before version 12 don't tell, every task counts as its own group there.
+                if (tgid == 0) {
+                    tgid = pid;
+                }
+
+                TaskStatsRecord task;
+                fillRecord(tgid, stats, task);
+
+                auto group = groups.find(tgid);
+                if (group == groups.end()) {
+                    groups.emplace(tgid, records.size());
+                    records.push_back(task);
+                    continue;
+                }
+
+                TaskStatsRecord &record = records[group->second];
+                if (pid == tgid) {
+                    memcpy(record.comm, task.comm, sizeof(record.comm));
+                }
+                record.cpuTime += task.cpuTime;
+                record.readBytes += task.readBytes;
+                record.writeBytes += task.writeBytes;
+            }
+        }
+    }
+
+    return complete;
+}
+
+bool TaskstatsClient::query(const std::vector<pid_t> &pids, std::vector<TaskStatsRecord> &records)
+{
+    records.clear();
+    if (commandFd < 0 || familyId == 0) {
+        return false;
+    }
+
+    for (size_t offset = 0; offset < pids.size(); offset += QUERY_BATCH_SIZE) {
+        if (!queryBatch(pids.data() + offset, std::min(QUERY_BATCH_SIZE, pids.size() - offset), records)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TaskstatsClient::queryBatch(const pid_t *pids, size_t number, std::vector<TaskStatsRecord> &records)
+{
+    // Requests are identical apart from pid and sequence number, the kernel handles every message of one send().
+    size_t requestLength = NLMSG_ALIGN(NLMSG_LENGTH(GENL_HDRLEN + NLA_HDRLEN + sizeof(uint32_t)));
+    requestBuffer.assign(requestLength * number, 0);
+
+    for (size_t i = 0; i < number; i++) {
+        struct nlmsghdr *header = reinterpret_cast<struct nlmsghdr*>(requestBuffer.data() + requestLength * i);
+        header->nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN + NLA_HDRLEN + sizeof(uint32_t));
+        header->nlmsg_type = familyId;
+        header->nlmsg_flags = NLM_F_REQUEST;
+        header->nlmsg_seq = i;
+
+        struct genlmsghdr *genlHeader = static_cast<struct genlmsghdr*>(NLMSG_DATA(header));
+        genlHeader->cmd = TASKSTATS_CMD_GET;
+        genlHeader->version = 1;
+
+        struct nlattr *attribute = reinterpret_cast<struct nlattr*>(reinterpret_cast<char*>(genlHeader) + GENL_HDRLEN);
+        attribute->nla_type = TASKSTATS_CMD_ATTR_PID;
+        attribute->nla_len = NLA_HDRLEN + sizeof(uint32_t);
+        uint32_t pid = pids[i];
+        memcpy(reinterpret_cast<char*>(attribute) + NLA_HDRLEN, &pid, sizeof(pid));
+    }
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+
+    ssize_t sent = sendto(commandFd, requestBuffer.data(), requestBuffer.size(), 0, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    if (sent != static_cast<ssize_t>(requestBuffer.size())) {
+        return false;
+    }
+
+    // Every request gets exactly one answer: the stats, or an error for tasks that are gone.
+    size_t firstRecord = records.size();
+    size_t answered = 0;
+    replyBuffer.resize(65536);
+    replySequences.clear();
+
+    while (answered < number) {
+        ssize_t length = recv(commandFd, replyBuffer.data(), replyBuffer.size(), 0);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        for (struct nlmsghdr *header = reinterpret_cast<struct nlmsghdr*>(replyBuffer.data());
+             NLMSG_OK(header, static_cast<unsigned int>(length));
+             header = NLMSG_NEXT(header, length)) {
+            answered++;
+
+            if (header->nlmsg_type != familyId) {
+                continue;
+            }
+
+            int remaining = header->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+            const struct nlattr *attribute = firstAttribute(static_cast<char*>(NLMSG_DATA(header)) + GENL_HDRLEN);
+            for (; attributeOk(attribute, remaining); attribute = nextAttribute(attribute, remaining)) {
+                pid_t pid;
+                pid_t tgid;
+                struct taskstats stats;
+                if ((attribute->nla_type & NLA_TYPE_MASK) == TASKSTATS_TYPE_AGGR_PID && readAggregate(attribute, pid, tgid, stats)) {
+                    TaskStatsRecord record;
+                    fillRecord(pid, stats, record);
+                    records.push_back(record);
+                    replySequences.push_back(header->nlmsg_seq);
+                }
+            }
+        }
+    }
+
+    // Replies come back in request order, keep that guarantee for callers. A reply's sequence number is its request index.
+    if (!std::is_sorted(replySequences.begin(), replySequences.end())) {
+        replyOrder.resize(replySequences.size());
+        for (size_t i = 0; i < replyOrder.size(); i++) {
+            replyOrder[i] = i;
+        }
+        std::sort(replyOrder.begin(), replyOrder.end(), [this](size_t index1, size_t index2) {
+                return replySequences[index1] < replySequences[index2];
+            });
+
+        orderedRecords.clear();
+        for (size_t index : replyOrder) {
+            orderedRecords.push_back(records[firstRecord + index]);
+        }
+        std::copy(orderedRecords.begin(), orderedRecords.end(), records.begin() + firstRecord);
+    }
+
+    return true;
+}
+
+bool TaskstatsClient::resolveFamily()
+{
+    const char *name = TASKSTATS_GENL_NAME;
+    if (!sendMessage(commandFd, GENL_ID_CTRL, CTRL_CMD_GETFAMILY, CTRL_ATTR_FAMILY_NAME, name, strlen(name) + 1)) {
+        return false;
+    }
+
+    char buffer[4096] __attribute__((aligned(NLMSG_ALIGNTO)));
+    ssize_t length = recv(commandFd, buffer, sizeof(buffer), 0);
+    if (length <= 0) {
+        return false;
+    }
+
+    struct nlmsghdr *header = reinterpret_cast<struct nlmsghdr*>(buffer);
+    if (!NLMSG_OK(header, static_cast<unsigned int>(length)) || header->nlmsg_type == NLMSG_ERROR) {
+        return false;
+    }
+
+    int remaining = header->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+    const struct nlattr *attribute = firstAttribute(static_cast<char*>(NLMSG_DATA(header)) + GENL_HDRLEN);
+    for (; attributeOk(attribute, remaining); attribute = nextAttribute(attribute, remaining)) {
+        if (attribute->nla_type == CTRL_ATTR_FAMILY_ID && attributeLength(attribute) >= static_cast<int>(sizeof(uint16_t))) {
+            familyId = *static_cast<const uint16_t*>(attributeData(attribute));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int TaskstatsClient::openSocket()
+{
+    int fd = socket(PF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+bool TaskstatsClient::sendMessage(int fd, uint16_t type, uint8_t command, uint16_t attributeType, const void *data, size_t length)
+{
+    char buffer[512] __attribute__((aligned(NLMSG_ALIGNTO)));
+    size_t messageLength = NLMSG_LENGTH(GENL_HDRLEN + NLA_HDRLEN + length);
+    if (NLMSG_ALIGN(messageLength) > sizeof(buffer)) {
+        return false;
+    }
+    memset(buffer, 0, NLMSG_ALIGN(messageLength));
+
+    struct nlmsghdr *header = reinterpret_cast<struct nlmsghdr*>(buffer);
+    header->nlmsg_len = messageLength;
+    header->nlmsg_type = type;
+    header->nlmsg_flags = NLM_F_REQUEST;
+
+    struct genlmsghdr *genlHeader = static_cast<struct genlmsghdr*>(NLMSG_DATA(header));
+    genlHeader->cmd = command;
+    genlHeader->version = 1;
+
+    struct nlattr *attribute = reinterpret_cast<struct nlattr*>(reinterpret_cast<char*>(genlHeader) + GENL_HDRLEN);
+    attribute->nla_type = attributeType;
+    attribute->nla_len = NLA_HDRLEN + length;
+    memcpy(reinterpret_cast<char*>(attribute) + NLA_HDRLEN, data, length);
+
+    struct sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+
+    ssize_t sent = sendto(fd, buffer, messageLength, 0, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    return sent == static_cast<ssize_t>(messageLength);
+}
@@ -0,0 +1,115 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TASKSTATSCLIENT_H
+#define TASKSTATSCLIENT_H
+
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * Accounting values of one task taken from a struct taskstats.
+ */
+struct TaskStatsRecord
+{
+    pid_t pid;                          // thread group id
+    pid_t ppid;
+    char comm[32];
+    unsigned long long cpuTime;         // utime + stime in microseconds
+    unsigned long long readBytes;       // read_char
+    unsigned long long writeBytes;      // write_char
+    bool exited;                        // exit records only, the last thread of a group that ever had several exited
+};
+
+/**
+ * TaskstatsClient talks to the TASKSTATS generic netlink family.
+ *
+ * listenExits() registers for the records the kernel sends when a task exits, so processes
+ * that are born and die between two ticks are still accounted for.
+ *
+ * query() fetches the counters of many live tasks at once: all requests are written in one
+ * send() and the replies read back in as few recv() calls as the socket buffer allows.
+ *
+ * Both need CAP_NET_ADMIN, callers simply go without when they fail.
+ */
+class TaskstatsClient final
+{
+public:
+    TaskstatsClient();
+    ~TaskstatsClient();
+
+    /*
+     * Resolve the TASKSTATS family.
+     *
+     * @return false if the kernel has no taskstats support
+     */
+    bool start();
+
+    /*
+     * Ask for exit records of tasks on every cpu, on a socket of its own.
+     */
+    bool listenExits();
+
+    bool isListeningExits() const;
+
+    /*
+     * Drain queued exit records, never blocks.
+     *
+     * @records filled with one record per thread group, summed over its tasks that exited since
+     *         the last call, the group itself may still be alive unless exited is set. The kernel only
+     *         tells for groups that had more than one thread, a single-threaded process is gone once its
+     *         only task has a record
+     * @return false if records were dropped because the socket buffer overflowed
+     */
+    bool pollExits(std::vector<TaskStatsRecord> &records);
+
+    /*
+     * Fetch the counters of tasks by pid. The kernel answers with the counters of that task only,
+     * so for a multi-threaded process they are the ones of its main thread.
+     *
+     * @records filled with one record per task that could be queried, in the order of pids
+     * @return false if the socket failed, tasks that are just gone are silently left out
+     */
+    bool query(const std::vector<pid_t> &pids, std::vector<TaskStatsRecord> &records);
+
+private:
+    bool queryBatch(const pid_t *pids, size_t number, std::vector<TaskStatsRecord> &records);
+    bool resolveFamily();
+
+    static int openSocket();
+    static bool sendMessage(int fd, uint16_t type, uint8_t command, uint16_t attributeType, const void *data, size_t length);
+
+    std::string cpuMask;
+    std::vector<char> requestBuffer;
+    std::vector<char> replyBuffer;
+    std::vector<uint32_t> replySequences;   // request index of every record of the batch being read
+    std::vector<size_t> replyOrder;
+    std::vector<TaskStatsRecord> orderedRecords;
+    int commandFd;
+    int exitFd;
+    uint16_t familyId;
+};
+
+#endif
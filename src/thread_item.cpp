@@ -0,0 +1,48 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thread_item.h"
+
+ThreadItem::ThreadItem(ProcessItem *processItem, QString threadName, double threadCpu, int tid, char threadState)
+    : ProcessItem(QPixmap(), threadName, threadName, threadCpu, 0, tid, processItem->getUser(), threadState)
+{
+    setParentItem(processItem);
+}
+
+void ThreadItem::drawForeground(QRect rect, QPainter *painter, int column, int index, bool isSelect)
+{
+    // Memory belongs to the whole process, the name is indented under the icon of the process like any child row.
+    if (column < 2 || column > 4) {
+        ProcessItem::drawForeground(rect, painter, column, index, isSelect);
+    }
+}
+
+ProcessItem* ThreadItem::getProcessItem() const
+{
+    return static_cast<ProcessItem*>(getParentItem());
+}
+
+void ThreadItem::updateThreadStatus(QString threadName, double threadCpu, char threadState)
+{
+    updateStatus(threadName, threadName, threadCpu, 0, getUser(), threadState);
+}
@@ -0,0 +1,50 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREADITEM_H
+#define THREADITEM_H
+
+#include "process_item.h"
+
+/**
+ * A thread row shown under its process when the process is expanded.
+ * Threads share the memory of their process, so only name, cpu and thread id are drawn.
+ */
+class ThreadItem : public ProcessItem
+{
+    Q_OBJECT
+    
+public:
+    ThreadItem(ProcessItem *processItem, QString threadName, double threadCpu, int tid, char threadState);
+    
+    void drawForeground(QRect rect, QPainter *painter, int column, int index, bool isSelect);
+    
+    /*
+     * Get the process this thread belongs to.
+     */
+    ProcessItem* getProcessItem() const;
+    
+    void updateThreadStatus(QString threadName, double threadCpu, char threadState);
+};
+
+#endif
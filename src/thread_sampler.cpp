@@ -0,0 +1,108 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thread_sampler.h"
+#include "proc_parsers.h"
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace ProcParsers;
+
+ThreadSampler::ThreadSampler()
+{
+    threadStates = new PidStateTable();
+}
+
+ThreadSampler::~ThreadSampler()
+{
+    delete threadStates;
+}
+
+void ThreadSampler::beginTick()
+{
+    threadStates->beginGeneration();
+}
+
+bool ThreadSampler::sample(pid_t pid, std::vector<ThreadSample> &threads)
+{
+    threads.clear();
+
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+
+    int taskFd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (taskFd < 0) {
+        return false;
+    }
+
+    // fdopendir takes over the descriptor, closedir releases it.
+    DIR *taskDir = fdopendir(taskFd);
+    if (taskDir == nullptr) {
+        close(taskFd);
+        return false;
+    }
+
+    char buffer[1024];
+    struct dirent *entry;
+    while ((entry = readdir(taskDir)) != nullptr) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+
+        // Threads exit all the time, one that is gone by now is just skipped.
+        char statPath[32];
+        snprintf(statPath, sizeof(statPath), "%s/stat", entry->d_name);
+        ProcessSample process;
+        if (readFileAt(dirfd(taskDir), statPath, buffer, sizeof(buffer)) <= 0 || !parseStat(buffer, process)) {
+            continue;
+        }
+
+        ThreadSample thread;
+        thread.tid = static_cast<pid_t>(atoi(entry->d_name));
+        thread.state = process.state;
+        memcpy(thread.name, process.cmd, sizeof(thread.name));
+        thread.cpuTicks = 0;
+
+        bool created;
+        PidState *state = threadStates->touch(thread.tid, process.start_time, &created);
+        unsigned long long cpuTime = process.utime + process.stime;
+
+        thread.measured = !created;
+        if (!created && cpuTime > state->cpuTime) {
+            thread.cpuTicks = cpuTime - state->cpuTime;
+        }
+        state->cpuTime = cpuTime;
+
+        threads.push_back(thread);
+    }
+    closedir(taskDir);
+
+    std::sort(threads.begin(), threads.end(), [](const ThreadSample &a, const ThreadSample &b) { return a.tid < b.tid; });
+
+    return !threads.empty();
+}
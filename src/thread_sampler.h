@@ -0,0 +1,74 @@
+/* -*- Mode: C++; indent-tabs-mode: nil; tab-width: 4 -*-
+ * -*- coding: utf-8 -*-
+ *
+ * Copyright (C) 2011 ~ 2017 Deepin, Inc.
+ *               2011 ~ 2017 Wang Yong
+ *
+ * Author:     Wang Yong <wangyong@deepin.com>
+ * Maintainer: Wang Yong <wangyong@deepin.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREADSAMPLER_H
+#define THREADSAMPLER_H
+
+#include "pid_state_table.h"
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * One thread of a process, with the cpu ticks it used since the previous tick it was sampled.
+ */
+struct ThreadSample
+{
+    pid_t tid;
+    char state;
+    char name[64];                      // comm of the thread, set with pthread_setname_np() or prctl()
+    unsigned long long cpuTicks;        // utime + stime since the previous sample
+    bool measured;                      // false the first time a thread is seen, cpuTicks is 0 then
+};
+
+/**
+ * ThreadSampler reads /proc/pid/task for a few chosen processes.
+ *
+ * Enumerating threads of every process would multiply the work of a tick by the average thread
+ * count, so only processes the caller asks for are read. Previous ticks of every thread are kept
+ * in a PidStateTable keyed by (tid, starttime): a thread that isn't sampled for two ticks in a row
+ * is forgotten, and starts over without a cpu value the next time it is asked for.
+ */
+class ThreadSampler final
+{
+public:
+    ThreadSampler();
+    ~ThreadSampler();
+
+    /*
+     * Start a new tick, call once before the sample() calls of that tick.
+     */
+    void beginTick();
+
+    /*
+     * Sample all threads of one process.
+     *
+     * @threads filled with one sample per thread, sorted by tid
+     * @return false if the process is gone
+     */
+    bool sample(pid_t pid, std::vector<ThreadSample> &threads);
+
+private:
+    PidStateTable *threadStates;
+};
+
+#endif
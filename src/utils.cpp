@@ -21,12 +21,15 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "desktop_entry_cache.h"
+#include "desktop_entry_index.h"
 #include "hashqstring.h"
 #include "utils.h"
 #include <QApplication>
 #include <QDateTime>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QFontMetrics>
 #include <QIcon>
 #include <QLayout>
@@ -36,9 +39,8 @@
 #include <QString>
 #include <QWidget>
 #include <QtMath>
-#include <fstream>
+#include <pwd.h>
 #include <qdiriterator.h>
-#include <sstream>
 #include <stdio.h>
 #include <string>
 #include <time.h>
@@ -62,38 +64,17 @@ namespace Utils {
         }
 
         QIcon defaultExecutableIcon = QIcon::fromTheme("application-x-executable");
-        if (desktopFile.size() == 0) {
-            QPixmap pixmap = defaultExecutableIcon.pixmap(iconSize, iconSize);
-            if (processIconMapCache != nullptr) {
-                (*processIconMapCache)[procName] = pixmap;
-            }
-
-            return pixmap;
-        }
-
-        std::ifstream in;
-        in.open(desktopFile);
         QIcon icon = defaultExecutableIcon;
-        QString iconName;
-        while(!in.eof()) {
-            std::string line;
-            std::getline(in,line);
-            iconName = QString::fromStdString(line);
-            if (iconName.startsWith("Icon=")) {
-                iconName.remove(0,5); // remove the first 5 chars
-            } else {
-                continue;
-            }
+        if (desktopFile.size() != 0) {
+            QString iconName = DesktopEntryCache::instance()->get(desktopFile).icon;
 
             if (iconName.contains("/")) {
                 // this is probably a path to the file, use that instead of the theme icon name
                 icon = QIcon(iconName);
-            } else {
-                icon = QIcon::fromTheme(iconName,defaultExecutableIcon);
-                break;
+            } else if (!iconName.isEmpty()) {
+                icon = QIcon::fromTheme(iconName, defaultExecutableIcon);
             }
         }
-        in.close();
 
         QPixmap pixmap = icon.pixmap(iconSize, iconSize);
         if (processIconMapCache != nullptr) {
@@ -171,38 +152,14 @@ namespace Utils {
             return procName;
         }
 
-        std::ifstream in;
-        in.open(desktopFile);
-        QString displayName = procName;
-        while(!in.eof()) {
-            std::string line;
-            std::getline(in,line);
-
-            QString lineContent = QString::fromStdString(line);
-
-            QString localNameFlag = QString("Name[%1]=").arg(QLocale::system().name());
-            QString nameFlag = "Name=";
-            QString genericNameFlag = QString("GenericName[%1]=").arg(QLocale::system().name());
-
-            if (lineContent.startsWith(localNameFlag)) {
-                displayName = lineContent.remove(0, localNameFlag.size());
-
-                break;
-            } else if (lineContent.startsWith(genericNameFlag)) {
-                displayName = lineContent.remove(0, genericNameFlag.size());
-
-                break;
-            } else if (lineContent.startsWith(nameFlag)) {
-                displayName = lineContent.remove(0, nameFlag.size());
-
-                continue;
-            } else {
-                continue;
-            }
+        DesktopEntry entry = DesktopEntryCache::instance()->get(desktopFile);
+        if (!entry.name.isEmpty()) {
+            return entry.name;
+        } else if (!entry.genericName.isEmpty()) {
+            return entry.genericName;
         }
-        in.close();
 
-        return displayName;
+        return procName;
     }
 
     QString getImagePath(QString imageName)
@@ -220,35 +177,49 @@ namespace Utils {
      */
     QString getProcessCmdline(pid_t pid)
     {
-        std::string temp;
-        try {
-            std::fstream fs;
-            fs.open("/proc/"+std::to_string((long)pid)+"/cmdline", std::fstream::in);
-            std::getline(fs,temp);
-            fs.close();
-        } catch(std::ifstream::failure e) {
-            return "FAILED TO READ PROC";
+        char buffer[4096];
+        bool truncated;
+
+        ssize_t length = ProcParsers::readCmdline(pid, buffer, sizeof(buffer), &truncated);
+        if (length <= 0) {
+            return "";
         }
 
-        // change \0 to ' '
-        std::replace(temp.begin(),temp.end(),'\0',' ');
+        // Very long command lines don't fit on the stack, read those again in full.
+        if (truncated) {
+            QFile file(QString("/proc/%1/cmdline").arg(pid));
+            if (file.open(QIODevice::ReadOnly)) {
+                QByteArray cmdline = file.readAll();
+                cmdline.resize(ProcParsers::parseCmdline(cmdline.data(), cmdline.size()));
 
-        if (temp.size()<1) {
-            return "";
+                return QString::fromUtf8(cmdline);
+            }
         }
-        return QString::fromStdString(temp);
+
+        return QString::fromUtf8(buffer, length);
+    }
+
+    /**
+     * @brief getProcessName Get the name of the process from a ProcessSample
+     * @param p The ProcessSample structure to use for getting the name of the process
+     * @return
+     */
+    QString getProcessName(const ProcessSample* p)
+    {
+        return getProcessName(p, getProcessCmdline(p->tid));
     }
 
     /**
-     * @brief getProcessName Get the name of the process from a proc_t
-     * @param p The proc_t structure to use for getting the name of the process
+     * @brief getProcessName Get the name of the process from a ProcessSample and a command line already read
+     * @param p The ProcessSample structure to use for getting the name of the process
+     * @param cmdline The command line of the process, as returned by getProcessCmdline
      * @return
      */
-    QString getProcessName(proc_t* p)
+    QString getProcessName(const ProcessSample* p, QString cmdline)
     {
 
         QString processName = "ERROR";
-        processName = getProcessNameFromCmdLine(p->tid);
+        processName = getProcessNameFromCmdLine(cmdline);
         if (processName == "") {
             // fallback on /proc/*//*stat program name value
             // bad because it is limited to 16 chars
@@ -265,7 +236,17 @@ namespace Utils {
      */
     QString getProcessNameFromCmdLine(const pid_t pid)
     {
-        std::string cmdline = getProcessCmdline(pid).toStdString();
+        return getProcessNameFromCmdLine(getProcessCmdline(pid));
+    }
+
+    /**
+     * @brief getProcessNameFromCmdLine Get the name of the process from its command line
+     * @param processCmdline the command line of the process
+     * @return The name of the process
+     */
+    QString getProcessNameFromCmdLine(QString processCmdline)
+    {
+        std::string cmdline = processCmdline.toStdString();
 
         if (cmdline.size()<1) {
             return "";
@@ -297,85 +278,48 @@ namespace Utils {
         return QString(":/qss/%1").arg(qssName);
     }
 
-    bool fileExists(QString path)
+    /**
+     * @brief getUserName Get the login name of an user id, names are cached since they hardly change
+     * @param uid The user id
+     * @return The login name, or the uid as string if it has no passwd entry
+     */
+    QString getUserName(uid_t uid)
     {
-        QFileInfo check_file(path);
+        static QMap<uid_t, QString> userNames;
 
-        // check if file exists and if yes: Is it really a file and no directory?
-        return check_file.exists() && check_file.isFile();
-    }
+        if (userNames.contains(uid)) {
+            return userNames.value(uid);
+        }
 
-    bool getProcPidIO(int pid, ProcPidIO &io ) {
-        std::stringstream ss;
-        ss << "/proc/" << pid << "/io";
-        std::ifstream ifs( ss.str().c_str() );
-        if ( ifs.good() ) {
-            while ( ifs.good() && !ifs.eof() ) {
-                std::string s;
-                getline( ifs, s );
-                unsigned long t;
-                if ( sscanf( s.c_str(), "rchar: %lu", &t ) == 1 ) io.rchar = t;
-                else if ( sscanf( s.c_str(), "wchar: %lu", &t ) == 1 ) io.wchar = t;
-                else if ( sscanf( s.c_str(), "syscr: %lu", &t ) == 1 ) io.syscr = t;
-                else if ( sscanf( s.c_str(), "syscw: %lu", &t ) == 1 ) io.syscw = t;
-                else if ( sscanf( s.c_str(), "read_bytes: %lu", &t ) == 1 ) io.read_bytes = t;
-                else if ( sscanf( s.c_str(), "write_bytes: %lu", &t ) == 1 ) io.write_bytes = t;
-                else if ( sscanf( s.c_str(), "cancelled_write_bytes: %lu", &t ) == 1 ) io.cancelled_write_bytes = t;
-            }
+        QString name;
+        struct passwd pwd;
+        struct passwd *result = NULL;
+        char buffer[1024];
+        if (getpwuid_r(uid, &pwd, buffer, sizeof(buffer), &result) == 0 && result != NULL) {
+            name = QString::fromLocal8Bit(result->pw_name);
         } else {
-            return false;
+            name = QString::number(uid);
         }
+        userNames[uid] = name;
 
-        return true;
+        return name;
     }
 
-    std::string getDesktopFileFromName(QString procName)
+    bool fileExists(QString path)
     {
-        QDirIterator dir("/usr/share/applications", QDirIterator::Subdirectories);
-        std::string desktopFile;
-        
-        QString procname = procName.toLower();
-
-        if (!GUI_BLACKLIST.contains(procname)) {
-            while(dir.hasNext()) {
-                if (dir.fileInfo().suffix() == "desktop") {
-                    if (dir.fileName().toLower().contains(procname + ".desktop")) {
-                        desktopFile = dir.filePath().toStdString();
-                        break;
-                    }
-                }
-                dir.next();
-            }
-            if (desktopFile.size() == 0) {
-                while(dir.hasNext()) {
-                    if (dir.fileInfo().suffix() == "desktop") {
-                        if (dir.fileName().toLower().contains(procname)) {
-                            desktopFile = dir.filePath().toStdString();
-                            break;
-                        }
-                    }
-                    dir.next();
-                }
-            }
-        }
+        QFileInfo check_file(path);
 
-        return desktopFile;
+        // check if file exists and if yes: Is it really a file and no directory?
+        return check_file.exists() && check_file.isFile();
     }
 
-    /**
-     * @brief calculateCPUPercentage
-     * @param before - old proc_t of the process
-     * @param after - new proc_t of the process
-     * @param cpuTime - the last total cpu time measurement
-     * @return The cpu percentage of the process
-     */
-    double calculateCPUPercentage(const proc_t* before, const proc_t* after, const unsigned long long &cpuTime)
+    bool getProcPidIO(int pid, ProcPidIO &io ) {
+        return ProcParsers::readIO(pid, io);
+    }
+
+    std::string getDesktopFileFromName(QString procName)
     {
-        double cpuTimeA = getTotalCpuTime() - cpuTime;
-        unsigned long long processcpuTime = ((after->utime + after->stime)
-                                             - (before->utime + before->stime));
-        /// TODO: GSM has an option to divide by # cpus
-        return (processcpuTime / cpuTimeA) * 100.0 * sysconf(_SC_NPROCESSORS_CONF);
+        return DesktopEntryIndex::instance()->find(procName);
     }
 
     qreal easeInOut(qreal x)
@@ -403,41 +347,6 @@ namespace Utils {
         return qPow(x - 1, 5) + 1;
     }
 
-    /**
-     * @brief getTotalCpuTime Read the data from /proc/stat and get the total time the cpu has been busy
-     * @return The total cpu time
-     */
-    unsigned long long getTotalCpuTime()
-    {
-        // from https://github.com/scaidermern/top-processes/blob/master/top_proc.c#L54
-        FILE* file = fopen("/proc/stat", "r");
-        if (file == NULL) {
-            perror("Could not open stat file");
-            return 0;
-        }
-
-        char buffer[1024];
-        unsigned long long user = 0, nice = 0, system = 0, idle = 0;
-        // added between Linux 2.5.41 and 2.6.33, see man proc(5)
-        unsigned long long iowait = 0, irq = 0, softirq = 0, steal = 0, guest = 0, guestnice = 0;
-
-        char* ret = fgets(buffer, sizeof(buffer) - 1, file);
-        if (ret == NULL) {
-            perror("Could not read stat file");
-            fclose(file);
-            return 0;
-        }
-        fclose(file);
-
-        sscanf(buffer,
-               "cpu  %16llu %16llu %16llu %16llu %16llu %16llu %16llu %16llu %16llu %16llu",
-               &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal, &guest, &guestnice);
-
-        // sum everything up (except guest and guestnice since they are already included
-        // in user and nice, see http://unix.stackexchange.com/q/178045/20626)
-        return user + nice + system + idle + iowait + irq + softirq + steal;
-    }
-
     void addLayoutWidget(QLayout *layout, QWidget *widget)
     {
         layout->addWidget(widget);
@@ -29,7 +29,8 @@
 #include <QObject>
 #include <QPainter>
 #include <QString>
-#include <proc/readproc.h>
+#include "proc_parsers.h"
+#include "process_sampler.h"
 
 const int RECTANGLE_PADDING = 24;
 const int RECTANGLE_RADIUS = 8;
@@ -45,47 +46,6 @@ namespace Utils {
         float writeKbs;
     } DiskStatus;
 
-    /**
-     * Process IO details from /proc/pid/io. Note that the IO counters encompass all IO, not only to disk, but also pipes and sockets.
-     * Root access is required to read /prod/pid/io (one may detect the size of a password of another process by examining this file),
-     */
-    struct ProcPidIO {
-        /**
-         * characters read - The number of bytes which this task has caused to be read from storage. This is simply the sum of bytes which this process passed to
-         * read(2) and similar system calls. It includes things such as terminal I/O and is unaffected by whether or not actual physical disk I/O
-         * was required (the read might have been satisfied from pagecache).
-         */
-        unsigned long rchar;
-        /**
-         * characters written - The number of bytes which this task has caused, or shall cause to be written to disk.  Similar caveats apply here as with rchar.
-         */
-        unsigned long wchar;
-        /**
-         * read syscalls - Attempt to count the number of read I/O operations—that is, system calls such as read(2) and pread(2).
-         */
-        unsigned long syscr;
-        /**
-         * write syscalls - Attempt to count the number of write I/O operations—that is, system calls such as write(2) and pwrite(2).
-         */
-        unsigned long syscw;
-        /**
-         * bytes read - Attempt to count the number of bytes which this process really did cause to be fetched from the  storage  layer.   This  is  accurate  for
-         * block-backed filesystems.
-         */
-        unsigned long read_bytes;
-        /**
-         * bytes written - Attempt to count the number of bytes which this process caused to be sent to the storage layer.
-         */
-        unsigned long write_bytes;
-        /**
-         * The  big  inaccuracy  here is truncate.  If a process writes 1MB to a file and then deletes the file, it will in fact perform no writeout.
-         * But it will have been accounted as having caused 1MB of write.  In other words: this field represents  the  number  of  bytes  which  this
-         * process caused to not happen, by truncating pagecache.  A task can cause "negative" I/O too.  If this task truncates some dirty pagecache,
-         * some I/O which another task has been accounted for (in its write_bytes) will not be happening.
-         */
-        unsigned long cancelled_write_bytes;
-    };
-
     typedef struct NetworkStatus {
         uint32_t sentBytes;
         uint32_t recvBytes;
@@ -102,20 +62,21 @@ namespace Utils {
     QString getDisplayNameFromName(QString procName, std::string desktopFile);
     QString getImagePath(QString imageName);
     QString getProcessCmdline(pid_t pid);
-    QString getProcessName(proc_t* p);
+    QString getProcessName(const ProcessSample* p);
+    QString getProcessName(const ProcessSample* p, QString cmdline);
+    QString getProcessNameFromCmdLine(QString processCmdline);
     QString getProcessNameFromCmdLine(const pid_t pid);
     QString getQrcPath(QString imageName);
     QString getQssPath(QString qssName);
+    QString getUserName(uid_t uid);
     bool fileExists(QString path);
     bool getProcPidIO(int pid, ProcPidIO &io );
-    double calculateCPUPercentage(const proc_t* before, const proc_t* after, const unsigned long long &cpuTime);
     std::string getDesktopFileFromName(QString procName);
     qreal easeInOut(qreal x);
     qreal easeInQuad(qreal x);
     qreal easeInQuint(qreal x);
     qreal easeOutQuad(qreal x);
     qreal easeOutQuint(qreal x);
-    unsigned long long getTotalCpuTime();
     void addLayoutWidget(QLayout *layout, QWidget *widget);
     void applyQss(QWidget *widget, QString qssName);
     void blurRect(WindowManager *windowManager, int widgetId, QRectF rect);